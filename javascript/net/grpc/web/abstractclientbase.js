@@ -27,6 +27,7 @@ goog.module('grpc.web.AbstractClientBase');
 goog.module.declareLegacyNamespace();
 
 
+const ClientDuplexStream = goog.require('grpc.web.ClientDuplexStream');
 const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
 const MethodDescriptor = goog.require('grpc.web.MethodDescriptor');
 const RpcError = goog.require('grpc.web.RpcError');
@@ -93,6 +94,32 @@ const AbstractClientBase = class {
    * @return {!ClientReadableStream<RESPONSE>} The Client Readable Stream
    */
   serverStreaming(method, requestMessage, metadata, methodDescriptor) {}
+
+  /**
+   * @abstract
+   * @template REQUEST, RESPONSE
+   * @param {string} method The method to invoke
+   * @param {!Object<string, string>} metadata User defined call metadata
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>}
+   *   methodDescriptor Information of this RPC method
+   * @param {function(?RpcError, ?)=}
+   *   callback A callback function which takes (error, RESPONSE or null)
+   * @return {!ClientDuplexStream<REQUEST, RESPONSE>} The stream the requests
+   *   are written to
+   */
+  clientStreaming(method, metadata, methodDescriptor, callback) {}
+
+  /**
+   * @abstract
+   * @template REQUEST, RESPONSE
+   * @param {string} method The method to invoke
+   * @param {!Object<string, string>} metadata User defined call metadata
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>}
+   *   methodDescriptor Information of this RPC method
+   * @return {!ClientDuplexStream<REQUEST, RESPONSE>} The stream the requests
+   *   are written to and the responses read from
+   */
+  bidiStreaming(method, metadata, methodDescriptor) {}
 };
 
 /**
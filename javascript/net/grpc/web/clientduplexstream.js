@@ -0,0 +1,64 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview gRPC web client Duplex Stream
+ *
+ * This class is being returned after a client streaming or bidi streaming
+ * call has been started. The requests are written to it, and the responses
+ * are read from it like from a ClientReadableStream.
+ */
+goog.module('grpc.web.ClientDuplexStream');
+
+goog.module.declareLegacyNamespace();
+
+
+const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
+
+
+
+/**
+ * A stream that the client writes requests to and reads responses from.
+ * Used for calls that are streaming from the client side.
+ *
+ * @template REQUEST, RESPONSE
+ * @interface
+ * @extends {ClientReadableStream<RESPONSE>}
+ */
+const ClientDuplexStream = function() {};
+
+
+/**
+ * Sends a request.
+ *
+ * @param {REQUEST} request The request proto
+ * @return {!ClientDuplexStream<REQUEST, RESPONSE>} this object
+ */
+ClientDuplexStream.prototype.write = goog.abstractMethod;
+
+
+
+/**
+ * Half-closes the stream: tells the server that no more requests follow.
+ *
+ * @return {!ClientDuplexStream<REQUEST, RESPONSE>} this object
+ */
+ClientDuplexStream.prototype.end = goog.abstractMethod;
+
+
+
+exports = ClientDuplexStream;
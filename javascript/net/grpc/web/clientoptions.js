@@ -24,6 +24,24 @@ class ClientOptions {
      */
     this.withCredentials;
 
+    /**
+     * Whether to send unary calls to methods with idempotency_level =
+     * NO_SIDE_EFFECTS as GET requests, holding the request in the URL query
+     * param $req=, so that browsers, proxies and CDNs may cache the responses.
+     * The server, or its proxy, must accept such requests.
+     * @type {boolean|undefined}
+     */
+    this.useHttpGet;
+
+    /**
+     * Whether concurrent promise-based unary calls to the same method with
+     * idempotency_level = NO_SIDE_EFFECTS, and with the same request and
+     * metadata, share a single call and its response. See
+     * GrpcWebClientBase#getCoalescedCallCount() for the hit rate.
+     * @type {boolean|undefined}
+     */
+    this.coalesceCalls;
+
     /**
      * Unary interceptors. Note that they are only available in grpcweb and
      * grpcwebtext mode
@@ -60,6 +78,65 @@ class ClientOptions {
      * @type {boolean|undefined}
      */
     this.useFetchDownloadStreams;
+
+    /**
+     * The number of responses each server stream reuses, for methods whose
+     * MethodDescriptor has a deserializer into an existing response, as
+     * generated with the reuse_response_messages option. A response passed to
+     * a 'data' callback is overwritten when this many more responses have
+     * arrived. 0 disables reuse. Defaults to 2.
+     * @type {number|undefined}
+     */
+    this.responsePoolSize;
+
+    /**
+     * Whether client streaming and bidi streaming calls upload each request
+     * as it is written, where fetch() can stream request bodies. Browsers
+     * only do so over HTTP/2 or later, and fail the call otherwise. When
+     * false, or where it is not supported, the requests are sent together
+     * when the stream is ended. Defaults to false.
+     * @type {boolean|undefined}
+     */
+    this.streamingUploads;
+
+    /**
+     * The URL that unary calls are sent to in batches, rather than one HTTP
+     * request each, which saves HTTP/1.1 connections when many calls are
+     * started at once. The server, or its proxy, must accept batches of type
+     * application/grpc-web-batch, see UnaryCallBatcher. Server streaming calls
+     * and GET requests are not batched.
+     * @type {string|undefined}
+     */
+    this.batchUrl;
+
+    /**
+     * How long in ms a batch collects unary calls after its first call is
+     * started, with the batchUrl option. Defaults to 0: the calls started in
+     * the same task are sent together.
+     * @type {number|undefined}
+     */
+    this.batchWindowMs;
+
+    /**
+     * The time in ms after which a unary call without a response sends a
+     * second identical request, and takes the response of whichever request
+     * gets one first. Only calls to methods whose idempotency_level is
+     * NO_SIDE_EFFECTS or IDEMPOTENT, and which are not batched, are hedged.
+     * Defaults to 0: calls are not hedged. See HedgedCall.
+     * @type {number|undefined}
+     */
+    this.hedgingDelayMs;
+
+    /**
+     * A Worker running the *_grpc_web_worker.js file generated with the
+     * decode_worker option, in the browser or with Node.js worker_threads.
+     * The responses of unary and server streaming calls are then decoded in
+     * the worker, and passed to callbacks as the plain objects generated with
+     * the plain_codecs option, rather than response messages. Batched calls
+     * are decoded on the main thread. See DecodeWorker.
+     * @type {!Worker|{postMessage: function(*)}|undefined}
+     */
+    this.decodeWorker;
   }
 }
 
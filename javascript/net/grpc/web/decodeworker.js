@@ -0,0 +1,258 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview Decodes responses in a Web Worker, for clients created with
+ * the decodeWorker option.
+ *
+ * The worker runs the *_grpc_web_worker.js file generated with the
+ * decode_worker option, which calls DecodeWorker.serve() with the plain
+ * decoders of the responses of each method. For each call, the client posts
+ * the response body to the worker as it arrives: base64 text in grpcwebtext
+ * mode, bytes otherwise. The worker decodes and parses the frames, decodes the
+ * responses, and posts back the frames with the decoded responses, which are
+ * plain objects, and the trailers. The main thread only dispatches them.
+ *
+ * Browser Workers and Node.js worker_threads Workers are both supported.
+ */
+goog.module('grpc.web.DecodeWorker');
+
+goog.module.declareLegacyNamespace();
+
+
+const GrpcWebStreamParser = goog.require('grpc.web.GrpcWebStreamParser');
+const StatusCode = goog.require('grpc.web.StatusCode');
+const googCrypt = goog.require('goog.crypt.base64');
+
+
+
+/**
+ * A Worker, or the port of the worker to its parent: a browser Worker or
+ * DedicatedWorkerGlobalScope, or a Node.js worker_threads Worker or
+ * parentPort.
+ * @typedef {{postMessage: function(*)}}
+ */
+let Port;
+
+/**
+ * The results of decoding a chunk of a response: the frames completed by the
+ * chunk, in the shape returned by GrpcWebStreamParser, with decoded data, or
+ * an error.
+ * @typedef {function(!Array<!Object>, ?StatusCode, ?string)}
+ */
+let DecodeCallback;
+
+/**
+ * The DecodeWorker of each worker, shared by all clients using it.
+ * @type {!WeakMap<!Port, !DecodeWorker>}
+ */
+const decodeWorkers = new WeakMap();
+
+/**
+ * Calls |callback| with the data of each message received by |port|.
+ * @param {!Port} port
+ * @param {function(!Object)} callback
+ */
+function listen(port, callback) {
+  if (typeof port['on'] == 'function') {
+    // Node.js
+    port['on']('message', callback);
+  } else {
+    port['addEventListener']('message', (event) => callback(event['data']));
+  }
+}
+
+/**
+ * Posts the responses of calls to a worker to be decoded, and dispatches the
+ * results.
+ * @final
+ * @unrestricted
+ */
+class DecodeWorker {
+  /**
+   * @param {!Port} worker
+   */
+  constructor(worker) {
+    /** @const @private {!Port} */
+    this.worker_ = worker;
+
+    /** @private {number} */
+    this.nextId_ = 1;
+
+    /**
+     * The callbacks of the responses being decoded, by id.
+     * @const @private {!Map<number, !DecodeCallback>}
+     */
+    this.callbacks_ = new Map();
+
+    listen(worker, (message) => {
+      const callback = this.callbacks_.get(message['id']);
+      if (callback) {
+        callback(
+            message['frames'] || [],
+            message['error'] ? /** @type {!StatusCode} */ (message['code']) :
+                               null,
+            message['error'] || null);
+      }
+    });
+  }
+
+  /**
+   * Returns the DecodeWorker posting to |worker|.
+   * @param {!Port} worker
+   * @return {!DecodeWorker}
+   */
+  static get(worker) {
+    let decodeWorker = decodeWorkers.get(worker);
+    if (!decodeWorker) {
+      decodeWorker = new DecodeWorker(worker);
+      decodeWorkers.set(worker, decodeWorker);
+    }
+    return decodeWorker;
+  }
+
+  /**
+   * Starts decoding a response of |method|. |callback| is called once for
+   * each chunk passed to decode(), in order.
+   *
+   * @param {string} method The method, e.g. /grpc.gateway.testing.EchoService/Echo
+   * @param {!DecodeCallback} callback
+   * @return {number} The id of the response
+   */
+  open(method, callback) {
+    const id = this.nextId_++;
+    this.callbacks_.set(id, callback);
+    this.worker_.postMessage({'id': id, 'method': method});
+    return id;
+  }
+
+  /**
+   * Posts the next chunk of the response |id|.
+   * @param {number} id
+   * @param {string|!Uint8Array} chunk Base64 text, whose length is a multiple
+   *     of 4, or bytes
+   */
+  decode(id, chunk) {
+    this.worker_.postMessage({'id': id, 'chunk': chunk});
+  }
+
+  /**
+   * Stops decoding the response |id|. Results not received yet are dropped.
+   * @param {number} id
+   */
+  close(id) {
+    if (this.callbacks_.delete(id)) {
+      this.worker_.postMessage({'id': id, 'close': true});
+    }
+  }
+
+  /**
+   * Decodes the responses posted to the worker, with the decoder of their
+   * method in |decoders|. Called by the generated worker files. Does nothing
+   * outside a worker unless |port| is given, e.g. the worker_threads
+   * parentPort in Node.js.
+   *
+   * @param {!Object<string, function(!Uint8Array):!Object>} decoders
+   * @param {?Port=} port The port to the parent, the worker global scope by
+   *     default
+   * @export
+   */
+  static serve(decoders, port = undefined) {
+    if (!port) {
+      // goog.global is not the global scope when grpc-web is imported as a
+      // CommonJS module, see exports.js.
+      const scope = (typeof globalThis !== 'undefined' && globalThis) || self;
+      if (typeof scope['WorkerGlobalScope'] == 'undefined') {
+        return;
+      }
+      port = /** @type {!Port} */ (scope);
+    }
+    /** @type {!Map<number, {decoder: ?function(!Uint8Array):!Object, parser: !GrpcWebStreamParser}>} */
+    const responses = new Map();
+    listen(port, (message) => {
+      const id = message['id'];
+      if (message['close']) {
+        responses.delete(id);
+        return;
+      }
+      if ('method' in message) {
+        responses.set(id, {
+          decoder: decoders[message['method']] || null,
+          parser: new GrpcWebStreamParser(),
+        });
+        return;
+      }
+      const response = responses.get(id);
+      if (!response) {
+        return;
+      }
+      port.postMessage(DecodeWorker.decodeChunk_(
+          id, response.decoder, response.parser, message['chunk']));
+    });
+  }
+
+  /**
+   * @private
+   * @static
+   * @param {number} id
+   * @param {?function(!Uint8Array):!Object} decoder
+   * @param {!GrpcWebStreamParser} parser
+   * @param {string|!Uint8Array} chunk
+   * @return {!Object} The message posted back
+   */
+  static decodeChunk_(id, decoder, parser, chunk) {
+    let frames;
+    try {
+      frames = parser.parse(
+          typeof chunk == 'string' ? googCrypt.decodeStringToUint8Array(chunk) :
+                                     chunk) ||
+          [];
+    } catch (err) {
+      return {
+        'id': id,
+        'code': StatusCode.UNKNOWN,
+        'error': 'Error in parsing response body',
+      };
+    }
+    const FrameType = GrpcWebStreamParser.FrameType;
+    for (const frame of frames) {
+      if (FrameType.DATA in frame && frame[FrameType.DATA]) {
+        if (!decoder) {
+          return {
+            'id': id,
+            'code': StatusCode.INTERNAL,
+            'error': 'No decoder in the decode worker',
+          };
+        }
+        try {
+          frame[FrameType.DATA] = decoder(frame[FrameType.DATA]);
+        } catch (err) {
+          return {
+            'id': id,
+            'code': StatusCode.INTERNAL,
+            'error': `Error when deserializing response data; error: ${err}`,
+          };
+        }
+      }
+    }
+    return {'id': id, 'frames': frames};
+  }
+}
+
+
+
+exports = DecodeWorker;
@@ -16,34 +16,55 @@
  *
  */
 
+#include "javascript/net/grpc/web/generator/grpc_generator.h"
+
 #include <google/protobuf/compiler/code_generator.h>
 #include <google/protobuf/compiler/plugin.h>
 #include <google/protobuf/compiler/plugin.pb.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/printer.h>
 #include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iterator>
+#include <list>
+#include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 
 using google::protobuf::Descriptor;
-using google::protobuf::Edition;
 using google::protobuf::EnumDescriptor;
 using google::protobuf::FieldDescriptor;
 using google::protobuf::FileDescriptor;
+using google::protobuf::FileDescriptorProto;
 using google::protobuf::MethodDescriptor;
+using google::protobuf::MethodOptions;
 using google::protobuf::ServiceDescriptor;
 using google::protobuf::FieldOptions;
 using google::protobuf::OneofDescriptor;
 using google::protobuf::compiler::CodeGenerator;
+using google::protobuf::compiler::CodeGeneratorResponse;
 using google::protobuf::compiler::GeneratorContext;
 using google::protobuf::compiler::ParseGeneratorParameter;
-using google::protobuf::compiler::PluginMain;
 using google::protobuf::compiler::Version;
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::AnnotationCollector;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
 using google::protobuf::io::Printer;
+using google::protobuf::io::StringOutputStream;
 using google::protobuf::io::ZeroCopyOutputStream;
 
 namespace grpc {
@@ -61,6 +82,7 @@ enum ImportStyle {
   CLOSURE = 0,     // goog.require("grpc.web.*")
   COMMONJS = 1,    // const grpcWeb = require("grpc-web")
   TYPESCRIPT = 2,  // import * as grpcWeb from 'grpc-web'
+  ES_MODULE = 3,   // import * as grpcWeb from 'grpc-web', one export per method
 };
 
 const char GRPC_PROMISE[] = "grpc.web.promise.GrpcWebPromise";
@@ -80,8 +102,12 @@ const char* kKeyword[] = {
     "volatile",   "while",        "with",
 };
 
-// Edit the version here prior to release
-static const std::string GRPC_WEB_VERSION = "2.0.2";
+// Returns a monotonic timestamp in microseconds, for profiling.
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
 
 string GetProtocVersion(GeneratorContext* context) {
   Version compiler_version;
@@ -111,27 +137,6 @@ string GetModeVar(const Mode mode) {
   return "";
 }
 
-string GetDeserializeMethodName(std::map<string, string> vars) {
-  if (vars["mode"] == GetModeVar(Mode::OP) && vars["binary"] == "false") {
-    return "deserialize";
-  }
-  return "deserializeBinary";
-}
-
-string GetSerializeMethodName(std::map<string, string> vars) {
-  if (vars["mode"] == GetModeVar(Mode::OP) && vars["binary"] == "false") {
-    return "serialize";
-  }
-  return "serializeBinary";
-}
-
-std::string GetSerializeMethodReturnType(std::map<string, string> vars) {
-  if (vars["mode"] == GetModeVar(Mode::OP) && vars["binary"] == "false") {
-    return "string";
-  }
-  return "!Uint8Array";
-}
-
 string LowercaseFirstLetter(string s) {
   if (s.empty()) {
     return s;
@@ -485,6 +490,24 @@ string GetBasename(string filename) {
   return basename;
 }
 
+// Returns |value| as a JSON string literal.
+string JsonString(const string& value) {
+  string result = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      result += escaped;
+    } else {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
 //Adds $ suffix to reserved method names to avoid conflicts.
 static bool IsReservedMethodName(const std::string& name) {
   static const std::unordered_set<std::string> reserved = {
@@ -522,25 +545,222 @@ std::map<string, const Descriptor*> GetAllMessages(const FileDescriptor* file) {
   return messages;
 }
 
-void PrintClosureDependencies(Printer* printer, const FileDescriptor* file) {
+void AddCodecMessage(const Descriptor* message,
+                     std::map<string, const Descriptor*>* messages) {
+  if (!messages->insert({message->full_name(), message}).second) {
+    return;
+  }
+  for (int i = 0; i < message->field_count(); i++) {
+    const FieldDescriptor* field = message->field(i);
+    if (field->message_type() != nullptr) {
+      AddCodecMessage(field->message_type(), messages);
+    }
+  }
+}
+
+// Finds the messages that need plain codecs: the request and response types
+// of all services in the file and every message type they contain,
+// including map entries.
+std::map<string, const Descriptor*> GetCodecMessages(
+    const FileDescriptor* file) {
+  std::map<string, const Descriptor*> messages;
   for (const auto& entry : GetAllMessages(file)) {
+    AddCodecMessage(entry.second, &messages);
+  }
+  return messages;
+}
+
+// Returns the suffix of the names of the plain codec functions for |desc|.
+string CodecName(const Descriptor* desc) {
+  string name = desc->full_name();
+  ReplaceCharacters(&name, ".", '_');
+  return name;
+}
+
+// A service method with every name the emitters print resolved.
+struct MethodModel {
+  const MethodDescriptor* method;
+  // The method name as declared in the .proto file, and as a JS method name.
+  string method_name;
+  string js_method_name;
+  // Full proto names of the request and response types.
+  string in;
+  string out;
+  // The request and response types in Closure and CommonJS output. CommonJS
+  // refers to types from other files through their module alias.
+  string in_type;
+  string out_type;
+  // The request and response types in TypeScript and .d.ts output.
+  string ts_in_type;
+  string ts_out_type;
+  // The expression for the MethodDescriptor in single file Closure and
+  // CommonJS output.
+  string method_descriptor;
+  // The path appended to the hostname to form the URL of the method.
+  string path;
+  // The name of the idempotency_level option of the method, as in
+  // grpc.web.IdempotencyLevel, or empty if it is IDEMPOTENCY_UNKNOWN.
+  string idempotency_level;
+};
+
+struct ServiceModel {
+  const ServiceDescriptor* service;
+  string service_name;
+  // The path of the service, which prefixes the paths of its methods.
+  string path;
+  std::vector<MethodModel> methods;
+};
+
+// An aliased import of the messages generated for a .proto file.
+struct ImportModel {
+  string alias;
+  string dep_filename;
+  string proto_filename;
+};
+
+// Everything the emitters need to know about a .proto file. Built once per
+// file by BuildFileModel() and shared by every output written for it.
+struct FileModel {
+  const FileDescriptor* file;
+  Mode mode;
+  // Variables shared by all templates: package, package_dot, mode, format,
+  // binary, promise, plugins, version, protoc_version and source_file.
+  std::map<string, string> vars;
+  // Whether single file clients construct each MethodDescriptor on first use.
+  bool lazy_method_descriptors;
+  // Whether messages are plain objects read and written by generated codecs
+  // instead of jspb.Message instances.
+  bool plain_codecs;
+  // Whether server streams can decode responses into earlier responses.
+  bool reuse_response_messages;
+  // Whether each service is emitted as a table of its methods, added to the
+  // clients by a generic dispatcher, instead of code for every method.
+  bool compact_method_tables;
+  // How requests are serialized and responses deserialized in this mode.
+  string serialize_method_name;
+  string deserialize_method_name;
+  string serialize_return_type;
+  std::vector<ServiceModel> services;
+  bool has_server_streaming;
+  // Whether stubs are generated for client streaming and bidi streaming
+  // methods, which the file has, with the client_streaming option.
+  bool has_client_streaming;
+  // Whether any method has an idempotency_level.
+  bool has_idempotency_levels;
+  // Request and response types of all methods, ordered by full name.
+  std::vector<const Descriptor*> messages;
+  // Imports of the files defining |messages|, without duplicates.
+  std::vector<ImportModel> message_imports;
+  // Imports of every dependency of the file.
+  std::vector<ImportModel> dependency_imports;
+};
+
+// Attributes each byte of a generated client file to the service or method
+// whose code it is, or to the code shared by the file, from the marks the
+// emitters print with MarkOutput(). Used for the size manifest.
+class OutputSizes : public AnnotationCollector {
+ public:
+  void AddAnnotation(size_t begin_offset, size_t end_offset,
+                     const string& file_path,
+                     const std::vector<int>& path) override {
+    bytes_[current_key_] += begin_offset - current_offset_;
+    current_key_ = file_path;
+    current_offset_ = begin_offset;
+  }
+
+  // Returns the bytes of |key|, a service or method full name, or "" for the
+  // code shared by the file.
+  int64_t bytes(const string& key) const {
+    auto it = bytes_.find(key);
+    return it == bytes_.end() ? 0 : it->second;
+  }
+
+  // The size of the file up to the last mark.
+  int64_t total_bytes() const { return current_offset_; }
+
+ private:
+  std::map<string, int64_t> bytes_;
+  string current_key_;
+  size_t current_offset_ = 0;
+};
+
+// Marks the start of the code of |key| in the output of |printer|, for the
+// OutputSizes collecting its annotations, if any. Prints nothing.
+void MarkOutput(Printer* printer, const string& key) {
+  printer->Print("$mark$", "mark", "");
+  printer->Annotate("mark", key);
+}
+
+// Whether a stub is generated for |method|. Client streaming and bidi
+// streaming methods only get one with the client_streaming option.
+bool HasStub(const FileModel& model, const MethodModel& method) {
+  return model.has_client_streaming || !method.method->client_streaming();
+}
+
+// Returns the name of the kind of |method| in grpc.web.MethodType.
+string MethodTypeName(const MethodDescriptor* method) {
+  if (method->client_streaming()) {
+    return method->server_streaming() ? "BIDI_STREAMING" : "CLIENT_STREAMING";
+  }
+  return method->server_streaming() ? "SERVER_STREAMING" : "UNARY";
+}
+
+// Sets the per-method variables of the Closure and CommonJS templates.
+void SetMethodVars(const MethodModel& method, std::map<string, string>* vars) {
+  (*vars)["js_method_name"] = method.js_method_name;
+  (*vars)["method_name"] = method.method_name;
+  (*vars)["in"] = method.in;
+  (*vars)["out"] = method.out;
+  (*vars)["in_type"] = method.in_type;
+  (*vars)["out_type"] = method.out_type;
+  (*vars)["in_codec"] = CodecName(method.method->input_type());
+  (*vars)["out_codec"] = CodecName(method.method->output_type());
+  (*vars)["method_descriptor"] = method.method_descriptor;
+  (*vars)["path"] = method.path;
+  (*vars)["idempotency_level"] = method.idempotency_level;
+  (*vars)["method_type"] =
+      "grpc.web.MethodType." + MethodTypeName(method.method);
+}
+
+// Prints the optional trailing arguments of the MethodDescriptor constructor:
+// |deserialize_into|, the response deserializer into an earlier response,
+// if not empty, and the idempotency level of the method, if it has one.
+// |grpc_web| is the expression for the grpc-web module.
+void PrintOptionalMethodDescriptorArgs(Printer* printer,
+                                       const string& deserialize_into,
+                                       const string& idempotency_level,
+                                       const string& grpc_web) {
+  if (!deserialize_into.empty()) {
+    printer->Print(",\n$deserialize_into$", "deserialize_into",
+                   deserialize_into);
+  }
+  if (!idempotency_level.empty()) {
+    if (deserialize_into.empty()) {
+      printer->Print(",\nnull");
+    }
+    printer->Print(",\n$grpc_web$.IdempotencyLevel.$level$", "grpc_web",
+                   grpc_web, "level", idempotency_level);
+  }
+}
+
+void PrintClosureDependencies(Printer* printer, const FileModel& model) {
+  for (const Descriptor* message : model.messages) {
     printer->Print("goog.require('proto.$full_name$');\n", "full_name",
-                   entry.second->full_name());
+                   message->full_name());
   }
 }
 
-void PrintCommonJsMessagesDeps(Printer* printer, const FileDescriptor* file) {
+void PrintCommonJsMessagesDeps(Printer* printer, const FileModel& model) {
   std::map<string, string> vars;
 
-  for (int i = 0; i < file->dependency_count(); i++) {
-    const string& name = file->dependency(i)->name();
-    vars["alias"] = ModuleAlias(name);
-    vars["dep_filename"] = GetRootPath(file->name(), name) + StripProto(name);
+  for (const ImportModel& dependency : model.dependency_imports) {
+    vars["alias"] = dependency.alias;
+    vars["dep_filename"] = dependency.dep_filename;
     // we need to give each cross-file import an alias
     printer->Print(vars, "\nvar $alias$ = require('$dep_filename$_pb.js')\n");
   }
 
-  const string& package = file->package();
+  const string& package = model.file->package();
   vars["package_name"] = package;
 
   if (!package.empty()) {
@@ -559,7 +779,7 @@ void PrintCommonJsMessagesDeps(Printer* printer, const FileDescriptor* file) {
   }
 
   // need to import the messages from our own file
-  vars["filename"] = GetBasename(StripProto(file->name()));
+  vars["filename"] = GetBasename(StripProto(model.file->name()));
 
   if (!package.empty()) {
     printer->Print(vars,
@@ -569,89 +789,177 @@ void PrintCommonJsMessagesDeps(Printer* printer, const FileDescriptor* file) {
   }
 }
 
-void PrintES6Imports(Printer* printer, const FileDescriptor* file) {
-  std::map<string, string> vars;
-
-  printer->Print("import * as grpcWeb from 'grpc-web';\n\n");
-
-  std::set<string> imports;
-  for (const auto& entry : GetAllMessages(file)) {
-    const string& proto_filename = entry.second->file()->name();
-    string dep_filename = GetRootPath(file->name(), proto_filename) + StripProto(proto_filename);
-    if (imports.find(dep_filename) != imports.end()) {
-      continue;
-    }
-    imports.insert(dep_filename);
+void PrintImports(Printer* printer, const std::vector<ImportModel>& imports) {
+  for (const ImportModel& import : imports) {
     // We need to give each cross-file import an alias.
     printer->Print("import * as $alias$ from '$dep_filename$_pb'; // proto import: \"$proto_filename$\"\n",
-                   "alias", ModuleAlias(proto_filename),
-                   "dep_filename", dep_filename,
-                   "proto_filename", proto_filename);
+                   "alias", import.alias,
+                   "dep_filename", import.dep_filename,
+                   "proto_filename", import.proto_filename);
   }
   printer->Print("\n\n");
 }
 
-void PrintTypescriptFile(Printer* printer, const FileDescriptor* file,
-                         std::map<string, string> vars) {
-  PrintES6Imports(printer, file);
-  for (int service_index = 0; service_index < file->service_count();
-       ++service_index) {
-    printer->Print("export class ");
-    const ServiceDescriptor* service = file->service(service_index);
-    vars["service_name"] = service->name();
-    printer->Print(vars, "$service_name$Client {\n");
+void PrintES6Imports(Printer* printer, const FileModel& model) {
+  printer->Print("import * as grpcWeb from 'grpc-web';\n\n");
+  PrintImports(printer, model.message_imports);
+}
+
+void PrintTypescriptFile(Printer* printer, const FileModel& model) {
+  std::map<string, string> vars = model.vars;
+  vars["serialize_func_name"] = model.serialize_method_name;
+  vars["deserialize_func_name"] = model.deserialize_method_name;
+
+  PrintES6Imports(printer, model);
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+
+    // The descriptors are shared by all clients of the service and built on
+    // first use, rather than allocated by every client constructor.
+    for (const MethodModel& method_model : service.methods) {
+      const MethodDescriptor* method = method_model.method;
+      if (!HasStub(model, method_model)) {
+        continue;
+      }
+      MarkOutput(printer, method->full_name());
+      vars["method_name"] = method_model.method_name;
+      vars["input_type"] = method_model.ts_in_type;
+      vars["output_type"] = method_model.ts_out_type;
+      vars["method_type"] = "grpcWeb.MethodType." + MethodTypeName(method);
+      printer->Print(vars,
+                     "let methodDescriptor_$service_name$_$method_name$_:\n"
+                     "  grpcWeb.MethodDescriptor<$input_type$, "
+                     "$output_type$> | undefined;\n\n"
+                     "function methodDescriptor_$service_name$_$method_name$()"
+                     ":\n"
+                     "  grpcWeb.MethodDescriptor<$input_type$, "
+                     "$output_type$> {\n");
+      printer->Indent();
+      printer->Print(vars,
+                     "if (methodDescriptor_$service_name$_$method_name$_ === "
+                     "undefined) {\n");
+      printer->Indent();
+      printer->Print(vars,
+                     "methodDescriptor_$service_name$_$method_name$_ = "
+                     "new grpcWeb.MethodDescriptor(\n");
+      printer->Indent();
+      printer->Print(vars,
+                     "'/$package_dot$$service_name$/$method_name$',\n"
+                     "$method_type$,\n"
+                     "$input_type$,\n"
+                     "$output_type$,\n"
+                     "(request: $input_type$) => {\n"
+                     "  return request.$serialize_func_name$();\n"
+                     "},\n"
+                     "$output_type$.$deserialize_func_name$");
+      PrintOptionalMethodDescriptorArgs(printer, "",
+                                        method_model.idempotency_level,
+                                        "grpcWeb");
+      printer->Outdent();
+      printer->Print("\n);\n");
+      printer->Outdent();
+      printer->Print(vars,
+                     "}\n"
+                     "return methodDescriptor_$service_name$_$method_name$_;\n");
+      printer->Outdent();
+      printer->Print("}\n\n");
+    }
+
+    MarkOutput(printer, service.service->full_name());
+    printer->Print(vars, "export class $service_name$Client {\n");
     printer->Indent();
     printer->Print(
         "client_: grpcWeb.AbstractClientBase;\n"
         "hostname_: string;\n"
         "credentials_: null | { [index: string]: string; };\n"
-        "options_: null | { [index: string]: any; };\n\n"
+        "options_: null | { [index: string]: any; };\n"
+        "// The URLs of the methods, by path, built on first use and shared\n"
+        "// by the clients with the same hostname.\n"
+        "urls_: { [path: string]: string; };\n"
+        "private static urlsByHostname_:\n"
+        "    { [hostname: string]: { [path: string]: string; }; } = {};\n"
+        "\n"
         "constructor (hostname: string,\n"
         "             credentials?: null | { [index: string]: string; },\n"
         "             options?: null | { [index: string]: any; }) {\n");
     printer->Indent();
     printer->Print("if (!options) options = {};\n");
     printer->Print("if (!credentials) credentials = {};\n");
-    if (vars["mode"] == GetModeVar(Mode::GRPCWEB)) {
+    if (model.mode == Mode::GRPCWEB) {
       printer->Print(vars, "options['format'] = '$format$';\n\n");
     }
     printer->Print(vars,
                    "this.client_ = new grpcWeb.$mode$ClientBase(options);\n"
                    "this.hostname_ = hostname.replace(/\\/+$$/, '');\n"
                    "this.credentials_ = credentials;\n"
-                   "this.options_ = options;\n");
+                   "this.options_ = options;\n"
+                   "this.urls_ =\n"
+                   "  $service_name$Client.urlsByHostname_[this.hostname_] ||\n"
+                   "  ($service_name$Client.urlsByHostname_[this.hostname_] ="
+                   " {});\n");
     printer->Outdent();
-    printer->Print("}\n\n");
-
-    for (int method_index = 0; method_index < service->method_count();
-         ++method_index) {
-      const MethodDescriptor* method = service->method(method_index);
-      vars["js_method_name"] = LowercaseFirstLetter(method->name());
-      vars["method_name"] = method->name();
-      vars["input_type"] = JSMessageType(method->input_type());
-      vars["output_type"] = JSMessageType(method->output_type());
-      vars["serialize_func_name"] = GetSerializeMethodName(vars);
-      vars["deserialize_func_name"] = GetDeserializeMethodName(vars);
-      vars["method_type"] = method->server_streaming()
-                                ? "grpcWeb.MethodType.SERVER_STREAMING"
-                                : "grpcWeb.MethodType.UNARY";
-      if (!method->client_streaming()) {
-        printer->Print(vars,
-                       "methodDescriptor$method_name$ = "
-                       "new grpcWeb.MethodDescriptor(\n");
-        printer->Indent();
+    printer->Print("}\n\n"
+                   "private url_(path: string): string {\n"
+                   "  return this.urls_[path] ||\n"
+                   "    (this.urls_[path] = this.hostname_ + path);\n"
+                   "}\n\n");
+
+    for (const MethodModel& method_model : service.methods) {
+      const MethodDescriptor* method = method_model.method;
+      vars["js_method_name"] = method_model.js_method_name;
+      vars["method_name"] = method_model.method_name;
+      vars["input_type"] = method_model.ts_in_type;
+      vars["output_type"] = method_model.ts_out_type;
+      // Unlike |method_model.path|, without the /$rpc/ prefix of the jspb
+      // mode, which TypeScript clients have never used.
+      vars["path"] =
+          "/" + method->service()->full_name() + "/" + method->name();
+      if (HasStub(model, method_model)) {
+        MarkOutput(printer, method->full_name());
+        // Kept for code that reads the descriptor from a client instance.
         printer->Print(vars,
-                       "'/$package_dot$$service_name$/$method_name$',\n"
-                       "$method_type$,\n"
-                       "$input_type$,\n"
-                       "$output_type$,\n"
-                       "(request: $input_type$) => {\n"
-                       "  return request.$serialize_func_name$();\n"
-                       "},\n"
-                       "$output_type$.$deserialize_func_name$\n");
-        printer->Outdent();
-        printer->Print(");\n\n");
-        if (method->server_streaming()) {
+                       "get methodDescriptor$method_name$(): "
+                       "grpcWeb.MethodDescriptor<\n"
+                       "    $input_type$, $output_type$> {\n"
+                       "  return methodDescriptor_$service_name$_"
+                       "$method_name$();\n"
+                       "}\n\n");
+        if (method->client_streaming() && !method->server_streaming()) {
+          printer->Print(vars, "$js_method_name$(\n");
+          printer->Indent();
+          printer->Print(vars,
+                         "metadata?: grpcWeb.Metadata | null,\n"
+                         "callback?: (err: grpcWeb.RpcError,\n"
+                         "           response: $output_type$) => void): "
+                         "grpcWeb.ClientDuplexStream<$input_type$, "
+                         "$output_type$> {\n");
+          printer->Print(vars, "return this.client_.clientStreaming(\n");
+          printer->Indent();
+          printer->Print(vars,
+                         "this.url_('$path$'),\n"
+                         "metadata || {},\n"
+                         "methodDescriptor_$service_name$_$method_name$(),\n"
+                         "callback);\n");
+          printer->Outdent();
+          printer->Outdent();
+          printer->Print("}\n\n");
+        } else if (method->client_streaming()) {
+          printer->Print(vars, "$js_method_name$(\n");
+          printer->Indent();
+          printer->Print(vars,
+                         "metadata?: grpcWeb.Metadata): "
+                         "grpcWeb.ClientDuplexStream<$input_type$, "
+                         "$output_type$> {\n");
+          printer->Print(vars, "return this.client_.bidiStreaming(\n");
+          printer->Indent();
+          printer->Print(vars,
+                         "this.url_('$path$'),\n"
+                         "metadata || {},\n"
+                         "methodDescriptor_$service_name$_$method_name$());\n");
+          printer->Outdent();
+          printer->Outdent();
+          printer->Print("}\n\n");
+        } else if (method->server_streaming()) {
           printer->Print(vars, "$js_method_name$(\n");
           printer->Indent();
           printer->Print(vars,
@@ -661,11 +969,10 @@ void PrintTypescriptFile(Printer* printer, const FileDescriptor* file,
           printer->Print(vars, "return this.client_.serverStreaming(\n");
           printer->Indent();
           printer->Print(vars,
-                         "this.hostname_ +\n"
-                         "  '/$package_dot$$service_name$/$method_name$',\n"
+                         "this.url_('$path$'),\n"
                          "request,\n"
                          "metadata || {},\n"
-                         "this.methodDescriptor$method_name$);\n");
+                         "methodDescriptor_$service_name$_$method_name$());\n");
           printer->Outdent();
           printer->Outdent();
           printer->Print("}\n\n");
@@ -700,11 +1007,10 @@ void PrintTypescriptFile(Printer* printer, const FileDescriptor* file,
           printer->Print(vars, "return this.client_.rpcCall(\n");
           printer->Indent();
           printer->Print(vars,
-                         "this.hostname_ +\n"
-                         "  '/$package_dot$$service_name$/$method_name$',\n"
+                         "this.url_('$path$'),\n"
                          "request,\n"
                          "metadata || {},\n"
-                         "this.methodDescriptor$method_name$,\n"
+                         "methodDescriptor_$service_name$_$method_name$(),\n"
                          "callback);\n");
           printer->Outdent();
           printer->Outdent();
@@ -712,44 +1018,204 @@ void PrintTypescriptFile(Printer* printer, const FileDescriptor* file,
                          "}\n"
                          "return this.client_.unaryCall(\n");
           printer->Print(vars,
-                         "this.hostname_ +\n"
-                         "  '/$package_dot$$service_name$/$method_name$',\n"
+                         "this.url_('$path$'),\n"
                          "request,\n"
                          "metadata || {},\n"
-                         "this.methodDescriptor$method_name$);\n");
+                         "methodDescriptor_$service_name$_$method_name$());\n");
           printer->Outdent();
           printer->Print("}\n\n");
         }
       }
     }
+    MarkOutput(printer, service.service->full_name());
+    printer->Outdent();
+    printer->Print("}\n\n");
+  }
+}
+
+// Prints an ES module with one exported MethodDescriptor and one exported
+// function per method, and no prototype or module-scope side effects, so that
+// bundlers can drop the methods an application never calls.
+void PrintEsModuleFile(Printer* printer, const FileModel& model) {
+  std::map<string, string> vars = model.vars;
+  vars["serialize_func_name"] = model.serialize_method_name;
+  vars["deserialize_func_name"] = model.deserialize_method_name;
+
+  PrintES6Imports(printer, model);
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+    MarkOutput(printer, service.service->full_name());
+    printer->Print(
+        vars,
+        "/**\n"
+        " * Creates the client passed to the $service_name$ functions below.\n"
+        " * $service_name$Client instances of the other import styles work\n"
+        " * as well.\n"
+        " * @param {string} hostname\n"
+        " * @param {?Object=} credentials\n"
+        " * @param {?Object=} options\n"
+        " * @return {{client_: !grpcWeb.AbstractClientBase, "
+        "hostname_: string}}\n"
+        " */\n"
+        "export function create$service_name$Client(hostname, credentials, "
+        "options) {\n");
+    printer->Indent();
+    printer->Print("if (!options) options = {};\n");
+    if (model.mode == Mode::GRPCWEB) {
+      printer->Print(vars, "options['format'] = '$format$';\n");
+    }
+    printer->Print(vars,
+                   "return {\n"
+                   "  client_: new grpcWeb.$mode$ClientBase(options),\n"
+                   "  hostname_: hostname.replace(/\\/+$$/, ''),\n"
+                   "};\n");
     printer->Outdent();
     printer->Print("}\n\n");
+
+    for (const MethodModel& method_model : service.methods) {
+      const MethodDescriptor* method = method_model.method;
+      if (method->client_streaming()) {
+        continue;
+      }
+      MarkOutput(printer, method->full_name());
+      vars["js_method_name"] = method_model.js_method_name;
+      vars["method_name"] = method_model.method_name;
+      vars["input_type"] = method_model.ts_in_type;
+      vars["output_type"] = method_model.ts_out_type;
+      vars["method_type"] = "grpcWeb.MethodType." + MethodTypeName(method);
+
+      printer->Print(vars,
+                     "export const methodDescriptor_$service_name$_"
+                     "$method_name$ =\n"
+                     "  /*#__PURE__*/ new grpcWeb.MethodDescriptor(\n");
+      printer->Indent();
+      printer->Indent();
+      printer->Print(vars,
+                     "'/$package_dot$$service_name$/$method_name$',\n"
+                     "$method_type$,\n"
+                     "$input_type$,\n"
+                     "$output_type$,\n"
+                     "(request) => {\n"
+                     "  return request.$serialize_func_name$();\n"
+                     "},\n"
+                     "(bytes) => {\n"
+                     "  return $output_type$.$deserialize_func_name$(bytes);\n"
+                     "}");
+      PrintOptionalMethodDescriptorArgs(printer, "",
+                                        method_model.idempotency_level,
+                                        "grpcWeb");
+      printer->Print(");\n\n");
+      printer->Outdent();
+      printer->Outdent();
+
+      if (method->server_streaming()) {
+        printer->Print(
+            vars,
+            "/**\n"
+            " * @param {{client_: !grpcWeb.AbstractClientBase, "
+            "hostname_: string}} client\n"
+            " * @param {!$input_type$} request\n"
+            " * @param {?Object<string, string>=} metadata\n"
+            " * @return {!grpcWeb.ClientReadableStream<!$output_type$>}\n"
+            " */\n"
+            "export function $service_name$_$js_method_name$(client, request, "
+            "metadata) {\n");
+        printer->Indent();
+        printer->Print(vars,
+                       "return client.client_.serverStreaming(\n"
+                       "  client.hostname_ +\n"
+                       "    '/$package_dot$$service_name$/$method_name$',\n"
+                       "  request,\n"
+                       "  metadata || {},\n"
+                       "  methodDescriptor_$service_name$_$method_name$);\n");
+        printer->Outdent();
+        printer->Print("}\n\n");
+      } else {
+        printer->Print(
+            vars,
+            "/**\n"
+            " * Returns a promise of the response unless a callback is "
+            "given.\n"
+            " * @param {{client_: !grpcWeb.AbstractClientBase, "
+            "hostname_: string}} client\n"
+            " * @param {!$input_type$} request\n"
+            " * @param {?Object<string, string>=} metadata\n"
+            " * @param {function(?grpcWeb.RpcError, ?$output_type$)=} "
+            "callback\n"
+            " * @return {!$promise$<!$output_type$>|"
+            "!grpcWeb.ClientReadableStream<!$output_type$>}\n"
+            " */\n"
+            "export function $service_name$_$js_method_name$(client, request, "
+            "metadata, callback) {\n");
+        printer->Indent();
+        printer->Print(vars, "if (callback !== undefined) {\n");
+        printer->Indent();
+        printer->Print(vars,
+                       "return client.client_.rpcCall(\n"
+                       "  client.hostname_ +\n"
+                       "    '/$package_dot$$service_name$/$method_name$',\n"
+                       "  request,\n"
+                       "  metadata || {},\n"
+                       "  methodDescriptor_$service_name$_$method_name$,\n"
+                       "  callback);\n");
+        printer->Outdent();
+        printer->Print("}\n");
+        printer->Print(vars,
+                       "return client.client_.unaryCall(\n"
+                       "  client.hostname_ +\n"
+                       "    '/$package_dot$$service_name$/$method_name$',\n"
+                       "  request,\n"
+                       "  metadata || {},\n"
+                       "  methodDescriptor_$service_name$_$method_name$);\n");
+        printer->Outdent();
+        printer->Print("}\n\n");
+      }
+    }
   }
 }
 
-void PrintGrpcWebDtsClientClass(Printer* printer, const FileDescriptor* file,
+void PrintGrpcWebDtsClientClass(Printer* printer, const FileModel& model,
                                 const string& client_type) {
   std::map<string, string> vars;
   vars["client_type"] = client_type;
   vars["promise"] = "Promise";
-  for (int service_index = 0; service_index < file->service_count();
-       ++service_index) {
+  for (const ServiceModel& service : model.services) {
     printer->Print("export class ");
-    const ServiceDescriptor* service = file->service(service_index);
-    vars["service_name"] = service->name();
+    vars["service_name"] = service.service_name;
     printer->Print(vars, "$service_name$$client_type$ {\n");
     printer->Indent();
     printer->Print(
         "constructor (hostname: string,\n"
         "             credentials?: null | { [index: string]: string; },\n"
         "             options?: null | { [index: string]: any; });\n\n");
-    for (int method_index = 0; method_index < service->method_count();
-         ++method_index) {
-      const MethodDescriptor* method = service->method(method_index);
-      vars["js_method_name"] = LowercaseFirstLetter(method->name());
-      vars["input_type"] = JSMessageType(method->input_type());
-      vars["output_type"] = JSMessageType(method->output_type());
-      if (!method->client_streaming()) {
+    for (const MethodModel& method_model : service.methods) {
+      const MethodDescriptor* method = method_model.method;
+      vars["js_method_name"] = method_model.js_method_name;
+      vars["input_type"] = method_model.ts_in_type;
+      vars["output_type"] = method_model.ts_out_type;
+      if (model.plain_codecs) {
+        vars["input_type"] += ".AsObject";
+        vars["output_type"] += ".AsObject";
+      }
+      if (method->client_streaming()) {
+        if (model.has_client_streaming) {
+          printer->Print(vars, "$js_method_name$(\n");
+          printer->Indent();
+          if (method->server_streaming() ||
+              vars["client_type"] == "PromiseClient") {
+            printer->Print("metadata?: grpcWeb.Metadata\n");
+          } else {
+            printer->Print(vars,
+                           "metadata?: grpcWeb.Metadata,\n"
+                           "callback?: (err: grpcWeb.RpcError,\n"
+                           "            response: $output_type$) => void\n");
+          }
+          printer->Outdent();
+          printer->Print(vars,
+                         "): grpcWeb.ClientDuplexStream<$input_type$, "
+                         "$output_type$>;\n\n");
+        }
+      } else {
         if (method->server_streaming()) {
           printer->Print(vars, "$js_method_name$(\n");
           printer->Indent();
@@ -789,10 +1255,10 @@ void PrintGrpcWebDtsClientClass(Printer* printer, const FileDescriptor* file,
   }
 }
 
-void PrintGrpcWebDtsFile(Printer* printer, const FileDescriptor* file) {
-  PrintES6Imports(printer, file);
-  PrintGrpcWebDtsClientClass(printer, file, "Client");
-  PrintGrpcWebDtsClientClass(printer, file, "PromiseClient");
+void PrintGrpcWebDtsFile(Printer* printer, const FileModel& model) {
+  PrintES6Imports(printer, model);
+  PrintGrpcWebDtsClientClass(printer, model, "Client");
+  PrintGrpcWebDtsClientClass(printer, model, "PromiseClient");
 }
 
 void PrintProtoDtsEnum(Printer* printer, const EnumDescriptor* desc) {
@@ -961,18 +1427,10 @@ void PrintProtoDtsMessage(Printer* printer, const Descriptor* desc,
   printer->Print("}\n\n");
 }
 
-void PrintProtoDtsFile(Printer* printer, const FileDescriptor* file) {
+void PrintProtoDtsFile(Printer* printer, const FileModel& model) {
+  const FileDescriptor* file = model.file;
   printer->Print("import * as jspb from 'google-protobuf'\n\n");
-
-  for (int i = 0; i < file->dependency_count(); i++) {
-    const string& proto_filename = file->dependency(i)->name();
-    // We need to give each cross-file import an alias.
-    printer->Print("import * as $alias$ from '$dep_filename$_pb'; // proto import: \"$proto_filename$\"\n",
-                   "alias", ModuleAlias(proto_filename),
-                   "dep_filename", GetRootPath(file->name(), proto_filename) + StripProto(proto_filename),
-                   "proto_filename", proto_filename);
-  }
-  printer->Print("\n\n");
+  PrintImports(printer, model.dependency_imports);
 
   for (int i = 0; i < file->message_type_count(); i++) {
     PrintProtoDtsMessage(printer, file->message_type(i), file);
@@ -983,11 +1441,14 @@ void PrintProtoDtsFile(Printer* printer, const FileDescriptor* file) {
   }
 }
 
-void PrintFileHeader(Printer* printer, const std::map<string, string>& vars) {
+void PrintFileHeader(Printer* printer, const std::map<string, string>& vars,
+                     const string& contents = "client stub") {
+  std::map<string, string> header_vars = vars;
+  header_vars["contents"] = contents;
   printer->Print(
-      vars,
+      header_vars,
       "/**\n"
-      " * @fileoverview gRPC-Web generated client stub for $package$\n"
+      " * @fileoverview gRPC-Web generated $contents$ for $package$\n"
       " * @enhanceable\n"
       " * @public\n"
       " */\n\n"
@@ -1000,16 +1461,18 @@ void PrintFileHeader(Printer* printer, const std::map<string, string>& vars) {
       "// @ts-nocheck\n\n\n");
 }
 
-void PrintMethodDescriptorFile(Printer* printer,
-                               std::map<string, string> vars) {
+void PrintMethodDescriptorFile(Printer* printer, const FileModel& model,
+                               const MethodModel& method,
+                               const std::map<string, string>& vars) {
   printer->Print(
       vars,
       "/**\n"
       " * @fileoverview gRPC-Web generated MethodDescriptors for $package$\n");
-  if (vars["plugins"].empty()) {
+  if (vars.at("plugins").empty()) {
     printer->Print(" * @enhanceable\n");
   }
   printer->Print(
+      vars,
       " * @public\n"
       " */\n\n"
       "// Code generated by protoc-gen-grpc-web. DO NOT EDIT.\n"
@@ -1023,15 +1486,18 @@ void PrintMethodDescriptorFile(Printer* printer,
   printer->Print(vars,
                  "goog.provide('proto.$package_dot$$class_name$.$"
                  "method_name$MethodDescriptor');\n\n");
-  if (!vars["plugins"].empty()) {
+  if (!vars.at("plugins").empty()) {
     printer->Print(vars,
                    "goog.require('$plugins$.$package_dot$$class_name$.$"
                    "method_name$MethodDescriptor');\n");
   }
   printer->Print(vars, "goog.require('grpc.web.MethodDescriptor');\n");
   printer->Print(vars, "goog.require('grpc.web.MethodType');\n");
+  if (!method.idempotency_level.empty()) {
+    printer->Print(vars, "goog.require('grpc.web.IdempotencyLevel');\n");
+  }
   printer->Print(vars, "goog.require('$in_type$');\n");
-  if (vars["out_type"] != vars["in_type"]) {
+  if (method.out_type != method.in_type) {
     printer->Print(vars, "goog.require('$out_type$');\n");
   }
   printer->Print(vars, "\n\ngoog.scope(function() {\n\n");
@@ -1059,15 +1525,17 @@ void PrintMethodDescriptorFile(Printer* printer,
                  "/**\n"
                  " * @param {!proto.$in$} request\n");
   printer->Print(
-      (" * @return {" + GetSerializeMethodReturnType(vars) + "}\n").c_str());
+      (" * @return {" + model.serialize_return_type + "}\n").c_str());
   printer->Print(
       " */\n"
       "function(request) {\n");
   printer->Print(
-      ("  return request." + GetSerializeMethodName(vars) + "();\n").c_str());
+      ("  return request." + model.serialize_method_name + "();\n").c_str());
   printer->Print("},\n");
   printer->Print(vars,
-                 ("$out_type$." + GetDeserializeMethodName(vars)).c_str());
+                 ("$out_type$." + model.deserialize_method_name).c_str());
+  PrintOptionalMethodDescriptorArgs(printer, "", method.idempotency_level,
+                                    "grpc.web");
   printer->Print(vars, ");\n\n\n");
   printer->Outdent();
   printer->Outdent();
@@ -1076,10 +1544,11 @@ void PrintMethodDescriptorFile(Printer* printer,
   printer->Print("}); // goog.scope\n\n");
 }
 
-void PrintServiceConstructor(Printer* printer, std::map<string, string> vars,
-                             bool is_promise) {
-  vars["is_promise"] = is_promise ? "Promise" : "";
-  printer->Print(vars,
+void PrintServiceConstructor(Printer* printer, const FileModel& model,
+                             const ServiceModel& service,
+                             std::map<string, string>* vars, bool is_promise) {
+  (*vars)["is_promise"] = is_promise ? "Promise" : "";
+  printer->Print(*vars,
                  "/**\n"
                  " * @param {string} hostname\n"
                  " * @param {?Object} credentials\n"
@@ -1091,12 +1560,12 @@ void PrintServiceConstructor(Printer* printer, std::map<string, string> vars,
                  "proto.$package_dot$$service_name$$is_promise$Client =\n"
                  "    function(hostname, credentials, options) {\n"
                  "  if (!options) options = {};\n");
-  if (vars["mode"] == GetModeVar(Mode::GRPCWEB)) {
-    printer->Print(vars, "  options.format = '$format$';\n\n");
+  if (model.mode == Mode::GRPCWEB) {
+    printer->Print(*vars, "  options.format = '$format$';\n\n");
   }
-  if (vars["mode"] == GetModeVar(Mode::OP)) {
+  if (model.mode == Mode::OP) {
     printer->Print(
-        vars,
+        *vars,
         "  /**\n"
         "   * @private @const {!grpc.web.$mode$ClientBase} The client\n"
         "   */\n"
@@ -1104,7 +1573,7 @@ void PrintServiceConstructor(Printer* printer, std::map<string, string> vars,
         "$binary$);\n\n");
   } else {
     printer->Print(
-        vars,
+        *vars,
         "  /**\n"
         "   * @private @const {!grpc.web.$mode$ClientBase} The client\n"
         "   */\n"
@@ -1114,672 +1583,2424 @@ void PrintServiceConstructor(Printer* printer, std::map<string, string> vars,
                  "  /**\n"
                  "   * @private @const {string} The hostname\n"
                  "   */\n"
-                 "  this.hostname_ = hostname.replace(/\\/+$/, '');\n\n"
-                 "};\n\n\n");
-}
-
-void PrintMethodDescriptor(Printer* printer, std::map<string, string> vars) {
-  printer->Print(vars,
-                 "/**\n"
-                 " * @const\n"
-                 " * @type {!grpc.web.MethodDescriptor<\n"
-                 " *   !proto.$in$,\n"
-                 " *   !proto.$out$>}\n"
-                 " */\n"
-                 "const methodDescriptor_$service_name$_$method_name$ = "
-                 "new grpc.web.MethodDescriptor(\n");
-  printer->Indent();
-  printer->Print(vars,
-                 "'/$package_dot$$service_name$/$method_name$',\n"
-                 "$method_type$,\n"
-                 "$in_type$,\n");
-  printer->Print(vars,
-                 "$out_type$,\n"
-                 "/**\n"
-                 " * @param {!proto.$in$} request\n");
-  printer->Print(
-      (" * @return {" + GetSerializeMethodReturnType(vars) + "}\n").c_str());
+                 "  this.hostname_ = hostname.replace(/\\/+$/, '');\n\n");
   printer->Print(
+      *vars,
+      "  /**\n"
+      "   * @private @const {!Object<string, string>} The URLs of the "
+      "methods,\n"
+      "   *     by path, built on first use and shared by the clients with "
+      "the\n"
+      "   *     same hostname\n"
+      "   */\n"
+      "  this.urls_ =\n"
+      "      proto.$package_dot$$service_name$$is_promise$Client"
+      ".urlsByHostname_[\n"
+      "          this.hostname_] ||\n"
+      "      (proto.$package_dot$$service_name$$is_promise$Client"
+      ".urlsByHostname_[\n"
+      "           this.hostname_] = {});\n"
+      "};\n\n\n"
+      "/**\n"
+      " * @private @const {!Object<string, !Object<string, string>>} The "
+      "urls_ of\n"
+      " *     the clients, by hostname\n"
       " */\n"
-      "function(request) {\n");
-  printer->Print(
-      ("  return request." + GetSerializeMethodName(vars) + "();\n").c_str());
-  printer->Print("},\n");
-  printer->Print(
-      vars, ("$out_type$." + GetDeserializeMethodName(vars) + "\n").c_str());
-  printer->Outdent();
-  printer->Print(vars, ");\n\n\n");
-}
-
-void PrintUnaryCall(Printer* printer, std::map<string, string> vars) {
+      "proto.$package_dot$$service_name$$is_promise$Client.urlsByHostname_ = "
+      "{};\n\n\n");
+  if (model.compact_method_tables) {
+    // The dispatcher looks the URLs up itself.
+    return;
+  }
   printer->Print(
-      vars,
+      *vars,
       "/**\n"
-      " * @param {!proto.$in$} request The\n"
-      " *     request proto\n"
-      " * @param {?Object<string, string>} metadata User defined\n"
-      " *     call metadata\n"
-      " * @param {function(?grpc.web.RpcError,"
-      " ?proto.$out$)}\n"
-      " *     callback The callback function(error, response)\n"
-      " * @return {!grpc.web.ClientReadableStream<!proto.$out$>|undefined}\n"
-      " *     The XHR Node Readable Stream\n"
+      " * @param {string} path The path of a method\n"
+      " * @return {string} The URL of the method\n"
+      " * @private\n"
       " */\n"
-      "proto.$package_dot$$service_name$Client.prototype.$js_method_name$ =\n");
-  printer->Indent();
-  printer->Print(vars,
-                 "  function(request, metadata, callback) {\n"
-                 "return this.client_.rpcCall(this.hostname_ +\n");
-  printer->Indent();
-  printer->Indent();
-  if (vars["mode"] == GetModeVar(Mode::OP)) {
-    printer->Print(vars,
-                   "'/$$rpc/$package_dot$$service_name$/$method_name$',\n");
-  } else {
-    printer->Print(vars, "'/$package_dot$$service_name$/$method_name$',\n");
-  }
-  printer->Print(vars,
-                 "request,\n"
-                 "metadata || {},\n"
-                 "$method_descriptor$,\n"
-                 "callback);\n");
-  printer->Outdent();
-  printer->Outdent();
-  printer->Outdent();
-  printer->Print("};\n\n\n");
+      "proto.$package_dot$$service_name$$is_promise$Client.prototype.url_ =\n"
+      "    function(path) {\n"
+      "  return this.urls_[path] || (this.urls_[path] = this.hostname_ + "
+      "path);\n"
+      "};\n\n\n");
 }
 
-void PrintPromiseUnaryCall(Printer* printer, std::map<string, string> vars) {
-  printer->Print(vars,
-                 "/**\n"
-                 " * @param {!proto.$in$} request The\n"
-                 " *     request proto\n"
-                 " * @param {?Object<string, string>=} metadata User defined\n"
-                 " *     call metadata\n"
-                 " * @return {!$promise$<!proto.$out$>}\n"
-                 " *     Promise that resolves to the response\n"
-                 " */\n"
-                 "proto.$package_dot$$service_name$PromiseClient.prototype"
-                 ".$js_method_name$ =\n");
-  printer->Indent();
-  printer->Print(vars,
-                 "  function(request, metadata) {\n"
-                 "return this.client_.unaryCall(this.hostname_ +\n");
-  printer->Indent();
-  printer->Indent();
-  if (vars["mode"] == GetModeVar(Mode::OP)) {
-    printer->Print(vars,
-                   "'/$$rpc/$package_dot$$service_name$/$method_name$',\n");
-  } else {
-    printer->Print(vars, "'/$package_dot$$service_name$/$method_name$',\n");
+// Returns the property holding |field| in plain objects, which have the shape
+// of the AsObject types in the .d.ts output.
+string PlainFieldName(const FieldDescriptor* field) {
+  string name = CamelCaseJSFieldName(field);
+  if (IsReserved(name)) {
+    name = "pb_" + name;
   }
-  printer->Print(vars,
-                 "request,\n"
-                 "metadata || {},\n"
-                 "$method_descriptor$);\n");
-  printer->Outdent();
-  printer->Outdent();
-  printer->Outdent();
-  printer->Print("};\n\n\n");
+  return name;
 }
 
-void PrintServerStreamingCall(Printer* printer, std::map<string, string> vars) {
-  printer->Print(vars,
-                 "/**\n"
-                 " * @param {!proto.$in$} request The request proto\n"
-                 " * @param {?Object<string, string>=} metadata User defined\n"
-                 " *     call metadata\n"
-                 " * @return {!grpc.web.ClientReadableStream<!proto.$out$>}\n"
-                 " *     The XHR Node Readable Stream\n"
-                 " */\n"
-                 "proto.$package_dot$$service_name$$client_type$.prototype."
-                 "$js_method_name$ =\n");
-  printer->Indent();
+// Returns the grpc.web.WireReader and grpc.web.WireWriter method for the
+// values of |field|, or empty for messages.
+string WireMethod(const FieldDescriptor* field) {
+  string suffix =
+      field->options().jstype() == FieldOptions::JS_STRING ? "String" : "";
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_DOUBLE:
+      return "double";
+    case FieldDescriptor::TYPE_FLOAT:
+      return "float";
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_ENUM:
+      return "int32";
+    case FieldDescriptor::TYPE_UINT32:
+      return "uint32";
+    case FieldDescriptor::TYPE_SINT32:
+      return "sint32";
+    case FieldDescriptor::TYPE_FIXED32:
+      return "fixed32";
+    case FieldDescriptor::TYPE_SFIXED32:
+      return "sfixed32";
+    case FieldDescriptor::TYPE_INT64:
+      return "int64" + suffix;
+    case FieldDescriptor::TYPE_UINT64:
+      return "uint64" + suffix;
+    case FieldDescriptor::TYPE_SINT64:
+      return "sint64" + suffix;
+    case FieldDescriptor::TYPE_FIXED64:
+      return "fixed64" + suffix;
+    case FieldDescriptor::TYPE_SFIXED64:
+      return "sfixed64" + suffix;
+    case FieldDescriptor::TYPE_BOOL:
+      return "bool";
+    case FieldDescriptor::TYPE_STRING:
+      return "string";
+    case FieldDescriptor::TYPE_BYTES:
+      return "bytes";
+    default:
+      return "";
+  }
+}
+
+string FieldTag(const FieldDescriptor* field, WireFormatLite::WireType type) {
+  return std::to_string(WireFormatLite::MakeTag(field->number(), type));
+}
+
+// Returns the tag of each value of |field| when it is not packed.
+string FieldTag(const FieldDescriptor* field) {
+  return FieldTag(field, WireFormatLite::WireTypeForFieldType(
+                             static_cast<WireFormatLite::FieldType>(
+                                 field->type())));
+}
+
+// Returns the value of |field| in a message without it on the wire.
+string PlainDefaultValue(const FieldDescriptor* field) {
+  if (field->is_repeated()) {
+    return "[]";
+  }
+  if (field->has_presence()) {
+    return "undefined";
+  }
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_STRING:
+      return field->type() == FieldDescriptor::TYPE_BYTES ? "new Uint8Array(0)"
+                                                          : "''";
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return "false";
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT64:
+      if (field->options().jstype() == FieldOptions::JS_STRING) {
+        return "'0'";
+      }
+      return "0";
+    default:
+      return "0";
+  }
+}
+
+// Returns the condition under which the encoder writes |value|, the value of
+// |field|. Fields without presence are not written when they hold their
+// default value.
+string PlainEncodeCondition(const FieldDescriptor* field,
+                            const string& value) {
+  if (field->is_repeated()) {
+    return value + " != null && " + value + ".length > 0";
+  }
+  if (field->has_presence()) {
+    return value + " != null";
+  }
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_FLOAT:
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return value + " != null && " + value + " !== 0";
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_UINT64:
+      if (field->options().jstype() == FieldOptions::JS_STRING) {
+        return value + " && " + value + " !== '0'";
+      }
+      return value;
+    case FieldDescriptor::CPPTYPE_STRING:
+      if (field->type() == FieldDescriptor::TYPE_BYTES) {
+        return value + " != null && " + value + ".length > 0";
+      }
+      return value;
+    default:
+      return value;
+  }
+}
+
+// Prints the statements writing |value| without its tag.
+void PrintPlainEncodeValue(Printer* printer, const FieldDescriptor* field,
+                           const string& value) {
+  if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+    printer->Print(
+        "const start = writer.fork();\n"
+        "encode_$codec_name$($value$, writer);\n"
+        "writer.ldelim(start);\n",
+        "codec_name", CodecName(field->message_type()), "value", value);
+  } else {
+    printer->Print("writer.$method$($value$);\n", "method", WireMethod(field),
+                   "value", value);
+  }
+}
+
+// Returns the expression reading a value of |field| that is not a message.
+string PlainDecodeValue(const FieldDescriptor* field) {
+  return "reader." + WireMethod(field) + "()";
+}
+
+// Prints encode_<message>(), which writes a plain object in the protocol
+// buffer wire format. Map entries are written from [key, value] pairs.
+void PrintPlainEncoder(Printer* printer, const Descriptor* desc) {
+  bool map_entry = desc->options().map_entry();
   printer->Print(
-      "  function(request, metadata) {\n"
-      "return this.client_.serverStreaming(this.hostname_ +\n");
+      "/**\n"
+      " * Writes |message|, a $full_name$, in the protocol buffer wire format.\n"
+      " * @param {$type$} message\n"
+      " * @param {!grpc.web.WireWriter} writer\n"
+      " */\n"
+      "function encode_$codec_name$(message, writer) {\n",
+      "full_name", desc->full_name(), "type", map_entry ? "!Array" : "!Object",
+      "codec_name", CodecName(desc));
   printer->Indent();
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    string value = map_entry ? "message[" + std::to_string(i) + "]"
+                             : "message." + PlainFieldName(field);
+    printer->Print("if ($condition$) {\n", "condition",
+                   PlainEncodeCondition(field, value));
+    printer->Indent();
+    if (!field->is_repeated()) {
+      printer->Print("writer.uint32($tag$);\n", "tag", FieldTag(field));
+      PrintPlainEncodeValue(printer, field, value);
+    } else if (field->is_packed()) {
+      printer->Print(
+          "writer.uint32($tag$);\n"
+          "const start = writer.fork();\n"
+          "for (const value of $values$) {\n"
+          "  writer.$method$(value);\n"
+          "}\n"
+          "writer.ldelim(start);\n",
+          "tag", FieldTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED),
+          "values", value, "method", WireMethod(field));
+    } else {
+      printer->Print("for (const value of $values$) {\n", "values", value);
+      printer->Indent();
+      printer->Print("writer.uint32($tag$);\n", "tag", FieldTag(field));
+      PrintPlainEncodeValue(printer, field, "value");
+      printer->Outdent();
+      printer->Print("}\n");
+    }
+    printer->Outdent();
+    printer->Print("}\n");
+  }
+  printer->Outdent();
+  printer->Print("}\n\n\n");
+}
+
+// Prints decode_<message>(), which reads a plain object from the protocol
+// buffer wire format. Unknown fields are skipped. Map entries are read as
+// [key, value] pairs.
+void PrintPlainDecoder(Printer* printer, const Descriptor* desc) {
+  bool map_entry = desc->options().map_entry();
+  std::map<string, string> vars;
+  vars["full_name"] = desc->full_name();
+  vars["type"] = map_entry ? "!Array" : "!Object";
+  vars["codec_name"] = CodecName(desc);
+  printer->Print(
+      vars,
+      "/**\n"
+      " * Reads a $full_name$ in the protocol buffer wire format, up to |end|.\n"
+      " * @param {!grpc.web.WireReader} reader\n"
+      " * @param {number} end\n"
+      " * @param {$type$=} opt_message A decoded message to merge the fields\n"
+      " *     into.\n"
+      " * @return {$type$}\n"
+      " */\n"
+      "function decode_$codec_name$(reader, end, opt_message) {\n");
   printer->Indent();
-  if (vars["mode"] == GetModeVar(Mode::OP)) {
-    printer->Print(vars,
-                   "'/$$rpc/$package_dot$$service_name$/$method_name$',\n");
+  if (map_entry) {
+    printer->Print("const message = opt_message || [$key$, $value$];\n", "key",
+                   PlainDefaultValue(desc->field(0)), "value",
+                   PlainDefaultValue(desc->field(1)));
+  } else if (desc->field_count() == 0) {
+    printer->Print("const message = opt_message || {};\n");
   } else {
-    printer->Print(vars, "'/$package_dot$$service_name$/$method_name$',\n");
+    // Every field is set up front so that all messages of a type share a
+    // shape.
+    printer->Print("const message = opt_message || {\n");
+    printer->Indent();
+    for (int i = 0; i < desc->field_count(); i++) {
+      const FieldDescriptor* field = desc->field(i);
+      printer->Print("$name$: $value$,\n", "name", PlainFieldName(field),
+                     "value", PlainDefaultValue(field));
+    }
+    printer->Outdent();
+    printer->Print("};\n");
   }
-  printer->Print(vars,
-                 "request,\n"
-                 "metadata || {},\n"
-                 "$method_descriptor$);\n");
+
+  printer->Print(
+      "while (reader.pos < end) {\n"
+      "  const tag = reader.uint32();\n"
+      "  switch (tag) {\n");
+  printer->Indent();
+  printer->Indent();
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    vars["target"] = map_entry ? "message[" + std::to_string(i) + "]"
+                               : "message." + PlainFieldName(field);
+    vars["tag"] = FieldTag(field);
+    if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      vars["codec_name"] = CodecName(field->message_type());
+    } else {
+      vars["read"] = PlainDecodeValue(field);
+    }
+
+    printer->Print(vars, "case $tag$:\n");
+    printer->Indent();
+    const OneofDescriptor* oneof = field->real_containing_oneof();
+    if (oneof != nullptr) {
+      for (int j = 0; j < oneof->field_count(); j++) {
+        if (oneof->field(j) != field) {
+          printer->Print("message.$name$ = undefined;\n", "name",
+                         PlainFieldName(oneof->field(j)));
+        }
+      }
+    }
+    if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      if (field->is_repeated()) {
+        printer->Print(
+            vars,
+            "$target$.push(decode_$codec_name$(reader, reader.limit()));\n");
+      } else {
+        printer->Print(vars,
+                       "$target$ = decode_$codec_name$(reader, "
+                       "reader.limit(), $target$);\n");
+      }
+    } else if (field->is_repeated()) {
+      printer->Print(vars, "$target$.push($read$);\n");
+    } else {
+      printer->Print(vars, "$target$ = $read$;\n");
+    }
+    printer->Print("break;\n");
+    printer->Outdent();
+
+    if (field->is_packable()) {
+      // Parsers must accept both encodings of packable fields.
+      vars["tag"] = FieldTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+      printer->Print(vars,
+                     "case $tag$: {\n"
+                     "  const limit = reader.limit();\n"
+                     "  while (reader.pos < limit) {\n"
+                     "    $target$.push($read$);\n"
+                     "  }\n"
+                     "  break;\n"
+                     "}\n");
+    }
+  }
+  printer->Print(
+      "default:\n"
+      "  reader.skip(tag);\n");
   printer->Outdent();
   printer->Outdent();
+  printer->Print(
+      "  }\n"
+      "}\n");
+  if (map_entry &&
+      desc->field(1)->type() == FieldDescriptor::TYPE_MESSAGE) {
+    // A missing value is an empty message.
+    printer->Print(
+        "if (message[1] === undefined) {\n"
+        "  message[1] = decode_$codec_name$(reader, end);\n"
+        "}\n",
+        "codec_name", CodecName(desc->field(1)->message_type()));
+  }
+  printer->Print("return message;\n");
   printer->Outdent();
-  printer->Print("};\n\n\n");
+  printer->Print("}\n\n\n");
 }
 
-void PrintMultipleFilesMode(const FileDescriptor* file, string file_name,
-                            GeneratorContext* context,
-                            std::map<string, string> vars) {
-  std::map<string, string> method_descriptors;
-  bool has_server_streaming = false;
+// Prints deserializeInto_<message>(), which overwrites a message returned by
+// an earlier call. The arrays of repeated fields are reused.
+void PrintPlainDeserializeInto(Printer* printer, const Descriptor* desc) {
+  std::map<string, string> vars;
+  vars["full_name"] = desc->full_name();
+  vars["codec_name"] = CodecName(desc);
+  printer->Print(vars,
+                 "/**\n"
+                 " * @param {!Uint8Array} bytes\n"
+                 " * @param {!Object} message A plain $full_name$ returned by\n"
+                 " *     an earlier deserialization, overwritten\n"
+                 " * @return {!Object} |message|\n"
+                 " */\n"
+                 "function deserializeInto_$codec_name$(bytes, message) {\n");
+  printer->Indent();
+  for (int i = 0; i < desc->field_count(); i++) {
+    const FieldDescriptor* field = desc->field(i);
+    if (field->is_repeated()) {
+      printer->Print("message.$name$.length = 0;\n", "name",
+                     PlainFieldName(field));
+    } else {
+      printer->Print("message.$name$ = $value$;\n", "name",
+                     PlainFieldName(field), "value", PlainDefaultValue(field));
+    }
+  }
+  printer->Print(vars,
+                 "const reader = new grpc.web.WireReader(bytes);\n"
+                 "return decode_$codec_name$(reader, reader.len, message);\n");
+  printer->Outdent();
+  printer->Print("}\n\n\n");
+}
 
-  // Print MethodDescriptor files.
-  for (int i = 0; i < file->service_count(); ++i) {
-    const ServiceDescriptor* service = file->service(i);
-    vars["service_name"] = service->name();
-    vars["class_name"] = LowercaseFirstLetter(service->name());
-
-    for (int method_index = 0; method_index < service->method_count();
-         ++method_index) {
-      const MethodDescriptor* method = service->method(method_index);
-      string method_file_name = Lowercase(service->name()) + "_" +
-                                Lowercase(method->name()) +
-                                "_methoddescriptor.js";
-      if (method->server_streaming()) {
-        has_server_streaming = true;
-      }
-      std::unique_ptr<ZeroCopyOutputStream> output(
-          context->Open(method_file_name));
-      Printer printer(output.get(), '$');
+// Prints deserialize_<message>(), which reads a plain response.
+void PrintPlainDeserializer(Printer* printer, const Descriptor* desc) {
+  printer->Print("/**\n"
+                 " * @param {!Uint8Array} bytes\n"
+                 " * @return {!Object} A plain $full_name$\n"
+                 " */\n"
+                 "function deserialize_$codec_name$(bytes) {\n"
+                 "  const reader = new grpc.web.WireReader(bytes);\n"
+                 "  return decode_$codec_name$(reader, reader.len);\n"
+                 "}\n\n\n",
+                 "full_name", desc->full_name(), "codec_name",
+                 CodecName(desc));
+}
 
-      vars["method_name"] = method->name();
-      vars["in"] = method->input_type()->full_name();
-      vars["in_type"] = "proto." + method->input_type()->full_name();
-      vars["out"] = method->output_type()->full_name();
-      vars["out_type"] = "proto." + method->output_type()->full_name();
-      vars["method_type"] = method->server_streaming()
-                                ? "grpc.web.MethodType.SERVER_STREAMING"
-                                : "grpc.web.MethodType.UNARY";
-
-      PrintMethodDescriptorFile(&printer, vars);
-      method_descriptors[service->name() + "." + method->name()] =
-          "proto." + vars["package_dot"] + vars["class_name"] + "." +
-          vars["method_name"] + "MethodDescriptor";
+// Prints the codecs of every message sent or received by the services in the
+// file, followed by the serialize and deserialize functions passed to their
+// MethodDescriptors.
+void PrintPlainCodecs(Printer* printer, const FileModel& model) {
+  std::set<const Descriptor*> requests;
+  std::set<const Descriptor*> responses;
+  std::set<const Descriptor*> streamed_responses;
+  for (const ServiceModel& service : model.services) {
+    for (const MethodModel& method : service.methods) {
+      requests.insert(method.method->input_type());
+      responses.insert(method.method->output_type());
+      if (method.method->server_streaming()) {
+        streamed_responses.insert(method.method->output_type());
+      }
     }
   }
 
-  std::unique_ptr<ZeroCopyOutputStream> output1(
-      context->Open(file_name + "_client_pb.js"));
-  Printer printer1(output1.get(), '$');
-  std::unique_ptr<ZeroCopyOutputStream> output2(
-      context->Open(file_name + "_promise_client_pb.js"));
-  Printer printer2(output2.get(), '$');
+  for (const auto& entry : GetCodecMessages(model.file)) {
+    const Descriptor* desc = entry.second;
+    PrintPlainEncoder(printer, desc);
+    PrintPlainDecoder(printer, desc);
+  }
 
-  PrintFileHeader(&printer1, vars);
-  PrintFileHeader(&printer2, vars);
+  for (const Descriptor* desc : model.messages) {
+    std::map<string, string> vars;
+    vars["full_name"] = desc->full_name();
+    vars["codec_name"] = CodecName(desc);
+    if (requests.count(desc)) {
+      printer->Print(vars,
+                     "/**\n"
+                     " * @param {!Object} message A plain $full_name$\n"
+                     " * @return {!Uint8Array}\n"
+                     " */\n"
+                     "function serialize_$codec_name$(message) {\n"
+                     "  const writer = new grpc.web.WireWriter();\n"
+                     "  encode_$codec_name$(message, writer);\n"
+                     "  return writer.finish();\n"
+                     "}\n\n\n");
+    }
+    if (responses.count(desc)) {
+      PrintPlainDeserializer(printer, desc);
+    }
+    if (model.reuse_response_messages && streamed_responses.count(desc)) {
+      PrintPlainDeserializeInto(printer, desc);
+    }
+  }
+}
 
-  // Print the Promise and callback client.
-  for (int i = 0; i < file->service_count(); ++i) {
-    const ServiceDescriptor* service = file->service(i);
-    vars["service_name"] = service->name();
-    printer1.Print(vars,
-                   "goog.provide('proto.$package_dot$$service_name$"
-                   "Client');\n\n");
-    printer2.Print(vars,
-                   "goog.provide('proto.$package_dot$$service_name$"
-                   "PromiseClient');\n\n");
+// Prints the file run by the worker decoding the responses of the file's
+// services, with the decode_worker option: the plain decoders of their
+// responses, registered by method with grpc.web.DecodeWorker. Client streaming
+// and bidi streaming responses are decoded by the client.
+void PrintDecodeWorkerFile(Printer* printer, const FileModel& model) {
+  printer->Print(
+      "const grpc = {};\n"
+      "grpc.web = require('grpc-web');\n\n");
+
+  std::vector<std::pair<string, const Descriptor*>> methods;
+  std::set<const Descriptor*> responses;
+  for (const ServiceModel& service : model.services) {
+    for (const MethodModel& method : service.methods) {
+      if (method.method->client_streaming()) {
+        continue;
+      }
+      methods.emplace_back(
+          "/" + service.service->full_name() + "/" + method.method->name(),
+          method.method->output_type());
+      responses.insert(method.method->output_type());
+    }
   }
 
-  if (vars["promise"] == GRPC_PROMISE) {
-    printer2.Print(vars, "goog.require('grpc.web.promise');\n");
+  for (const auto& entry : GetCodecMessages(model.file)) {
+    PrintPlainDecoder(printer, entry.second);
   }
-  std::map<string, string>::iterator it;
-  for (it = method_descriptors.begin(); it != method_descriptors.end(); it++) {
-    vars["import_mtd"] = it->second;
-    printer1.Print(vars, "goog.require('$import_mtd$');\n");
-    printer2.Print(vars, "goog.require('$import_mtd$');\n");
+  for (const Descriptor* desc : model.messages) {
+    if (responses.count(desc)) {
+      PrintPlainDeserializer(printer, desc);
+    }
   }
-  printer1.Print(vars, "goog.require('grpc.web.$mode$ClientBase');\n");
-  printer1.Print(vars, "goog.require('grpc.web.ClientReadableStream');\n");
-  printer1.Print(vars, "goog.require('grpc.web.RpcError');\n");
-  printer2.Print(vars, "goog.require('grpc.web.$mode$ClientBase');\n");
-  if (has_server_streaming) {
-    printer2.Print(vars, "goog.require('grpc.web.ClientReadableStream');\n");
+
+  printer->Print(
+      "/**\n"
+      " * The response decoders, by method.\n"
+      " * @const {!Object<string, function(!Uint8Array):!Object>}\n"
+      " */\n"
+      "const decoders = {\n");
+  printer->Indent();
+  for (const auto& method : methods) {
+    printer->Print("'$path$': deserialize_$codec_name$,\n", "path",
+                   method.first, "codec_name", CodecName(method.second));
   }
+  printer->Outdent();
+  printer->Print(
+      "};\n\n"
+      "// Does nothing unless loaded by a Worker. In Node.js, pass the\n"
+      "// decoders and the worker_threads parentPort to serve() instead.\n"
+      "grpc.web.DecodeWorker.serve(decoders);\n\n"
+      "module.exports = decoders;\n\n");
+}
 
-  PrintClosureDependencies(&printer1, file);
-  PrintClosureDependencies(&printer2, file);
+// Prints the arguments of the MethodDescriptor constructor.
+void PrintMethodDescriptorArgs(Printer* printer, const FileModel& model,
+                               const std::map<string, string>& vars) {
+  printer->Print(vars,
+                 "'/$package_dot$$service_name$/$method_name$',\n"
+                 "$method_type$,\n"
+                 "$in_type$,\n");
+  if (model.plain_codecs) {
+    printer->Print(vars,
+                   "$out_type$,\n"
+                   "serialize_$in_codec$,\n"
+                   "deserialize_$out_codec$");
+    string deserialize_into;
+    if (model.reuse_response_messages &&
+        vars.at("method_type") == "grpc.web.MethodType.SERVER_STREAMING") {
+      deserialize_into = "deserializeInto_" + vars.at("out_codec");
+    }
+    PrintOptionalMethodDescriptorArgs(printer, deserialize_into,
+                                      vars.at("idempotency_level"),
+                                      "grpc.web");
+    printer->Print("\n");
+    return;
+  }
+  printer->Print(vars,
+                 "$out_type$,\n"
+                 "/**\n"
+                 " * @param {!proto.$in$} request\n");
+  printer->Print(
+      (" * @return {" + model.serialize_return_type + "}\n").c_str());
+  printer->Print(
+      " */\n"
+      "function(request) {\n");
+  printer->Print(
+      ("  return request." + model.serialize_method_name + "();\n").c_str());
+  printer->Print("},\n");
+  printer->Print(vars,
+                 ("$out_type$." + model.deserialize_method_name).c_str());
+  PrintOptionalMethodDescriptorArgs(printer, "", vars.at("idempotency_level"),
+                                    "grpc.web");
+  printer->Print("\n");
+}
 
-  printer1.Print(vars, "\ngoog.requireType('grpc.web.ClientOptions');\n");
-  printer2.Print(vars, "\ngoog.requireType('grpc.web.ClientOptions');\n");
+void PrintMethodDescriptor(Printer* printer, const FileModel& model,
+                           const std::map<string, string>& vars) {
+  if (model.lazy_method_descriptors) {
+    // A memoizing getter, called as $method_descriptor$ by the clients.
+    printer->Print(vars,
+                   "/**\n"
+                   " * @type {?grpc.web.MethodDescriptor<\n"
+                   " *   !proto.$in$,\n"
+                   " *   !proto.$out$>}\n"
+                   " */\n"
+                   "let methodDescriptor_$service_name$_$method_name$_ = "
+                   "null;\n\n"
+                   "/**\n"
+                   " * @return {!grpc.web.MethodDescriptor<\n"
+                   " *   !proto.$in$,\n"
+                   " *   !proto.$out$>}\n"
+                   " */\n"
+                   "const methodDescriptor_$service_name$_$method_name$ = "
+                   "function() {\n");
+    printer->Indent();
+    printer->Print(vars,
+                   "if (methodDescriptor_$service_name$_$method_name$_ === "
+                   "null) {\n");
+    printer->Indent();
+    printer->Print(vars,
+                   "methodDescriptor_$service_name$_$method_name$_ = "
+                   "new grpc.web.MethodDescriptor(\n");
+    printer->Indent();
+    PrintMethodDescriptorArgs(printer, model, vars);
+    printer->Outdent();
+    printer->Print(");\n");
+    printer->Outdent();
+    printer->Print(vars,
+                   "}\n"
+                   "return methodDescriptor_$service_name$_$method_name$_;\n");
+    printer->Outdent();
+    printer->Print("};\n\n\n");
+    return;
+  }
 
-  printer1.Print("\n\n\n");
-  printer2.Print("\n\n\n");
-  printer1.Print("goog.scope(function() {\n\n");
-  printer2.Print("goog.scope(function() {\n\n");
+  printer->Print(vars,
+                 "/**\n"
+                 " * @const\n"
+                 " * @type {!grpc.web.MethodDescriptor<\n"
+                 " *   !proto.$in$,\n"
+                 " *   !proto.$out$>}\n"
+                 " */\n"
+                 "const methodDescriptor_$service_name$_$method_name$ = "
+                 "new grpc.web.MethodDescriptor(\n");
+  printer->Indent();
+  PrintMethodDescriptorArgs(printer, model, vars);
+  printer->Outdent();
+  printer->Print(vars, ");\n\n\n");
+}
 
-  for (int service_index = 0; service_index < file->service_count();
-       ++service_index) {
-    const ServiceDescriptor* service = file->service(service_index);
-    vars["service_name"] = service->name();
-    PrintServiceConstructor(&printer1, vars, false);
-    PrintServiceConstructor(&printer2, vars, true);
+void PrintUnaryCall(Printer* printer, const std::map<string, string>& vars) {
+  printer->Print(
+      vars,
+      "/**\n"
+      " * @param {!proto.$in$} request The\n"
+      " *     request proto\n"
+      " * @param {?Object<string, string>} metadata User defined\n"
+      " *     call metadata\n"
+      " * @param {function(?grpc.web.RpcError,"
+      " ?proto.$out$)}\n"
+      " *     callback The callback function(error, response)\n"
+      " * @return {!grpc.web.ClientReadableStream<!proto.$out$>|undefined}\n"
+      " *     The XHR Node Readable Stream\n"
+      " */\n"
+      "proto.$package_dot$$service_name$Client.prototype.$js_method_name$ =\n");
+  printer->Indent();
+  printer->Print(vars,
+                 "  function(request, metadata, callback) {\n"
+                 "return this.client_.rpcCall(this.url_('$path$'),\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print(vars,
+                 "request,\n"
+                 "metadata || {},\n"
+                 "$method_descriptor$,\n"
+                 "callback);\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("};\n\n\n");
+}
 
-    for (int method_index = 0; method_index < service->method_count();
-         ++method_index) {
-      const MethodDescriptor* method = service->method(method_index);
-      const Descriptor* input_type = method->input_type();
-      const Descriptor* output_type = method->output_type();
-      vars["js_method_name"] = LowercaseFirstLetter(method->name());
-      vars["method_name"] = method->name();
-      vars["in"] = input_type->full_name();
-      vars["out"] = output_type->full_name();
+void PrintPromiseUnaryCall(Printer* printer,
+                           const std::map<string, string>& vars) {
+  printer->Print(vars,
+                 "/**\n"
+                 " * @param {!proto.$in$} request The\n"
+                 " *     request proto\n"
+                 " * @param {?Object<string, string>=} metadata User defined\n"
+                 " *     call metadata\n"
+                 " * @return {!$promise$<!proto.$out$>}\n"
+                 " *     Promise that resolves to the response\n"
+                 " */\n"
+                 "proto.$package_dot$$service_name$PromiseClient.prototype"
+                 ".$js_method_name$ =\n");
+  printer->Indent();
+  printer->Print(vars,
+                 "  function(request, metadata) {\n"
+                 "return this.client_.unaryCall(this.url_('$path$'),\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print(vars,
+                 "request,\n"
+                 "metadata || {},\n"
+                 "$method_descriptor$);\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("};\n\n\n");
+}
+
+void PrintServerStreamingCall(Printer* printer,
+                              const std::map<string, string>& vars) {
+  printer->Print(vars,
+                 "/**\n"
+                 " * @param {!proto.$in$} request The request proto\n"
+                 " * @param {?Object<string, string>=} metadata User defined\n"
+                 " *     call metadata\n"
+                 " * @return {!grpc.web.ClientReadableStream<!proto.$out$>}\n"
+                 " *     The XHR Node Readable Stream\n"
+                 " */\n"
+                 "proto.$package_dot$$service_name$$client_type$.prototype."
+                 "$js_method_name$ =\n");
+  printer->Indent();
+  printer->Print(
+      vars,
+      "  function(request, metadata) {\n"
+      "return this.client_.serverStreaming(this.url_('$path$'),\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print(vars,
+                 "request,\n"
+                 "metadata || {},\n"
+                 "$method_descriptor$);\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("};\n\n\n");
+}
+
+void PrintClientStreamingCall(Printer* printer,
+                              const std::map<string, string>& vars) {
+  bool has_callback = vars.at("client_type") == "Client";
+  printer->Print(vars,
+                 "/**\n"
+                 " * @param {?Object<string, string>=} metadata User defined\n"
+                 " *     call metadata\n");
+  if (has_callback) {
+    printer->Print(vars,
+                   " * @param {function(?grpc.web.RpcError,"
+                   " ?proto.$out$)=}\n"
+                   " *     callback The callback function(error, response)\n");
+  }
+  printer->Print(vars,
+                 " * @return {!grpc.web.ClientDuplexStream<!proto.$in$,\n"
+                 " *     !proto.$out$>}\n"
+                 " *     The stream the requests are written to\n"
+                 " */\n"
+                 "proto.$package_dot$$service_name$$client_type$.prototype."
+                 "$js_method_name$ =\n");
+  printer->Indent();
+  printer->Print(has_callback ? "  function(metadata, callback) {\n"
+                              : "  function(metadata) {\n");
+  printer->Print(vars,
+                 "return this.client_.clientStreaming(this.url_('$path$'),\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print(vars, "metadata || {},\n");
+  if (has_callback) {
+    printer->Print(vars,
+                   "$method_descriptor$,\n"
+                   "callback);\n");
+  } else {
+    printer->Print(vars, "$method_descriptor$);\n");
+  }
+  printer->Outdent();
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("};\n\n\n");
+}
+
+void PrintBidiStreamingCall(Printer* printer,
+                            const std::map<string, string>& vars) {
+  printer->Print(vars,
+                 "/**\n"
+                 " * @param {?Object<string, string>=} metadata User defined\n"
+                 " *     call metadata\n"
+                 " * @return {!grpc.web.ClientDuplexStream<!proto.$in$,\n"
+                 " *     !proto.$out$>}\n"
+                 " *     The stream the requests are written to and the\n"
+                 " *     responses read from\n"
+                 " */\n"
+                 "proto.$package_dot$$service_name$$client_type$.prototype."
+                 "$js_method_name$ =\n");
+  printer->Indent();
+  printer->Print(vars,
+                 "  function(metadata) {\n"
+                 "return this.client_.bidiStreaming(this.url_('$path$'),\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print(vars,
+                 "metadata || {},\n"
+                 "$method_descriptor$);\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("};\n\n\n");
+}
+
+void PrintMultipleFilesMode(const FileModel& model, const string& file_name,
+                            GeneratorContext* context) {
+  std::map<string, string> vars = model.vars;
+  std::map<string, string> method_descriptors;
+
+  // Print MethodDescriptor files.
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+    vars["class_name"] = LowercaseFirstLetter(service.service_name);
+
+    for (const MethodModel& method : service.methods) {
+      string method_file_name = Lowercase(service.service_name) + "_" +
+                                Lowercase(method.method_name) +
+                                "_methoddescriptor.js";
+      std::unique_ptr<ZeroCopyOutputStream> output(
+          context->Open(method_file_name));
+      Printer printer(output.get(), '$');
+
+      SetMethodVars(method, &vars);
+      PrintMethodDescriptorFile(&printer, model, method, vars);
+      method_descriptors[service.service_name + "." + method.method_name] =
+          "proto." + vars["package_dot"] + vars["class_name"] + "." +
+          method.method_name + "MethodDescriptor";
+    }
+  }
+
+  std::unique_ptr<ZeroCopyOutputStream> output1(
+      context->Open(file_name + "_client_pb.js"));
+  Printer printer1(output1.get(), '$');
+  std::unique_ptr<ZeroCopyOutputStream> output2(
+      context->Open(file_name + "_promise_client_pb.js"));
+  Printer printer2(output2.get(), '$');
+
+  PrintFileHeader(&printer1, vars);
+  PrintFileHeader(&printer2, vars);
+
+  // Print the Promise and callback client.
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+    printer1.Print(vars,
+                   "goog.provide('proto.$package_dot$$service_name$"
+                   "Client');\n\n");
+    printer2.Print(vars,
+                   "goog.provide('proto.$package_dot$$service_name$"
+                   "PromiseClient');\n\n");
+  }
+
+  if (vars["promise"] == GRPC_PROMISE) {
+    printer2.Print(vars, "goog.require('grpc.web.promise');\n");
+  }
+  std::map<string, string>::iterator it;
+  for (it = method_descriptors.begin(); it != method_descriptors.end(); it++) {
+    vars["import_mtd"] = it->second;
+    printer1.Print(vars, "goog.require('$import_mtd$');\n");
+    printer2.Print(vars, "goog.require('$import_mtd$');\n");
+  }
+  printer1.Print(vars, "goog.require('grpc.web.$mode$ClientBase');\n");
+  printer1.Print(vars, "goog.require('grpc.web.ClientReadableStream');\n");
+  printer1.Print(vars, "goog.require('grpc.web.RpcError');\n");
+  printer2.Print(vars, "goog.require('grpc.web.$mode$ClientBase');\n");
+  if (model.has_server_streaming) {
+    printer2.Print(vars, "goog.require('grpc.web.ClientReadableStream');\n");
+  }
+
+  PrintClosureDependencies(&printer1, model);
+  PrintClosureDependencies(&printer2, model);
+
+  printer1.Print(vars, "\ngoog.requireType('grpc.web.ClientOptions');\n");
+  printer2.Print(vars, "\ngoog.requireType('grpc.web.ClientOptions');\n");
+
+  printer1.Print("\n\n\n");
+  printer2.Print("\n\n\n");
+  printer1.Print("goog.scope(function() {\n\n");
+  printer2.Print("goog.scope(function() {\n\n");
+
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+    PrintServiceConstructor(&printer1, model, service, &vars, false);
+    PrintServiceConstructor(&printer2, model, service, &vars, true);
+
+    for (const MethodModel& method : service.methods) {
+      SetMethodVars(method, &vars);
       vars["method_descriptor"] =
-          method_descriptors[service->name() + "." + method->name()];
-      vars["in_type"] = "proto." + input_type->full_name();
-      vars["out_type"] = "proto." + output_type->full_name();
+          method_descriptors[service.service_name + "." + method.method_name];
 
       // Client streaming is not supported yet
-      if (!method->client_streaming()) {
-        if (method->server_streaming()) {
-          vars["method_type"] = "grpc.web.MethodType.SERVER_STREAMING";
+      if (!method.method->client_streaming()) {
+        if (method.method->server_streaming()) {
           vars["client_type"] = "Client";
           PrintServerStreamingCall(&printer1, vars);
           vars["client_type"] = "PromiseClient";
           PrintServerStreamingCall(&printer2, vars);
         } else {
-          vars["method_type"] = "grpc.web.MethodType.UNARY";
           PrintUnaryCall(&printer1, vars);
           PrintPromiseUnaryCall(&printer2, vars);
         }
       }
     }
   }
-  printer1.Print("}); // goog.scope\n\n");
-  printer2.Print("}); // goog.scope\n\n");
+  printer1.Print("}); // goog.scope\n\n");
+  printer2.Print("}); // goog.scope\n\n");
+}
+
+void PrintClosureES6Imports(Printer* printer, const FileModel& model) {
+  for (const ServiceModel& service : model.services) {
+    string service_namespace =
+        "proto." + model.vars.at("package_dot") + service.service_name;
+    printer->Print(
+        "import $service_name$Client_import from 'goog:$namespace$';\n",
+        "service_name", service.service_name, "namespace",
+        service_namespace + "Client");
+    printer->Print(
+        "import $service_name$PromiseClient_import from 'goog:$namespace$';\n",
+        "service_name", service.service_name, "namespace",
+        service_namespace + "PromiseClient");
+  }
+
+  printer->Print("\n\n\n");
+}
+
+void PrintGrpcWebClosureES6File(Printer* printer, const FileModel& model) {
+  std::map<string, string> vars = model.vars;
+  vars["file"] = model.file->name();
+  printer->Print(
+      vars,
+      "/**\n"
+      " * @fileoverview gRPC-Web generated client stub for '$file$'\n"
+      " */\n"
+      "\n"
+      "// Code generated by protoc-gen-grpc-web. DO NOT EDIT.\n"
+      "// versions:\n"
+      "// \tprotoc-gen-grpc-web v$version$\n"
+      "// \tprotoc              v$protoc_version$\n"
+      "// source: $source_file$\n"
+      "\n"
+      "\n");
+
+  PrintClosureES6Imports(printer, model);
+
+  for (const ServiceModel& service : model.services) {
+    printer->Print("export const $name$Client = $name$Client_import;\n", "name",
+                   service.service_name);
+    printer->Print(
+        "export const $name$PromiseClient = $name$PromiseClient_import;\n",
+        "name", service.service_name);
+  }
+}
+
+// Prints the Closure or CommonJS client file.
+// Prints the function that adds the methods in a service's method table to
+// its client classes, with compact_method_tables.
+void PrintCompactMethodDispatcher(Printer* printer, const FileModel& model) {
+  std::map<string, string> vars = model.vars;
+  printer->Print(
+      "/**\n"
+      " * Adds a method to the prototypes of |client| and |promiseClient| for "
+      "each\n"
+      " * row of |methods|. A row holds the method name, 1 if it is server\n");
+  if (model.plain_codecs) {
+    printer->Print(
+        " * streaming or else 0, the request and response types, the "
+        "request\n"
+        " * serializer and the response deserializer, and optionally the "
+        "response\n"
+        " * deserializer into an earlier response (or null) and the "
+        "idempotency\n"
+        " * level.\n");
+  } else {
+    printer->Print(
+        " * streaming or else 0, the request and response types, and "
+        "optionally\n"
+        " * the idempotency level.\n");
+  }
+  printer->Print(
+      vars,
+      " * @param {function(new: ?, string, ?Object, ?grpc.web.ClientOptions)} "
+      "client\n"
+      " * @param {function(new: ?, string, ?Object, ?grpc.web.ClientOptions)}\n"
+      " *     promiseClient\n"
+      " * @param {string} servicePath The path prefix of the methods\n"
+      " * @param {!Array<!Array<?>>} methods\n"
+      " */\n"
+      "function addServiceMethods(client, promiseClient, servicePath, "
+      "methods) {\n"
+      "  methods.forEach(function(row) {\n"
+      "    const name = row[0].charAt(0).toLowerCase() + row[0].slice(1);\n"
+      "    const path = servicePath + row[0];\n"
+      "    const serverStreaming = row[1] === 1;\n"
+      "    let methodDescriptor = null;\n"
+      "    const getMethodDescriptor = function() {\n"
+      "      if (methodDescriptor === null) {\n"
+      "        methodDescriptor = new grpc.web.MethodDescriptor(\n"
+      "          path,\n"
+      "          serverStreaming ? grpc.web.MethodType.SERVER_STREAMING :\n"
+      "                            grpc.web.MethodType.UNARY,\n"
+      "          row[2],\n"
+      "          row[3],\n");
+  if (model.plain_codecs) {
+    printer->Print(
+        "          row[4],\n"
+        "          row[5],\n"
+        "          row[6] || null,\n"
+        "          row[7] || null);\n");
+  } else {
+    printer->Print(
+        ("          function(request) {\n"
+         "            return request." + model.serialize_method_name +
+         "();\n"
+         "          },\n"
+         "          row[3]." + model.deserialize_method_name + ",\n"
+         "          null,\n"
+         "          row[4] || null);\n").c_str());
+  }
+  printer->Print(
+      vars,
+      "      }\n"
+      "      return methodDescriptor;\n"
+      "    };\n"
+      "    const getUrl = function(self) {\n"
+      "      return self.urls_[path] ||\n"
+      "          (self.urls_[path] = self.hostname_ + path);\n"
+      "    };\n"
+      "    if (serverStreaming) {\n"
+      "      client.prototype[name] = promiseClient.prototype[name] =\n"
+      "          function(request, metadata) {\n"
+      "        return this.client_.serverStreaming(getUrl(this), request,\n"
+      "            metadata || {}, getMethodDescriptor());\n"
+      "      };\n"
+      "    } else {\n"
+      "      client.prototype[name] = function(request, metadata, callback) "
+      "{\n"
+      "        return this.client_.rpcCall(getUrl(this), request,\n"
+      "            metadata || {}, getMethodDescriptor(), callback);\n"
+      "      };\n"
+      "      promiseClient.prototype[name] = function(request, metadata) {\n"
+      "        return this.client_.unaryCall(getUrl(this), request,\n"
+      "            metadata || {}, getMethodDescriptor());\n"
+      "      };\n"
+      "    }\n"
+      "  });\n"
+      "}\n\n\n");
+}
+
+// Prints the method table of |service|, with compact_method_tables.
+void PrintCompactMethodTable(Printer* printer, const FileModel& model,
+                             const ServiceModel& service,
+                             const std::map<string, string>& vars) {
+  printer->Print(vars,
+                 "addServiceMethods(\n"
+                 "    proto.$package_dot$$service_name$Client,\n"
+                 "    proto.$package_dot$$service_name$PromiseClient,\n");
+  printer->Print("    '$path$',\n    [\n", "path", service.path);
+  for (const MethodModel& method : service.methods) {
+    // Client streaming is not supported yet
+    if (method.method->client_streaming()) {
+      continue;
+    }
+    MarkOutput(printer, method.method->full_name());
+    std::map<string, string> row;
+    row["name"] = method.method_name;
+    row["server_streaming"] = method.method->server_streaming() ? "1" : "0";
+    row["in_type"] = method.in_type;
+    row["out_type"] = method.out_type;
+    printer->Print(row,
+                   "      ['$name$', $server_streaming$, $in_type$, "
+                   "$out_type$");
+    string deserialize_into;
+    if (model.plain_codecs) {
+      printer->Print(", serialize_$in_codec$, deserialize_$out_codec$",
+                     "in_codec", CodecName(method.method->input_type()),
+                     "out_codec", CodecName(method.method->output_type()));
+      if (model.reuse_response_messages &&
+          method.method->server_streaming()) {
+        deserialize_into =
+            "deserializeInto_" + CodecName(method.method->output_type());
+      }
+      if (!deserialize_into.empty() || !method.idempotency_level.empty()) {
+        printer->Print(", $deserialize_into$", "deserialize_into",
+                       deserialize_into.empty() ? "null" : deserialize_into);
+      }
+    }
+    if (!method.idempotency_level.empty()) {
+      printer->Print(", grpc.web.IdempotencyLevel.$level$", "level",
+                     method.idempotency_level);
+    }
+    printer->Print("],\n");
+  }
+  MarkOutput(printer, service.service->full_name());
+  printer->Print("    ]);\n\n\n");
+}
+
+void PrintGrpcWebJsFile(Printer* printer, const FileModel& model,
+                        ImportStyle import_style) {
+  std::map<string, string> vars = model.vars;
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+    switch (import_style) {
+      case ImportStyle::CLOSURE:
+        printer->Print(
+            vars,
+            "goog.provide('proto.$package_dot$$service_name$Client');\n");
+        printer->Print(vars,
+                      "goog.provide('proto.$package_dot$$service_name$"
+                      "PromiseClient');\n");
+        break;
+      case ImportStyle::COMMONJS:
+        break;
+      case ImportStyle::TYPESCRIPT:
+      case ImportStyle::ES_MODULE:
+        break;
+    }
+  }
+  printer->Print("\n");
+
+  switch (import_style) {
+    case ImportStyle::CLOSURE:
+      if (vars["promise"] == GRPC_PROMISE) {
+        printer->Print(vars, "goog.require('grpc.web.promise');\n");
+      }
+      printer->Print(vars, "goog.require('grpc.web.MethodDescriptor');\n");
+      printer->Print(vars, "goog.require('grpc.web.MethodType');\n");
+      if (model.has_idempotency_levels) {
+        printer->Print(vars, "goog.require('grpc.web.IdempotencyLevel');\n");
+      }
+      printer->Print(vars, "goog.require('grpc.web.$mode$ClientBase');\n");
+      printer->Print(vars, "goog.require('grpc.web.AbstractClientBase');\n");
+      printer->Print(vars, "goog.require('grpc.web.ClientReadableStream');\n");
+      if (model.has_client_streaming) {
+        printer->Print(vars,
+                       "goog.require('grpc.web.ClientDuplexStream');\n");
+      }
+      printer->Print(vars, "goog.require('grpc.web.RpcError');\n");
+
+      PrintClosureDependencies(printer, model);
+      printer->Print(vars, "\ngoog.requireType('grpc.web.ClientOptions');\n");
+      printer->Print("\n\n\n");
+      printer->Print("goog.scope(function() {\n\n");
+      break;
+    case ImportStyle::COMMONJS:
+      printer->Print(vars, "const grpc = {};\n");
+      printer->Print(vars, "grpc.web = require('grpc-web');\n\n");
+      PrintCommonJsMessagesDeps(printer, model);
+      if (model.plain_codecs) {
+        PrintPlainCodecs(printer, model);
+      }
+      if (model.compact_method_tables && !model.services.empty()) {
+        PrintCompactMethodDispatcher(printer, model);
+      }
+      break;
+    case ImportStyle::TYPESCRIPT:
+    case ImportStyle::ES_MODULE:
+      break;
+  }
+
+  for (const ServiceModel& service : model.services) {
+    vars["service_name"] = service.service_name;
+    MarkOutput(printer, service.service->full_name());
+    PrintServiceConstructor(printer, model, service, &vars, false);
+    PrintServiceConstructor(printer, model, service, &vars, true);
+    if (model.compact_method_tables) {
+      PrintCompactMethodTable(printer, model, service, vars);
+      continue;
+    }
+
+    for (const MethodModel& method : service.methods) {
+      SetMethodVars(method, &vars);
+
+      if (HasStub(model, method)) {
+        MarkOutput(printer, method.method->full_name());
+        PrintMethodDescriptor(printer, model, vars);
+        if (method.method->client_streaming()) {
+          for (const char* client_type : {"Client", "PromiseClient"}) {
+            vars["client_type"] = client_type;
+            if (method.method->server_streaming()) {
+              PrintBidiStreamingCall(printer, vars);
+            } else {
+              PrintClientStreamingCall(printer, vars);
+            }
+          }
+        } else if (method.method->server_streaming()) {
+          vars["client_type"] = "Client";
+          PrintServerStreamingCall(printer, vars);
+          vars["client_type"] = "PromiseClient";
+          PrintServerStreamingCall(printer, vars);
+        } else {
+          PrintUnaryCall(printer, vars);
+          PrintPromiseUnaryCall(printer, vars);
+        }
+      }
+    }
+  }
+  MarkOutput(printer, "");
+
+  switch (import_style) {
+    case ImportStyle::CLOSURE:
+      printer->Print("}); // goog.scope\n\n");
+      break;
+    case ImportStyle::COMMONJS:
+      if (!vars["package"].empty()) {
+        printer->Print(vars, "module.exports = proto.$package$;\n\n");
+      } else {
+        printer->Print(vars, "module.exports = proto;\n\n");
+      }
+      break;
+    case ImportStyle::TYPESCRIPT:
+    case ImportStyle::ES_MODULE:
+      break;
+  }
+}
+
+class GeneratorOptions {
+ public:
+  GeneratorOptions();
+
+  bool ParseFromOptions(const string& parameter, string* error);
+  bool ParseFromOptions(const std::vector<std::pair<string, string>>& options,
+                        string* error);
+
+  // Returns the name of the output file for |proto_file|.
+  string OutputFile(const string& proto_file) const;
+
+  string mode() const { return mode_; }
+  string plugins() const { return plugins_; }
+  ImportStyle import_style() const { return import_style_; }
+  bool generate_dts() const { return generate_dts_; }
+  bool generate_closure_es6() const { return generate_closure_es6_; }
+  bool multiple_files() const { return multiple_files_; }
+  bool goog_promise() const { return goog_promise_; }
+  // Number of files generated concurrently by GenerateAll; 0 means one
+  // worker per hardware thread.
+  int parallelism() const { return parallelism_; }
+  // Directory holding cached generator output, keyed by a hash of the input
+  // descriptor and options. Empty when caching is off.
+  string cache_dir() const { return cache_dir_; }
+  // Whether cache hits emit nothing, leaving previous outputs untouched.
+  bool cache_skip_unchanged() const { return cache_skip_unchanged_; }
+  // Whether Closure and CommonJS clients construct their MethodDescriptors
+  // on first use instead of when the module is loaded.
+  bool lazy_method_descriptors() const { return lazy_method_descriptors_; }
+  // Whether CommonJS clients send and receive plain objects, written and read
+  // by generated codecs, instead of jspb.Message instances.
+  bool plain_codecs() const { return plain_codecs_; }
+  // Whether to also generate, for server streaming methods, deserializers
+  // that overwrite an earlier response, which streams use to reuse responses.
+  bool reuse_response_messages() const { return reuse_response_messages_; }
+  // Whether CommonJS clients describe each service with a table of its
+  // methods, turned into client methods at load time by a shared function.
+  bool compact_method_tables() const { return compact_method_tables_; }
+  // Whether to write a JSON manifest of the bytes each service and method
+  // adds to the client file, and of the modules it imports, next to it.
+  bool size_manifest() const { return size_manifest_; }
+  // Whether to generate stubs for client streaming and bidi streaming
+  // methods, which send their requests with fetch().
+  bool client_streaming() const { return client_streaming_; }
+  // Whether to also write a file run by a Worker, which decodes the responses
+  // of the file's services off the main thread.
+  bool decode_worker() const { return decode_worker_; }
+  // Whether to write a JSON profile of each file's generation next to its
+  // outputs.
+  bool profile() const { return profile_; }
+  // Time spent parsing the generator parameter, in microseconds.
+  int64_t parse_micros() const { return parse_micros_; }
+
+  // Returns a canonical form of every option that affects generated code.
+  string CacheKey() const;
+
+ private:
+  string file_name_;
+  string mode_;
+  string plugins_;
+  ImportStyle import_style_;
+  bool generate_dts_;
+  bool generate_closure_es6_;
+  bool multiple_files_;
+  bool goog_promise_;
+  bool lazy_method_descriptors_;
+  bool plain_codecs_;
+  bool reuse_response_messages_;
+  bool compact_method_tables_;
+  bool size_manifest_;
+  bool client_streaming_;
+  bool decode_worker_;
+  int parallelism_;
+  string cache_dir_;
+  bool cache_skip_unchanged_;
+  bool profile_;
+  int64_t parse_micros_;
+};
+
+GeneratorOptions::GeneratorOptions()
+    : file_name_(""),
+      mode_(""),
+      plugins_(""),
+      import_style_(ImportStyle::CLOSURE),
+      generate_dts_(false),
+      generate_closure_es6_(false),
+      multiple_files_(false),
+      goog_promise_(false),
+      lazy_method_descriptors_(false),
+      plain_codecs_(false),
+      reuse_response_messages_(false),
+      compact_method_tables_(false),
+      size_manifest_(false),
+      client_streaming_(false),
+      decode_worker_(false),
+      parallelism_(1),
+      cache_dir_(""),
+      cache_skip_unchanged_(false),
+      profile_(false),
+      parse_micros_(0) {}
+
+bool GeneratorOptions::ParseFromOptions(const string& parameter,
+                                        string* error) {
+  int64_t start = NowMicros();
+  std::vector<std::pair<string, string>> options;
+  ParseGeneratorParameter(parameter, &options);
+  bool ok = ParseFromOptions(options, error);
+  parse_micros_ = NowMicros() - start;
+  return ok;
+}
+
+bool GeneratorOptions::ParseFromOptions(
+    const std::vector<std::pair<string, string>>& options, string* error) {
+  for (const std::pair<string, string>& option : options) {
+    if ("out" == option.first) {
+      file_name_ = option.second;
+    } else if ("mode" == option.first) {
+      mode_ = option.second;
+    } else if ("import_style" == option.first) {
+      if ("closure" == option.second) {
+        import_style_ = ImportStyle::CLOSURE;
+      } else if ("experimental_closure_es6" == option.second) {
+        import_style_ = ImportStyle::CLOSURE;
+        generate_closure_es6_ = true;
+      } else if ("commonjs" == option.second) {
+        import_style_ = ImportStyle::COMMONJS;
+      } else if ("commonjs+dts" == option.second) {
+        import_style_ = ImportStyle::COMMONJS;
+        generate_dts_ = true;
+      } else if ("typescript" == option.second) {
+        import_style_ = ImportStyle::TYPESCRIPT;
+        generate_dts_ = true;
+      } else if ("esm" == option.second) {
+        import_style_ = ImportStyle::ES_MODULE;
+      } else {
+        *error = "options: invalid import_style - " + option.second;
+        return false;
+      }
+    } else if ("multiple_files" == option.first) {
+      multiple_files_ = "True" == option.second;
+    } else if ("plugins" == option.first) {
+      plugins_ = option.second;
+    } else if ("goog_promise" == option.first) {
+      goog_promise_ = "True" == option.second;
+    } else if ("lazy_method_descriptors" == option.first) {
+      lazy_method_descriptors_ = "True" == option.second;
+    } else if ("plain_codecs" == option.first) {
+      plain_codecs_ = "True" == option.second;
+    } else if ("reuse_response_messages" == option.first) {
+      reuse_response_messages_ = "True" == option.second;
+    } else if ("compact_method_tables" == option.first) {
+      compact_method_tables_ = "True" == option.second;
+    } else if ("size_manifest" == option.first) {
+      size_manifest_ = "True" == option.second;
+    } else if ("client_streaming" == option.first) {
+      client_streaming_ = "True" == option.second;
+    } else if ("decode_worker" == option.first) {
+      decode_worker_ = "True" == option.second;
+    } else if ("parallelism" == option.first) {
+      char* end = nullptr;
+      long value = strtol(option.second.c_str(), &end, 10);
+      if (option.second.empty() || *end != '\0' || value < 0) {
+        *error = "options: invalid parallelism - " + option.second;
+        return false;
+      }
+      parallelism_ = static_cast<int>(value);
+    } else if ("cache_dir" == option.first) {
+      cache_dir_ = option.second;
+    } else if ("cache_skip_unchanged" == option.first) {
+      cache_skip_unchanged_ = "True" == option.second;
+    } else if ("profile" == option.first) {
+      profile_ = "True" == option.second;
+    } else {
+      *error = "unsupported option: " + option.first;
+      return false;
+    }
+  }
+
+  if (mode_.empty()) {
+    *error = "options: mode is required";
+    return false;
+  }
+
+  if (cache_skip_unchanged_ && cache_dir_.empty()) {
+    *error = "options: cache_skip_unchanged requires cache_dir";
+    return false;
+  }
+
+  if (plain_codecs_ && import_style_ != ImportStyle::COMMONJS) {
+    *error = "options: plain_codecs requires import_style=commonjs";
+    return false;
+  }
+
+  if (plain_codecs_ && "jspb" == mode_) {
+    *error = "options: plain_codecs is not supported with mode=jspb";
+    return false;
+  }
+
+  if (reuse_response_messages_ && !plain_codecs_) {
+    *error = "options: reuse_response_messages requires plain_codecs";
+    return false;
+  }
+
+  if (decode_worker_ && !plain_codecs_) {
+    *error = "options: decode_worker requires plain_codecs";
+    return false;
+  }
+
+  if (compact_method_tables_ && import_style_ != ImportStyle::COMMONJS) {
+    *error = "options: compact_method_tables requires import_style=commonjs";
+    return false;
+  }
+
+  if (size_manifest_ && multiple_files_ &&
+      import_style_ == ImportStyle::CLOSURE) {
+    *error = "options: size_manifest is not supported with multiple_files";
+    return false;
+  }
+
+  if (client_streaming_ && "grpcweb" != mode_ && "grpcwebtext" != mode_) {
+    *error =
+        "options: client_streaming requires mode=grpcweb or mode=grpcwebtext";
+    return false;
+  }
+
+  if (client_streaming_ && import_style_ == ImportStyle::ES_MODULE) {
+    *error = "options: client_streaming is not supported with "
+             "import_style=esm";
+    return false;
+  }
+
+  if (client_streaming_ && compact_method_tables_) {
+    *error = "options: client_streaming is not supported with "
+             "compact_method_tables";
+    return false;
+  }
+
+  if (client_streaming_ && multiple_files_ &&
+      import_style_ == ImportStyle::CLOSURE) {
+    *error = "options: client_streaming is not supported with multiple_files";
+    return false;
+  }
+
+  return true;
+}
+
+string GeneratorOptions::CacheKey() const {
+  return "out=" + file_name_ + ",mode=" + mode_ + ",plugins=" + plugins_ +
+         ",import_style=" + std::to_string(import_style_) +
+         ",dts=" + std::to_string(generate_dts_) +
+         ",closure_es6=" + std::to_string(generate_closure_es6_) +
+         ",multiple_files=" + std::to_string(multiple_files_) +
+         ",goog_promise=" + std::to_string(goog_promise_) +
+         ",lazy_method_descriptors=" +
+         std::to_string(lazy_method_descriptors_) +
+         ",plain_codecs=" + std::to_string(plain_codecs_) +
+         ",reuse_response_messages=" +
+         std::to_string(reuse_response_messages_) +
+         ",compact_method_tables=" + std::to_string(compact_method_tables_) +
+         ",size_manifest=" + std::to_string(size_manifest_) +
+         ",client_streaming=" + std::to_string(client_streaming_) +
+         ",decode_worker=" + std::to_string(decode_worker_);
+}
+
+string GeneratorOptions::OutputFile(const string& proto_file) const {
+  if (ImportStyle::TYPESCRIPT == import_style()) {
+    // Never use the value from the 'out' option when generating TypeScript.
+    string directory;
+    string basename;
+    PathSplit(proto_file, &directory, &basename);
+    return directory + UppercaseFirstLetter(StripProto(basename)) +
+           "ServiceClientPb.ts";
+  }
+  if (!file_name_.empty()) {
+    return file_name_;
+  }
+  return StripProto(proto_file) + "_grpc_web_pb.js";
+}
+
+// Timings and output sizes of the generation of one .proto file, written as
+// a JSON sidecar when the profile option is set.
+class GenerationProfile {
+ public:
+  GenerationProfile() : start_micros_(NowMicros()) {}
+
+  // Attributes the time until it goes out of scope to the phase or emitter
+  // |name|. Files opened meanwhile are attributed to emitters. Does nothing
+  // when |profile| is null.
+  class Scope {
+   public:
+    Scope(GenerationProfile* profile, const string& name, bool is_emitter)
+        : profile_(profile), start_micros_(NowMicros()) {
+      if (profile_ == nullptr) {
+        return;
+      }
+      if (is_emitter) {
+        profile_->emitters_.push_back(Emitter{name, 0, 0, 0, {}});
+        profile_->current_emitter_ = &profile_->emitters_.back();
+      } else {
+        profile_->phases_.emplace_back(name, 0);
+      }
+      is_emitter_ = is_emitter;
+    }
+
+    ~Scope() {
+      if (profile_ == nullptr) {
+        return;
+      }
+      int64_t micros = NowMicros() - start_micros_;
+      if (is_emitter_) {
+        profile_->current_emitter_->micros = micros;
+        profile_->current_emitter_ = nullptr;
+      } else {
+        profile_->phases_.back().second = micros;
+      }
+    }
+
+   private:
+    GenerationProfile* profile_;
+    int64_t start_micros_;
+    bool is_emitter_ = false;
+  };
+
+  // Records a file written by the current emitter. |write_micros| is the
+  // time spent in the GeneratorContext's stream rather than in the emitter.
+  void AddOutput(const string& filename, int64_t bytes, int64_t write_micros) {
+    if (current_emitter_ == nullptr) {
+      return;
+    }
+    current_emitter_->bytes += bytes;
+    current_emitter_->write_micros += write_micros;
+    current_emitter_->outputs.push_back(filename);
+  }
+
+  string ToJson(const string& proto_file) const {
+    int64_t emit_micros = 0;
+    int64_t write_micros = 0;
+    for (const Emitter& emitter : emitters_) {
+      emit_micros += emitter.micros;
+      write_micros += emitter.write_micros;
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"file\": " << JsonString(proto_file) << ",\n"
+         << "  \"total_micros\": " << NowMicros() - start_micros_ << ",\n"
+         << "  \"phases\": {\n";
+    for (const auto& phase : phases_) {
+      json << "    " << JsonString(phase.first) << ": " << phase.second
+           << ",\n";
+    }
+    json << "    \"format\": " << emit_micros - write_micros << ",\n"
+         << "    \"write\": " << write_micros << "\n"
+         << "  },\n"
+         << "  \"emitters\": [";
+    for (const Emitter& emitter : emitters_) {
+      json << (&emitter == &emitters_.front() ? "\n" : ",\n") << "    {\n"
+           << "      \"name\": " << JsonString(emitter.name) << ",\n"
+           << "      \"micros\": " << emitter.micros << ",\n"
+           << "      \"write_micros\": " << emitter.write_micros << ",\n"
+           << "      \"bytes\": " << emitter.bytes << ",\n"
+           << "      \"outputs\": [";
+      for (size_t j = 0; j < emitter.outputs.size(); j++) {
+        json << (j == 0 ? "" : ", ") << JsonString(emitter.outputs[j]);
+      }
+      json << "]\n"
+           << "    }";
+    }
+    json << (emitters_.empty() ? "]\n" : "\n  ]\n") << "}\n";
+    return json.str();
+  }
+
+ private:
+  struct Emitter {
+    string name;
+    int64_t micros;
+    int64_t write_micros;
+    int64_t bytes;
+    std::vector<string> outputs;
+  };
+
+  const int64_t start_micros_;
+  std::vector<std::pair<string, int64_t>> phases_;
+  // A list, so that |current_emitter_| stays valid as emitters are added.
+  std::list<Emitter> emitters_;
+  Emitter* current_emitter_ = nullptr;
+};
+
+// Forwards to a stream of the wrapped GeneratorContext, reporting the bytes
+// written and the time spent in that stream to a GenerationProfile.
+class ProfilingOutputStream : public ZeroCopyOutputStream {
+ public:
+  ProfilingOutputStream(const string& filename, ZeroCopyOutputStream* stream,
+                        GenerationProfile* profile)
+      : filename_(filename), stream_(stream), profile_(profile),
+        write_micros_(0) {}
+
+  ~ProfilingOutputStream() override {
+    int64_t bytes = stream_->ByteCount();
+    int64_t start = NowMicros();
+    stream_.reset();
+    write_micros_ += NowMicros() - start;
+    profile_->AddOutput(filename_, bytes, write_micros_);
+  }
+
+  bool Next(void** data, int* size) override {
+    int64_t start = NowMicros();
+    bool ok = stream_->Next(data, size);
+    write_micros_ += NowMicros() - start;
+    return ok;
+  }
+
+  void BackUp(int count) override { stream_->BackUp(count); }
+
+  int64_t ByteCount() const override { return stream_->ByteCount(); }
+
+ private:
+  const string filename_;
+  std::unique_ptr<ZeroCopyOutputStream> stream_;
+  GenerationProfile* profile_;
+  int64_t write_micros_;
+};
+
+class ProfilingGeneratorContext : public GeneratorContext {
+ public:
+  ProfilingGeneratorContext(GeneratorContext* context,
+                            GenerationProfile* profile)
+      : context_(context), profile_(profile) {}
+
+  ZeroCopyOutputStream* Open(const string& filename) override {
+    return new ProfilingOutputStream(filename, context_->Open(filename),
+                                     profile_);
+  }
+
+  void GetCompilerVersion(Version* version) const override {
+    context_->GetCompilerVersion(version);
+  }
+
+ private:
+  GeneratorContext* context_;
+  GenerationProfile* profile_;
+};
+
+// Resolves the names, types and imports the emitters print for |file|.
+bool BuildFileModel(const FileDescriptor* file,
+                    const GeneratorOptions& generator_options,
+                    GeneratorContext* context, FileModel* model,
+                    string* error) {
+  model->file = file;
+  std::map<string, string>& vars = model->vars;
+  string package = file->package();
+  vars["package"] = package;
+  vars["package_dot"] = package.empty() ? "" : package + '.';
+  vars["promise"] = "Promise";
+  vars["plugins"] = generator_options.plugins();
+
+  if ("binary" == generator_options.mode()) {
+    model->mode = Mode::OP;
+    vars["binary"] = "true";
+  } else if ("grpcweb" == generator_options.mode()) {
+    model->mode = Mode::GRPCWEB;
+    vars["format"] = "binary";
+  } else if ("grpcwebtext" == generator_options.mode()) {
+    model->mode = Mode::GRPCWEB;
+    vars["format"] = "text";
+  } else if ("jspb" == generator_options.mode()) {
+    model->mode = Mode::OP;
+    vars["binary"] = "false";
+    if (generator_options.goog_promise()) {
+      vars["promise"] = GRPC_PROMISE;
+    }
+  } else {
+    *error = "options: invalid mode - " + generator_options.mode();
+    return false;
+  }
+  vars["mode"] = GetModeVar(model->mode);
+
+  model->lazy_method_descriptors = generator_options.lazy_method_descriptors();
+  model->plain_codecs = generator_options.plain_codecs();
+  model->reuse_response_messages = generator_options.reuse_response_messages();
+  model->compact_method_tables = generator_options.compact_method_tables();
+  if (model->plain_codecs) {
+    for (const auto& entry : GetCodecMessages(file)) {
+      const Descriptor* message = entry.second;
+      for (int i = 0; i < message->field_count(); i++) {
+        if (message->field(i)->type() == FieldDescriptor::TYPE_GROUP) {
+          *error = "options: plain_codecs does not support groups - " +
+                   message->field(i)->full_name();
+          return false;
+        }
+      }
+    }
+  }
+
+  if ("jspb" == generator_options.mode()) {
+    model->serialize_method_name = "serialize";
+    model->deserialize_method_name = "deserialize";
+    model->serialize_return_type = "string";
+  } else {
+    model->serialize_method_name = "serializeBinary";
+    model->deserialize_method_name = "deserializeBinary";
+    model->serialize_return_type = "!Uint8Array";
+  }
+
+  vars["version"]        = GRPC_WEB_VERSION;
+  vars["protoc_version"] = GetProtocVersion(context);
+  vars["source_file"]    = file->name();
+
+  model->has_server_streaming = false;
+  model->has_client_streaming = false;
+  model->has_idempotency_levels = false;
+  model->services.resize(file->service_count());
+  for (int i = 0; i < file->service_count(); ++i) {
+    const ServiceDescriptor* service = file->service(i);
+    ServiceModel& service_model = model->services[i];
+    service_model.service = service;
+    service_model.service_name = service->name();
+    service_model.path = string(model->mode == Mode::OP ? "/$rpc/" : "/") +
+                         vars["package_dot"] + service->name() + "/";
+    service_model.methods.resize(service->method_count());
+
+    for (int j = 0; j < service->method_count(); ++j) {
+      const MethodDescriptor* method = service->method(j);
+      const Descriptor* input_type = method->input_type();
+      const Descriptor* output_type = method->output_type();
+      MethodModel& method_model = service_model.methods[j];
+      method_model.method = method;
+      method_model.method_name = method->name();
+      method_model.js_method_name = LowercaseFirstLetter(method->name());
+      method_model.in = input_type->full_name();
+      method_model.out = output_type->full_name();
+
+      // Cross-file ref in CommonJS needs to use the module alias instead
+      // of the global name.
+      if (ImportStyle::COMMONJS == generator_options.import_style() &&
+          input_type->file() != file) {
+        method_model.in_type = ModuleAlias(input_type->file()->name()) +
+                               GetNestedMessageName(input_type);
+      } else {
+        method_model.in_type = "proto." + input_type->full_name();
+      }
+      if (ImportStyle::COMMONJS == generator_options.import_style() &&
+          output_type->file() != file) {
+        method_model.out_type = ModuleAlias(output_type->file()->name()) +
+                                GetNestedMessageName(output_type);
+      } else {
+        method_model.out_type = "proto." + output_type->full_name();
+      }
+
+      method_model.ts_in_type = JSMessageType(input_type);
+      method_model.ts_out_type = JSMessageType(output_type);
+      method_model.method_descriptor =
+          "methodDescriptor_" + service->name() + "_" + method->name();
+      if (model->lazy_method_descriptors) {
+        method_model.method_descriptor += "()";
+      }
+      method_model.path = service_model.path + method->name();
+      if (method->server_streaming()) {
+        model->has_server_streaming = true;
+      }
+      if (method->client_streaming() &&
+          generator_options.client_streaming()) {
+        model->has_client_streaming = true;
+      }
+      MethodOptions::IdempotencyLevel level =
+          method->options().idempotency_level();
+      if (level != MethodOptions::IDEMPOTENCY_UNKNOWN) {
+        method_model.idempotency_level =
+            MethodOptions::IdempotencyLevel_Name(level);
+        model->has_idempotency_levels = true;
+      }
+    }
+  }
+
+  std::set<string> imported;
+  for (const auto& entry : GetAllMessages(file)) {
+    model->messages.push_back(entry.second);
+
+    const string& proto_filename = entry.second->file()->name();
+    string dep_filename =
+        GetRootPath(file->name(), proto_filename) + StripProto(proto_filename);
+    if (!imported.insert(dep_filename).second) {
+      continue;
+    }
+    model->message_imports.push_back(
+        {ModuleAlias(proto_filename), dep_filename, proto_filename});
+  }
+
+  for (int i = 0; i < file->dependency_count(); i++) {
+    const string& proto_filename = file->dependency(i)->name();
+    model->dependency_imports.push_back(
+        {ModuleAlias(proto_filename),
+         GetRootPath(file->name(), proto_filename) + StripProto(proto_filename),
+         proto_filename});
+  }
+
+  return true;
+}
+
+// Returns the modules the client file of |model| imports, as it names them,
+// each with the .proto file it is generated from, or "" for grpc-web itself.
+std::vector<std::pair<string, string>> GetClientImports(
+    const FileModel& model, ImportStyle import_style) {
+  std::vector<std::pair<string, string>> imports;
+  switch (import_style) {
+    case ImportStyle::CLOSURE:
+      for (const Descriptor* message : model.messages) {
+        imports.emplace_back("proto." + message->full_name(),
+                             message->file()->name());
+      }
+      break;
+    case ImportStyle::COMMONJS:
+      imports.emplace_back("grpc-web", "");
+      for (const ImportModel& dependency : model.dependency_imports) {
+        imports.emplace_back(dependency.dep_filename + "_pb.js",
+                             dependency.proto_filename);
+      }
+      imports.emplace_back(
+          "./" + GetBasename(StripProto(model.file->name())) + "_pb.js",
+          model.file->name());
+      break;
+    case ImportStyle::TYPESCRIPT:
+    case ImportStyle::ES_MODULE:
+      imports.emplace_back("grpc-web", "");
+      for (const ImportModel& import : model.message_imports) {
+        imports.emplace_back(import.dep_filename + "_pb",
+                             import.proto_filename);
+      }
+      break;
+  }
+  return imports;
+}
+
+// Writes the size manifest of |output_file|, the client file generated for
+// |model|: the bytes of each service and method in it, per |sizes|, the
+// modules it imports, and the dependencies of the .proto files those modules
+// are generated from, whose _pb modules import each other the same way.
+void WriteSizeManifest(const FileModel& model, ImportStyle import_style,
+                       const string& output_file, const OutputSizes& sizes,
+                       GeneratorContext* context) {
+  std::vector<std::pair<string, string>> imports =
+      GetClientImports(model, import_style);
+
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"file\": " << JsonString(model.file->name()) << ",\n"
+       << "  \"output\": " << JsonString(output_file) << ",\n"
+       << "  \"bytes\": " << sizes.total_bytes() << ",\n"
+       << "  \"shared_bytes\": " << sizes.bytes("") << ",\n"
+       << "  \"services\": [";
+  for (const ServiceModel& service : model.services) {
+    int64_t service_bytes = sizes.bytes(service.service->full_name());
+    for (const MethodModel& method : service.methods) {
+      service_bytes += sizes.bytes(method.method->full_name());
+    }
+    json << (&service == &model.services.front() ? "\n" : ",\n")
+         << "    {\n"
+         << "      \"name\": " << JsonString(service.service->full_name())
+         << ",\n"
+         << "      \"bytes\": " << service_bytes << ",\n"
+         << "      \"shared_bytes\": "
+         << sizes.bytes(service.service->full_name()) << ",\n"
+         << "      \"methods\": [";
+    for (const MethodModel& method : service.methods) {
+      const Descriptor* input_type = method.method->input_type();
+      const Descriptor* output_type = method.method->output_type();
+      json << (&method == &service.methods.front() ? "\n" : ",\n")
+           << "        {\n"
+           << "          \"name\": " << JsonString(method.method_name) << ",\n"
+           << "          \"bytes\": " << sizes.bytes(method.method->full_name())
+           << ",\n"
+           << "          \"request\": " << JsonString(input_type->full_name())
+           << ",\n"
+           << "          \"request_proto\": "
+           << JsonString(input_type->file()->name()) << ",\n"
+           << "          \"response\": " << JsonString(output_type->full_name())
+           << ",\n"
+           << "          \"response_proto\": "
+           << JsonString(output_type->file()->name()) << "\n"
+           << "        }";
+    }
+    json << (service.methods.empty() ? "]\n" : "\n      ]\n") << "    }";
+  }
+  json << (model.services.empty() ? "],\n" : "\n  ],\n") << "  \"imports\": [";
+
+  std::map<string, const FileDescriptor*> protos;
+  std::vector<const FileDescriptor*> pending;
+  for (size_t i = 0; i < imports.size(); i++) {
+    json << (i == 0 ? "\n" : ",\n") << "    {\"module\": "
+         << JsonString(imports[i].first);
+    if (!imports[i].second.empty()) {
+      json << ", \"proto\": " << JsonString(imports[i].second);
+      const FileDescriptor* proto =
+          model.file->pool()->FindFileByName(imports[i].second);
+      if (proto != nullptr && protos.emplace(proto->name(), proto).second) {
+        pending.push_back(proto);
+      }
+    }
+    json << "}";
+  }
+  while (!pending.empty()) {
+    const FileDescriptor* proto = pending.back();
+    pending.pop_back();
+    for (int i = 0; i < proto->dependency_count(); i++) {
+      const FileDescriptor* dependency = proto->dependency(i);
+      if (protos.emplace(dependency->name(), dependency).second) {
+        pending.push_back(dependency);
+      }
+    }
+  }
+
+  json << (imports.empty() ? "],\n" : "\n  ],\n")
+       << "  \"proto_dependencies\": {";
+  for (const auto& entry : protos) {
+    json << (entry.first == protos.begin()->first ? "\n" : ",\n") << "    "
+         << JsonString(entry.first) << ": [";
+    for (int i = 0; i < entry.second->dependency_count(); i++) {
+      json << (i == 0 ? "" : ", ")
+           << JsonString(entry.second->dependency(i)->name());
+    }
+    json << "]";
+  }
+  json << (protos.empty() ? "}\n" : "\n  }\n") << "}\n";
+
+  std::unique_ptr<ZeroCopyOutputStream> output(
+      context->Open(StripProto(model.file->name()) + "_grpc_web_size.json"));
+  Printer printer(output.get(), '$');
+  printer.PrintRaw(json.str());
 }
 
-void PrintClosureES6Imports(Printer* printer, const FileDescriptor* file,
-                            string package_dot) {
-  for (int i = 0; i < file->service_count(); ++i) {
-    const ServiceDescriptor* service = file->service(i);
+// Generates all outputs for |file| into |context|, reporting to |profile|
+// unless it is null.
+bool GenerateOutputs(const FileDescriptor* file,
+                     const GeneratorOptions& generator_options,
+                     GeneratorContext* context, GenerationProfile* profile,
+                     string* error) {
+  FileModel model;
+  {
+    GenerationProfile::Scope scope(profile, "build_model", false);
+    if (!BuildFileModel(file, generator_options, context, &model, error)) {
+      return false;
+    }
+  }
 
-    string service_namespace = "proto." + package_dot + service->name();
-    printer->Print(
-        "import $service_name$Client_import from 'goog:$namespace$';\n",
-        "service_name", service->name(), "namespace",
-        service_namespace + "Client");
-    printer->Print(
-        "import $service_name$PromiseClient_import from 'goog:$namespace$';\n",
-        "service_name", service->name(), "namespace",
-        service_namespace + "PromiseClient");
+  if (generator_options.generate_dts()) {
+    GenerationProfile::Scope scope(profile, "PrintProtoDtsFile", true);
+    string proto_dts_file_name = StripProto(file->name()) + "_pb.d.ts";
+    std::unique_ptr<ZeroCopyOutputStream> proto_dts_output(
+        context->Open(proto_dts_file_name));
+    Printer proto_dts_printer(proto_dts_output.get(), '$');
+    PrintProtoDtsFile(&proto_dts_printer, model);
   }
 
-  printer->Print("\n\n\n");
-}
+  if (model.services.empty()) {
+    // No services, nothing to do.
+    return true;
+  }
 
-void PrintGrpcWebClosureES6File(Printer* printer, const FileDescriptor* file) {
-  string package_dot = file->package().empty() ? "" : file->package() + ".";
+  string file_name = generator_options.OutputFile(file->name());
+  OutputSizes sizes;
+  OutputSizes* size_collector =
+      generator_options.size_manifest() ? &sizes : nullptr;
+  if (generator_options.multiple_files() &&
+      ImportStyle::CLOSURE == generator_options.import_style()) {
+    GenerationProfile::Scope scope(profile, "PrintMultipleFilesMode", true);
+    PrintMultipleFilesMode(model, file_name, context);
+    return true;
+  }
 
-  printer->Print(
-      "/**\n"
-      " * @fileoverview gRPC-Web generated client stub for '$file$'\n"
-      " */\n"
-      "\n"
-      "// Code generated by protoc-gen-grpc-web. DO NOT EDIT.\n"
-      "// versions:\n"
-      "// \tprotoc-gen-grpc-web v$version$\n"
-      "// \tprotoc              v$protoc_version$\n"
-      "// source: $source_file$\n"
-      "\n"
-      "\n",
-      "file", file->name());
+  if (ImportStyle::TYPESCRIPT == generator_options.import_style()) {
+    {
+      GenerationProfile::Scope scope(profile, "PrintTypescriptFile", true);
+      std::unique_ptr<ZeroCopyOutputStream> output(context->Open(file_name));
+      Printer printer(output.get(), '$', size_collector);
+      PrintFileHeader(&printer, model.vars);
+      PrintTypescriptFile(&printer, model);
+      MarkOutput(&printer, "");
+    }
+    if (size_collector != nullptr) {
+      GenerationProfile::Scope scope(profile, "WriteSizeManifest", true);
+      WriteSizeManifest(model, generator_options.import_style(), file_name,
+                        sizes, context);
+    }
+    return true;
+  }
 
-  PrintClosureES6Imports(printer, file, package_dot);
+  if (ImportStyle::ES_MODULE == generator_options.import_style()) {
+    {
+      GenerationProfile::Scope scope(profile, "PrintEsModuleFile", true);
+      std::unique_ptr<ZeroCopyOutputStream> output(context->Open(file_name));
+      Printer printer(output.get(), '$', size_collector);
+      PrintFileHeader(&printer, model.vars);
+      PrintEsModuleFile(&printer, model);
+      MarkOutput(&printer, "");
+    }
+    if (size_collector != nullptr) {
+      GenerationProfile::Scope scope(profile, "WriteSizeManifest", true);
+      WriteSizeManifest(model, generator_options.import_style(), file_name,
+                        sizes, context);
+    }
+    return true;
+  }
 
-  for (int i = 0; i < file->service_count(); ++i) {
-    const ServiceDescriptor* service = file->service(i);
+  {
+    GenerationProfile::Scope scope(profile, "PrintGrpcWebJsFile", true);
+    std::unique_ptr<ZeroCopyOutputStream> output(context->Open(file_name));
+    Printer printer(output.get(), '$', size_collector);
+    PrintFileHeader(&printer, model.vars);
+    PrintGrpcWebJsFile(&printer, model, generator_options.import_style());
+    MarkOutput(&printer, "");
+  }
+  if (size_collector != nullptr) {
+    GenerationProfile::Scope scope(profile, "WriteSizeManifest", true);
+    WriteSizeManifest(model, generator_options.import_style(), file_name,
+                      sizes, context);
+  }
 
-    string service_namespace = "proto." + package_dot + service->name();
-    printer->Print("export const $name$Client = $name$Client_import;\n", "name",
-                   service->name());
-    printer->Print(
-        "export const $name$PromiseClient = $name$PromiseClient_import;\n",
-        "name", service->name());
+  if (generator_options.decode_worker()) {
+    GenerationProfile::Scope scope(profile, "PrintDecodeWorkerFile", true);
+    std::unique_ptr<ZeroCopyOutputStream> worker_output(
+        context->Open(StripProto(file->name()) + "_grpc_web_worker.js"));
+    Printer worker_printer(worker_output.get(), '$');
+    PrintFileHeader(&worker_printer, model.vars, "response decoders");
+    PrintDecodeWorkerFile(&worker_printer, model);
   }
-}
 
-class GeneratorOptions {
- public:
-  GeneratorOptions();
+  if (generator_options.generate_dts()) {
+    GenerationProfile::Scope scope(profile, "PrintGrpcWebDtsFile", true);
+    string grpcweb_dts_file_name =
+        StripProto(file->name()) + "_grpc_web_pb.d.ts";
 
-  bool ParseFromOptions(const string& parameter, string* error);
-  bool ParseFromOptions(const std::vector<std::pair<string, string>>& options,
-                        string* error);
+    std::unique_ptr<ZeroCopyOutputStream> grpcweb_dts_output(
+        context->Open(grpcweb_dts_file_name));
+    Printer grpcweb_dts_printer(grpcweb_dts_output.get(), '$');
 
-  // Returns the name of the output file for |proto_file|.
-  string OutputFile(const string& proto_file) const;
+    PrintGrpcWebDtsFile(&grpcweb_dts_printer, model);
+  }
 
-  string mode() const { return mode_; }
-  string plugins() const { return plugins_; }
-  ImportStyle import_style() const { return import_style_; }
-  bool generate_dts() const { return generate_dts_; }
-  bool generate_closure_es6() const { return generate_closure_es6_; }
-  bool multiple_files() const { return multiple_files_; }
-  bool goog_promise() const { return goog_promise_; }
+  if (generator_options.generate_closure_es6()) {
+    GenerationProfile::Scope scope(profile, "PrintGrpcWebClosureES6File",
+                                   true);
+    string es6_file_name = StripProto(file->name()) + ".pb.grpc-web.js";
 
- private:
-  string file_name_;
-  string mode_;
-  string plugins_;
-  ImportStyle import_style_;
-  bool generate_dts_;
-  bool generate_closure_es6_;
-  bool multiple_files_;
-  bool goog_promise_;
-};
+    std::unique_ptr<ZeroCopyOutputStream> es6_output(
+        context->Open(es6_file_name));
+    Printer es6_printer(es6_output.get(), '$');
 
-GeneratorOptions::GeneratorOptions()
-    : file_name_(""),
-      mode_(""),
-      plugins_(""),
-      import_style_(ImportStyle::CLOSURE),
-      generate_dts_(false),
-      generate_closure_es6_(false),
-      multiple_files_(false),
-      goog_promise_(false) {}
+    PrintGrpcWebClosureES6File(&es6_printer, model);
+  }
 
-bool GeneratorOptions::ParseFromOptions(const string& parameter,
-                                        string* error) {
-  std::vector<std::pair<string, string>> options;
-  ParseGeneratorParameter(parameter, &options);
-  return ParseFromOptions(options, error);
+  return true;
 }
 
-bool GeneratorOptions::ParseFromOptions(
-    const std::vector<std::pair<string, string>>& options, string* error) {
-  for (const std::pair<string, string>& option : options) {
-    if ("out" == option.first) {
-      file_name_ = option.second;
-    } else if ("mode" == option.first) {
-      mode_ = option.second;
-    } else if ("import_style" == option.first) {
-      if ("closure" == option.second) {
-        import_style_ = ImportStyle::CLOSURE;
-      } else if ("experimental_closure_es6" == option.second) {
-        import_style_ = ImportStyle::CLOSURE;
-        generate_closure_es6_ = true;
-      } else if ("commonjs" == option.second) {
-        import_style_ = ImportStyle::COMMONJS;
-      } else if ("commonjs+dts" == option.second) {
-        import_style_ = ImportStyle::COMMONJS;
-        generate_dts_ = true;
-      } else if ("typescript" == option.second) {
-        import_style_ = ImportStyle::TYPESCRIPT;
-        generate_dts_ = true;
-      } else {
-        *error = "options: invalid import_style - " + option.second;
-        return false;
-      }
-    } else if ("multiple_files" == option.first) {
-      multiple_files_ = "True" == option.second;
-    } else if ("plugins" == option.first) {
-      plugins_ = option.second;
-    } else if ("goog_promise" == option.first) {
-      goog_promise_ = "True" == option.second;
-    } else {
-      *error = "unsupported option: " + option.first;
-      return false;
-    }
+// Generates all outputs for |file| into |context|, followed by the profile
+// sidecar when the profile option is set.
+bool GenerateFile(const FileDescriptor* file,
+                  const GeneratorOptions& generator_options,
+                  GeneratorContext* context, string* error) {
+  if (!generator_options.profile()) {
+    return GenerateOutputs(file, generator_options, context, nullptr, error);
   }
 
-  if (mode_.empty()) {
-    *error = "options: mode is required";
+  GenerationProfile profile;
+  ProfilingGeneratorContext profiling_context(context, &profile);
+  if (!GenerateOutputs(file, generator_options, &profiling_context, &profile,
+                       error)) {
     return false;
   }
 
+  std::unique_ptr<ZeroCopyOutputStream> output(
+      context->Open(StripProto(file->name()) + "_grpc_web_profile.json"));
+  Printer printer(output.get(), '$');
+  printer.PrintRaw(profile.ToJson(file->name()));
   return true;
 }
 
-string GeneratorOptions::OutputFile(const string& proto_file) const {
-  if (ImportStyle::TYPESCRIPT == import_style()) {
-    // Never use the value from the 'out' option when generating TypeScript.
-    string directory;
-    string basename;
-    PathSplit(proto_file, &directory, &basename);
-    return directory + UppercaseFirstLetter(StripProto(basename)) +
-           "ServiceClientPb.ts";
-  }
-  if (!file_name_.empty()) {
-    return file_name_;
-  }
-  return StripProto(proto_file) + "_grpc_web_pb.js";
+// Writes the profile of the whole protoc run, as opposed to that of each
+// file: how long option parsing took, once for all |file_count| files, and
+// the total time since |start_micros|.
+void WriteRunProfile(const GeneratorOptions& generator_options,
+                     size_t file_count, int64_t start_micros,
+                     GeneratorContext* context) {
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"files\": " << file_count << ",\n"
+       << "  \"total_micros\": " << NowMicros() - start_micros << ",\n"
+       << "  \"phases\": {\n"
+       << "    \"parse_options\": " << generator_options.parse_micros() << "\n"
+       << "  }\n"
+       << "}\n";
+  std::unique_ptr<ZeroCopyOutputStream> output(
+      context->Open("grpc_web_profile.json"));
+  Printer printer(output.get(), '$');
+  printer.PrintRaw(json.str());
 }
 
-class GrpcCodeGenerator : public CodeGenerator {
+// A GeneratorContext that keeps every opened file in memory, in the order
+// the files were opened, until WriteTo() copies them into the real context.
+// Used to generate several files concurrently while keeping the output
+// written to protoc deterministic, and to capture output for the cache.
+class BufferedGeneratorContext : public GeneratorContext {
  public:
-  GrpcCodeGenerator() {}
-  ~GrpcCodeGenerator() override {}
+  explicit BufferedGeneratorContext(const Version& compiler_version)
+      : compiler_version_(compiler_version) {}
 
-  uint64_t GetSupportedFeatures() const override {
-    // Code generators must explicitly support proto3 optional.
-    return CodeGenerator::FEATURE_PROTO3_OPTIONAL | CodeGenerator::FEATURE_SUPPORTS_EDITIONS;
+  ZeroCopyOutputStream* Open(const string& filename) override {
+    CodeGeneratorResponse::File* file = files_.add_file();
+    file->set_name(filename);
+    return new StringOutputStream(file->mutable_content());
   }
 
-  // Keep synced with protoc-gen-js: https://github.com/protocolbuffers/protobuf-javascript/blob/861c8020a5c0cba9b7cdf915dffde96a4421a1f4/generator/js_generator.h#L157-L158
-  Edition GetMinimumEdition() const override { return Edition::EDITION_PROTO2; }
-  Edition GetMaximumEdition() const override { return Edition::EDITION_2023; }
-
-  bool Generate(const FileDescriptor* file, const string& parameter,
-                GeneratorContext* context, string* error) const override {
-    GeneratorOptions generator_options;
-    if (!generator_options.ParseFromOptions(parameter, error)) {
-      return false;
-    }
-
-    std::map<string, string> vars;
-    std::map<string, string> method_descriptors;
-    string package = file->package();
-    vars["package"] = package;
-    vars["package_dot"] = package.empty() ? "" : package + '.';
-    vars["promise"] = "Promise";
-    vars["plugins"] = generator_options.plugins();
-
-    if ("binary" == generator_options.mode()) {
-      vars["mode"] = GetModeVar(Mode::OP);
-      vars["binary"] = "true";
-    } else if ("grpcweb" == generator_options.mode()) {
-      vars["mode"] = GetModeVar(Mode::GRPCWEB);
-      vars["format"] = "binary";
-    } else if ("grpcwebtext" == generator_options.mode()) {
-      vars["mode"] = GetModeVar(Mode::GRPCWEB);
-      vars["format"] = "text";
-    } else if ("jspb" == generator_options.mode()) {
-      vars["mode"] = GetModeVar(Mode::OP);
-      vars["binary"] = "false";
-      if (generator_options.goog_promise()) {
-        vars["promise"] = GRPC_PROMISE;
-      }
-    } else {
-      *error = "options: invalid mode - " + generator_options.mode();
-      return false;
-    }
+  void GetCompilerVersion(Version* version) const override {
+    *version = compiler_version_;
+  }
 
-    if (generator_options.generate_dts()) {
-      string proto_dts_file_name = StripProto(file->name()) + "_pb.d.ts";
-      std::unique_ptr<ZeroCopyOutputStream> proto_dts_output(
-          context->Open(proto_dts_file_name));
-      Printer proto_dts_printer(proto_dts_output.get(), '$');
-      PrintProtoDtsFile(&proto_dts_printer, file);
-    }
+  const CodeGeneratorResponse& files() const { return files_; }
+  CodeGeneratorResponse* mutable_files() { return &files_; }
 
-    if (!file->service_count()) {
-      // No services, nothing to do.
-      return true;
+  void WriteTo(GeneratorContext* context) const {
+    for (const CodeGeneratorResponse::File& file : files_.file()) {
+      std::unique_ptr<ZeroCopyOutputStream> output(context->Open(file.name()));
+      CodedOutputStream coded_output(output.get());
+      coded_output.WriteRaw(file.content().data(),
+                            static_cast<int>(file.content().size()));
     }
+  }
 
-    vars["version"]        = GRPC_WEB_VERSION;
-    vars["protoc_version"] = GetProtocVersion(context);
-    vars["source_file"]    = file->name();
+ private:
+  const Version compiler_version_;
+  CodeGeneratorResponse files_;
+};
 
-    string file_name = generator_options.OutputFile(file->name());
-    if (generator_options.multiple_files() &&
-        ImportStyle::CLOSURE == generator_options.import_style()) {
-      PrintMultipleFilesMode(file, file_name, context, vars);
-      return true;
+// Adds "full_name file package" for every type outside |file| that |message|
+// (or any of its nested messages) refers to. Generated code depends on which
+// file and package those types live in, which |file|'s own descriptor does
+// not record.
+void CollectExternalTypes(const Descriptor* message, const FileDescriptor* file,
+                          std::set<string>* types) {
+  for (int i = 0; i < message->field_count(); i++) {
+    const FieldDescriptor* field = message->field(i);
+    if (field->message_type() != nullptr &&
+        field->message_type()->file() != file) {
+      const Descriptor* type = field->message_type();
+      types->insert(type->full_name() + " " + type->file()->name() + " " +
+                    type->file()->package());
+    } else if (field->enum_type() != nullptr &&
+               field->enum_type()->file() != file) {
+      const EnumDescriptor* type = field->enum_type();
+      types->insert(type->full_name() + " " + type->file()->name() + " " +
+                    type->file()->package());
     }
+  }
+  for (int i = 0; i < message->nested_type_count(); i++) {
+    CollectExternalTypes(message->nested_type(i), file, types);
+  }
+}
 
-    std::unique_ptr<ZeroCopyOutputStream> output(context->Open(file_name));
-    Printer printer(output.get(), '$');
-    PrintFileHeader(&printer, vars);
+// Returns everything the output for |file| depends on. Two runs with the same
+// key material generate byte-identical output.
+string CacheKeyMaterial(const FileDescriptor* file,
+                        const GeneratorOptions& generator_options,
+                        const string& protoc_version) {
+  FileDescriptorProto file_proto;
+  file->CopyTo(&file_proto);
 
-    if (ImportStyle::TYPESCRIPT == generator_options.import_style()) {
-      PrintTypescriptFile(&printer, file, vars);
-      return true;
+  std::set<string> external_types;
+  for (int i = 0; i < file->message_type_count(); i++) {
+    CollectExternalTypes(file->message_type(i), file, &external_types);
+  }
+  for (const auto& entry : GetAllMessages(file)) {
+    const Descriptor* type = entry.second;
+    if (type->file() != file) {
+      external_types.insert(type->full_name() + " " + type->file()->name() +
+                            " " + type->file()->package());
     }
+  }
 
-    for (int i = 0; i < file->service_count(); ++i) {
-      const ServiceDescriptor* service = file->service(i);
-      vars["service_name"] = service->name();
-      switch (generator_options.import_style()) {
-        case ImportStyle::CLOSURE:
-          printer.Print(
-              vars,
-              "goog.provide('proto.$package_dot$$service_name$Client');\n");
-          printer.Print(vars,
-                        "goog.provide('proto.$package_dot$$service_name$"
-                        "PromiseClient');\n");
-          break;
-        case ImportStyle::COMMONJS:
-          break;
-        case ImportStyle::TYPESCRIPT:
-          break;
+  string key = "protoc-gen-grpc-web " + string(GRPC_WEB_VERSION) + "\n" +
+               "protoc " + protoc_version + "\n" +
+               generator_options.CacheKey() + "\n";
+  for (const string& type : external_types) {
+    key += type + "\n";
+  }
+  if (generator_options.plain_codecs()) {
+    // Plain codecs are generated from the fields of messages in other files
+    // too.
+    for (const auto& entry : GetCodecMessages(file)) {
+      if (entry.second->file() != file) {
+        key += entry.second->DebugString();
       }
     }
-    printer.Print("\n");
-
-    switch (generator_options.import_style()) {
-      case ImportStyle::CLOSURE:
-        if (vars["promise"] == GRPC_PROMISE) {
-          printer.Print(vars, "goog.require('grpc.web.promise');\n");
+  }
+  if (generator_options.size_manifest()) {
+    // The size manifest lists the dependencies of the imported .proto files,
+    // transitively, which |file|'s own descriptor does not record.
+    std::map<string, const FileDescriptor*> protos;
+    std::vector<const FileDescriptor*> pending = {file};
+    while (!pending.empty()) {
+      const FileDescriptor* proto = pending.back();
+      pending.pop_back();
+      for (int i = 0; i < proto->dependency_count(); i++) {
+        const FileDescriptor* dependency = proto->dependency(i);
+        if (protos.emplace(dependency->name(), dependency).second) {
+          pending.push_back(dependency);
         }
-        printer.Print(vars, "goog.require('grpc.web.MethodDescriptor');\n");
-        printer.Print(vars, "goog.require('grpc.web.MethodType');\n");
-        printer.Print(vars, "goog.require('grpc.web.$mode$ClientBase');\n");
-        printer.Print(vars, "goog.require('grpc.web.AbstractClientBase');\n");
-        printer.Print(vars, "goog.require('grpc.web.ClientReadableStream');\n");
-        printer.Print(vars, "goog.require('grpc.web.RpcError');\n");
-
-        PrintClosureDependencies(&printer, file);
-        printer.Print(vars, "\ngoog.requireType('grpc.web.ClientOptions');\n");
-        printer.Print("\n\n\n");
-        printer.Print("goog.scope(function() {\n\n");
-        break;
-      case ImportStyle::COMMONJS:
-        printer.Print(vars, "const grpc = {};\n");
-        printer.Print(vars, "grpc.web = require('grpc-web');\n\n");
-        PrintCommonJsMessagesDeps(&printer, file);
-        break;
-      case ImportStyle::TYPESCRIPT:
-        break;
+      }
     }
+    for (const auto& entry : protos) {
+      key += "dependencies " + entry.first + ":";
+      for (int i = 0; i < entry.second->dependency_count(); i++) {
+        key += " " + entry.second->dependency(i)->name();
+      }
+      key += "\n";
+    }
+  }
+  key += file_proto.SerializeAsString();
+  return key;
+}
 
-    for (int service_index = 0; service_index < file->service_count();
-         ++service_index) {
-      const ServiceDescriptor* service = file->service(service_index);
-      vars["service_name"] = service->name();
-      PrintServiceConstructor(&printer, vars, false);
-      PrintServiceConstructor(&printer, vars, true);
-
-      for (int method_index = 0; method_index < service->method_count();
-           ++method_index) {
-        const MethodDescriptor* method = service->method(method_index);
-        const Descriptor* input_type = method->input_type();
-        const Descriptor* output_type = method->output_type();
-        vars["js_method_name"] = LowercaseFirstLetter(method->name());
-        vars["method_name"] = method->name();
-        vars["in"] = input_type->full_name();
-        vars["out"] = output_type->full_name();
-        vars["method_descriptor"] =
-            "methodDescriptor_" + service->name() + "_" + method->name();
-
-        // Cross-file ref in CommonJS needs to use the module alias instead
-        // of the global name.
-        if (ImportStyle::COMMONJS == generator_options.import_style() &&
-            input_type->file() != file) {
-          vars["in_type"] = ModuleAlias(input_type->file()->name()) +
-                            GetNestedMessageName(input_type);
-        } else {
-          vars["in_type"] = "proto." + input_type->full_name();
-        }
-        if (ImportStyle::COMMONJS == generator_options.import_style() &&
-            output_type->file() != file) {
-          vars["out_type"] = ModuleAlias(output_type->file()->name()) +
-                             GetNestedMessageName(output_type);
-        } else {
-          vars["out_type"] = "proto." + output_type->full_name();
-        }
+// 64-bit FNV-1a. Only used to name cache entries; every entry also stores
+// its full key material, which is compared on lookup.
+string CacheEntryName(const string& key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.grpcwebcache",
+           static_cast<unsigned long long>(hash));
+  return name;
+}
 
-        // Client streaming is not supported yet
-        if (!method->client_streaming()) {
-          if (method->server_streaming()) {
-            vars["method_type"] = "grpc.web.MethodType.SERVER_STREAMING";
-            PrintMethodDescriptor(&printer, vars);
-            vars["client_type"] = "Client";
-            PrintServerStreamingCall(&printer, vars);
-            vars["client_type"] = "PromiseClient";
-            PrintServerStreamingCall(&printer, vars);
-          } else {
-            vars["method_type"] = "grpc.web.MethodType.UNARY";
-            PrintMethodDescriptor(&printer, vars);
-            PrintUnaryCall(&printer, vars);
-            PrintPromiseUnaryCall(&printer, vars);
-          }
-        }
-      }
+// A cache entry is the varint-prefixed key material followed by the
+// serialized CodeGeneratorResponse holding the generated files.
+bool ReadCacheEntry(const string& path, const string& key,
+                    CodeGeneratorResponse* files) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  if (!input) {
+    return false;
+  }
+  string contents((std::istreambuf_iterator<char>(input)),
+                  std::istreambuf_iterator<char>());
+  CodedInputStream coded_input(
+      reinterpret_cast<const uint8_t*>(contents.data()),
+      static_cast<int>(contents.size()));
+  uint32_t key_size;
+  string stored_key;
+  if (!coded_input.ReadVarint32(&key_size) || key_size != key.size() ||
+      !coded_input.ReadString(&stored_key, key_size) || stored_key != key) {
+    return false;
+  }
+  int position = coded_input.CurrentPosition();
+  return files->ParseFromArray(contents.data() + position,
+                               static_cast<int>(contents.size()) - position);
+}
+
+// Writes the entry to a temporary file first and renames it into place, so
+// that concurrent protoc runs sharing a cache never see a partial entry.
+// Failures are ignored: the cache only ever saves work.
+void WriteCacheEntry(const string& path, const string& key,
+                     const CodeGeneratorResponse& files) {
+  string entry;
+  {
+    StringOutputStream output(&entry);
+    CodedOutputStream coded_output(&output);
+    coded_output.WriteVarint32(static_cast<uint32_t>(key.size()));
+    coded_output.WriteString(key);
+    files.SerializeToCodedStream(&coded_output);
+  }
+  std::ostringstream temp_path;
+  temp_path << path << ".tmp." << std::this_thread::get_id() << "."
+            << std::chrono::steady_clock::now().time_since_epoch().count();
+  {
+    std::ofstream output(temp_path.str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output || !output.write(entry.data(), entry.size())) {
+      output.close();
+      std::remove(temp_path.str().c_str());
+      return;
     }
+  }
+  if (std::rename(temp_path.str().c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.str().c_str());
+  }
+}
 
-    switch (generator_options.import_style()) {
-      case ImportStyle::CLOSURE:
-        printer.Print("}); // goog.scope\n\n");
-        break;
-      case ImportStyle::COMMONJS:
-        if (!vars["package"].empty()) {
-          printer.Print(vars, "module.exports = proto.$package$;\n\n");
-        } else {
-          printer.Print(vars, "module.exports = proto;\n\n");
-        }
-        break;
-      case ImportStyle::TYPESCRIPT:
-        break;
+// Like GenerateFile, but consults the cache in |generator_options| first.
+// On a hit the cached files are replayed into |context|, or nothing is
+// emitted at all when cache_skip_unchanged is set.
+bool GenerateFileWithCache(const FileDescriptor* file,
+                           const GeneratorOptions& generator_options,
+                           GeneratorContext* context, string* error) {
+  // A cached profile would report the timings of the run that filled the
+  // cache, so profiling always generates.
+  if (generator_options.cache_dir().empty() || generator_options.profile()) {
+    return GenerateFile(file, generator_options, context, error);
+  }
+
+  Version compiler_version;
+  context->GetCompilerVersion(&compiler_version);
+  string key = CacheKeyMaterial(file, generator_options,
+                                GetProtocVersion(context));
+  string path = generator_options.cache_dir() + "/" + CacheEntryName(key);
+
+  BufferedGeneratorContext output(compiler_version);
+  if (ReadCacheEntry(path, key, output.mutable_files())) {
+    if (!generator_options.cache_skip_unchanged()) {
+      output.WriteTo(context);
     }
+    return true;
+  }
 
-    if (generator_options.generate_dts()) {
-      string grpcweb_dts_file_name =
-          StripProto(file->name()) + "_grpc_web_pb.d.ts";
-      string proto_dts_file_name = StripProto(file->name()) + "_pb.d.ts";
+  if (!GenerateFile(file, generator_options, &output, error)) {
+    return false;
+  }
+  WriteCacheEntry(path, key, output.files());
+  output.WriteTo(context);
+  return true;
+}
 
-      std::unique_ptr<ZeroCopyOutputStream> grpcweb_dts_output(
-          context->Open(grpcweb_dts_file_name));
-      Printer grpcweb_dts_printer(grpcweb_dts_output.get(), '$');
+}  // namespace
 
-      PrintGrpcWebDtsFile(&grpcweb_dts_printer, file);
-    }
+// Edit the version here prior to release
+const char GRPC_WEB_VERSION[] = "2.0.2";
 
-    if (generator_options.generate_closure_es6()) {
-      string es6_file_name = StripProto(file->name()) + ".pb.grpc-web.js";
+uint64_t GrpcCodeGenerator::GetSupportedFeatures() const {
+  // Code generators must explicitly support proto3 optional.
+  return CodeGenerator::FEATURE_PROTO3_OPTIONAL |
+         CodeGenerator::FEATURE_SUPPORTS_EDITIONS;
+}
 
-      std::unique_ptr<ZeroCopyOutputStream> es6_output(
-          context->Open(es6_file_name));
-      Printer es6_printer(es6_output.get(), '$');
+bool GrpcCodeGenerator::Generate(const FileDescriptor* file,
+                                 const string& parameter,
+                                 GeneratorContext* context,
+                                 string* error) const {
+  GeneratorOptions generator_options;
+  if (!generator_options.ParseFromOptions(parameter, error)) {
+    return false;
+  }
+  return GenerateFileWithCache(file, generator_options, context, error);
+}
 
-      PrintGrpcWebClosureES6File(&es6_printer, file);
-    }
+bool GrpcCodeGenerator::GenerateAll(
+    const std::vector<const FileDescriptor*>& files, const string& parameter,
+    GeneratorContext* context, string* error) const {
+  int64_t start_micros = NowMicros();
+  GeneratorOptions generator_options;
+  if (!generator_options.ParseFromOptions(parameter, error)) {
+    return false;
+  }
+
+  size_t workers = generator_options.parallelism();
+  if (workers == 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers = std::min(workers, files.size());
 
+  if (workers <= 1) {
+    for (const FileDescriptor* file : files) {
+      if (!GenerateFileWithCache(file, generator_options, context, error)) {
+        *error = file->name() + ": " + *error;
+        return false;
+      }
+    }
+    if (generator_options.profile()) {
+      WriteRunProfile(generator_options, files.size(), start_micros, context);
+    }
     return true;
   }
-};
 
-}  // namespace
-}  // namespace web
-}  // namespace grpc
+  // Workers generate files into per-file buffers, claiming them in order.
+  // This thread copies each buffer into |context| as soon as it and all the
+  // files before it are done, so the output order matches a serial run.
+  Version compiler_version;
+  context->GetCompilerVersion(&compiler_version);
+
+  struct FileResult {
+    std::unique_ptr<BufferedGeneratorContext> output;
+    string error;
+    bool ok = false;
+    bool done = false;
+  };
+  std::vector<FileResult> results(files.size());
+  std::atomic<size_t> next_file(0);
+  std::atomic<bool> failed(false);
+  std::mutex mu;
+  std::condition_variable file_done;
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (size_t i = 0; i < workers; i++) {
+    threads.emplace_back([&]() {
+      size_t index;
+      while (!failed && (index = next_file++) < files.size()) {
+        std::unique_ptr<BufferedGeneratorContext> output(
+            new BufferedGeneratorContext(compiler_version));
+        string file_error;
+        bool ok = GenerateFileWithCache(files[index], generator_options,
+                                        output.get(), &file_error);
+        if (!ok) {
+          failed = true;
+        }
+        std::lock_guard<std::mutex> lock(mu);
+        results[index].output = std::move(output);
+        results[index].error = file_error;
+        results[index].ok = ok;
+        results[index].done = true;
+        file_done.notify_all();
+      }
+    });
+  }
+
+  bool ok = true;
+  for (size_t index = 0; index < files.size(); index++) {
+    std::unique_ptr<BufferedGeneratorContext> output;
+    {
+      std::unique_lock<std::mutex> lock(mu);
+      file_done.wait(lock,
+                     [&]() { return results[index].done || failed; });
+      if (!results[index].done) {
+        // A later file failed and the workers stopped before this one;
+        // report that failure below once the workers have finished.
+        ok = false;
+        break;
+      }
+      if (!results[index].ok) {
+        *error = files[index]->name() + ": " + results[index].error;
+        ok = false;
+        break;
+      }
+      output = std::move(results[index].output);
+    }
+    output->WriteTo(context);
+  }
 
-int main(int argc, char* argv[]) {
-  if (argc == 2 && std::string(argv[1]) == "--version") {
-    std::cout << argv[0] << " " << grpc::web::GRPC_WEB_VERSION << std::endl;
-    return 0;
+  for (std::thread& thread : threads) {
+    thread.join();
   }
 
-  grpc::web::GrpcCodeGenerator generator;
-  PluginMain(argc, argv, &generator);
-  return 0;
+  if (!ok && error->empty()) {
+    for (size_t index = 0; index < files.size(); index++) {
+      if (results[index].done && !results[index].ok) {
+        *error = files[index]->name() + ": " + results[index].error;
+        break;
+      }
+    }
+  }
+  if (ok && generator_options.profile()) {
+    WriteRunProfile(generator_options, files.size(), start_micros, context);
+  }
+  return ok;
 }
+
+}  // namespace web
+}  // namespace grpc
@@ -0,0 +1,69 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef JAVASCRIPT_NET_GRPC_WEB_GENERATOR_GRPC_GENERATOR_H_
+#define JAVASCRIPT_NET_GRPC_WEB_GENERATOR_GRPC_GENERATOR_H_
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/descriptor.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace grpc {
+namespace web {
+
+// The version reported by `protoc-gen-grpc-web --version` and stamped into
+// the header of every generated file.
+extern const char GRPC_WEB_VERSION[];
+
+class GrpcCodeGenerator : public google::protobuf::compiler::CodeGenerator {
+ public:
+  GrpcCodeGenerator() {}
+  ~GrpcCodeGenerator() override {}
+
+  uint64_t GetSupportedFeatures() const override;
+
+  // Keep synced with protoc-gen-js: https://github.com/protocolbuffers/protobuf-javascript/blob/861c8020a5c0cba9b7cdf915dffde96a4421a1f4/generator/js_generator.h#L157-L158
+  google::protobuf::Edition GetMinimumEdition() const override {
+    return google::protobuf::Edition::EDITION_PROTO2;
+  }
+  google::protobuf::Edition GetMaximumEdition() const override {
+    return google::protobuf::Edition::EDITION_2023;
+  }
+
+  bool Generate(const google::protobuf::FileDescriptor* file,
+                const std::string& parameter,
+                google::protobuf::compiler::GeneratorContext* context,
+                std::string* error) const override;
+
+  // Generates |files| using a bounded pool of worker threads when the
+  // "parallelism" option asks for more than one. Output is written to
+  // |context| in the same order as a serial run.
+  bool GenerateAll(
+      const std::vector<const google::protobuf::FileDescriptor*>& files,
+      const std::string& parameter,
+      google::protobuf::compiler::GeneratorContext* context,
+      std::string* error) const override;
+};
+
+}  // namespace web
+}  // namespace grpc
+
+#endif  // JAVASCRIPT_NET_GRPC_WEB_GENERATOR_GRPC_GENERATOR_H_
@@ -0,0 +1,402 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Benchmarks GrpcCodeGenerator over a synthetic, in-memory descriptor set.
+//
+// The descriptor set is shaped like a large monorepo: a fan of shared
+// "common" files holding deeply nested messages, and many service files that
+// all depend on every common file. Each import_style / mode combination is
+// run over the whole set and reported as files/sec, emitted bytes/sec and
+// peak RSS, so generator changes can be compared against a baseline run.
+// Each combination runs in its own forked process, so its peak RSS, which
+// includes the descriptor set, is not carried over from the ones before.
+//
+// Usage:
+//   grpc_generator_benchmark [--files=N] [--services=N] [--methods=N]
+//                            [--nesting=N] [--fan_out=N] [--iterations=N]
+//                            [--parallelism=N] [--config=NAME]
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "javascript/net/grpc/web/generator/grpc_generator.h"
+
+using google::protobuf::DescriptorPool;
+using google::protobuf::DescriptorProto;
+using google::protobuf::FieldDescriptorProto;
+using google::protobuf::FileDescriptor;
+using google::protobuf::FileDescriptorProto;
+using google::protobuf::MethodDescriptorProto;
+using google::protobuf::ServiceDescriptorProto;
+using google::protobuf::compiler::GeneratorContext;
+using google::protobuf::io::StringOutputStream;
+using google::protobuf::io::ZeroCopyOutputStream;
+
+namespace grpc {
+namespace web {
+namespace {
+
+using std::string;
+
+struct BenchmarkParams {
+  int files = 200;       // service files to generate
+  int services = 2;      // services per file
+  int methods = 20;      // methods per service
+  int nesting = 4;       // nesting depth of the shared messages
+  int fan_out = 16;      // common files every service file depends on
+  int iterations = 3;    // passes over the whole descriptor set
+  int parallelism = 1;   // the generator's "parallelism" option
+  string config;         // run only the named configuration, if set
+};
+
+struct BenchmarkConfig {
+  const char* name;
+  const char* parameter;
+};
+
+const BenchmarkConfig kConfigs[] = {
+    {"closure", "import_style=closure,mode=grpcwebtext"},
+    {"commonjs", "import_style=commonjs,mode=grpcwebtext"},
+    {"commonjs+dts", "import_style=commonjs+dts,mode=grpcwebtext"},
+    {"typescript", "import_style=typescript,mode=grpcwebtext"},
+    {"experimental_closure_es6",
+     "import_style=experimental_closure_es6,mode=grpcwebtext"},
+    {"multiple_files",
+     "import_style=closure,mode=grpcwebtext,multiple_files=True"},
+};
+
+// Collects every generated file in memory so that only the generator itself
+// is measured, not the file system.
+class InMemoryGeneratorContext : public GeneratorContext {
+ public:
+  ZeroCopyOutputStream* Open(const string& filename) override {
+    outputs_.emplace_back(new string());
+    return new StringOutputStream(outputs_.back().get());
+  }
+
+  size_t TotalBytes() const {
+    size_t total = 0;
+    for (const auto& output : outputs_) {
+      total += output->size();
+    }
+    return total;
+  }
+
+  size_t FileCount() const { return outputs_.size(); }
+
+ private:
+  std::vector<std::unique_ptr<string>> outputs_;
+};
+
+// Returns the peak resident set size of this process in KiB, or 0 on Windows.
+long PeakRssKib() {
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void AddField(DescriptorProto* message, const string& name, int number,
+              FieldDescriptorProto::Type type,
+              FieldDescriptorProto::Label label,
+              const string& type_name = "") {
+  FieldDescriptorProto* field = message->add_field();
+  field->set_name(name);
+  field->set_number(number);
+  field->set_type(type);
+  field->set_label(label);
+  if (!type_name.empty()) {
+    field->set_type_name(type_name);
+  }
+}
+
+// Fills |message| with a representative mix of scalar, repeated, enum, map
+// and oneof fields, plus a chain of |depth| nested messages.
+void BuildNestedMessage(DescriptorProto* message, const string& full_name,
+                        int depth) {
+  AddField(message, "name", 1, FieldDescriptorProto::TYPE_STRING,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  AddField(message, "count", 2, FieldDescriptorProto::TYPE_INT64,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  AddField(message, "tags", 3, FieldDescriptorProto::TYPE_STRING,
+           FieldDescriptorProto::LABEL_REPEATED);
+  AddField(message, "payload", 4, FieldDescriptorProto::TYPE_BYTES,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  AddField(message, "kind", 5, FieldDescriptorProto::TYPE_ENUM,
+           FieldDescriptorProto::LABEL_OPTIONAL, "." + full_name + ".Kind");
+
+  google::protobuf::EnumDescriptorProto* kind = message->add_enum_type();
+  kind->set_name("Kind");
+  for (int i = 0; i < 4; i++) {
+    google::protobuf::EnumValueDescriptorProto* value = kind->add_value();
+    value->set_name("KIND_" + std::to_string(i));
+    value->set_number(i);
+  }
+
+  DescriptorProto* entry = message->add_nested_type();
+  entry->set_name("AttributesEntry");
+  entry->mutable_options()->set_map_entry(true);
+  AddField(entry, "key", 1, FieldDescriptorProto::TYPE_STRING,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  AddField(entry, "value", 2, FieldDescriptorProto::TYPE_STRING,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  AddField(message, "attributes", 6, FieldDescriptorProto::TYPE_MESSAGE,
+           FieldDescriptorProto::LABEL_REPEATED,
+           "." + full_name + ".AttributesEntry");
+
+  message->add_oneof_decl()->set_name("choice");
+  AddField(message, "text", 7, FieldDescriptorProto::TYPE_STRING,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  message->mutable_field(message->field_size() - 1)->set_oneof_index(0);
+  AddField(message, "number", 8, FieldDescriptorProto::TYPE_DOUBLE,
+           FieldDescriptorProto::LABEL_OPTIONAL);
+  message->mutable_field(message->field_size() - 1)->set_oneof_index(0);
+
+  if (depth > 0) {
+    DescriptorProto* child = message->add_nested_type();
+    child->set_name("Level" + std::to_string(depth));
+    string child_full_name = full_name + "." + child->name();
+    BuildNestedMessage(child, child_full_name, depth - 1);
+    AddField(message, "children", 9, FieldDescriptorProto::TYPE_MESSAGE,
+             FieldDescriptorProto::LABEL_REPEATED, "." + child_full_name);
+  }
+}
+
+// Returns the full name of the innermost nested message of a common file.
+string InnermostCommonMessage(int index, int nesting) {
+  string name = "bench.common.c" + std::to_string(index) + ".Common";
+  for (int depth = nesting; depth > 0; depth--) {
+    name += ".Level" + std::to_string(depth);
+  }
+  return name;
+}
+
+FileDescriptorProto BuildCommonFile(int index, const BenchmarkParams& params) {
+  FileDescriptorProto file;
+  file.set_name("bench/common/common_" + std::to_string(index) + ".proto");
+  file.set_package("bench.common.c" + std::to_string(index));
+  file.set_syntax("proto3");
+  DescriptorProto* message = file.add_message_type();
+  message->set_name("Common");
+  BuildNestedMessage(message, file.package() + ".Common", params.nesting);
+  return file;
+}
+
+FileDescriptorProto BuildServiceFile(int index,
+                                     const BenchmarkParams& params) {
+  FileDescriptorProto file;
+  file.set_name("bench/services/service_" + std::to_string(index) + ".proto");
+  file.set_package("bench.services.s" + std::to_string(index));
+  file.set_syntax("proto3");
+  for (int i = 0; i < params.fan_out; i++) {
+    file.add_dependency("bench/common/common_" + std::to_string(i) + ".proto");
+  }
+
+  for (int s = 0; s < params.services; s++) {
+    ServiceDescriptorProto* service = file.add_service();
+    service->set_name("Service" + std::to_string(s));
+    for (int m = 0; m < params.methods; m++) {
+      string method_name = "Method" + std::to_string(m);
+      string request_name = service->name() + method_name + "Request";
+      DescriptorProto* request = file.add_message_type();
+      request->set_name(request_name);
+      BuildNestedMessage(request, file.package() + "." + request_name, 1);
+      if (params.fan_out > 0) {
+        int dep = (s * params.methods + m) % params.fan_out;
+        AddField(request, "common", 10, FieldDescriptorProto::TYPE_MESSAGE,
+                 FieldDescriptorProto::LABEL_OPTIONAL,
+                 ".bench.common.c" + std::to_string(dep) + ".Common");
+      }
+
+      MethodDescriptorProto* method = service->add_method();
+      method->set_name(method_name);
+      method->set_input_type("." + file.package() + "." + request_name);
+      if (params.fan_out > 0) {
+        method->set_output_type(
+            "." + InnermostCommonMessage(m % params.fan_out, params.nesting));
+      } else {
+        method->set_output_type("." + file.package() + "." + request_name);
+      }
+      method->set_server_streaming(m % 3 == 2);
+    }
+  }
+  return file;
+}
+
+bool ParseFlag(const string& arg, const string& name, int* value) {
+  string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = std::atoi(arg.c_str() + prefix.size());
+  return true;
+}
+
+bool ParseArgs(int argc, char* argv[], BenchmarkParams* params) {
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (ParseFlag(arg, "files", &params->files) ||
+        ParseFlag(arg, "services", &params->services) ||
+        ParseFlag(arg, "methods", &params->methods) ||
+        ParseFlag(arg, "nesting", &params->nesting) ||
+        ParseFlag(arg, "fan_out", &params->fan_out) ||
+        ParseFlag(arg, "iterations", &params->iterations) ||
+        ParseFlag(arg, "parallelism", &params->parallelism)) {
+      continue;
+    }
+    if (arg.compare(0, 9, "--config=") == 0) {
+      params->config = arg.substr(9);
+      continue;
+    }
+    fprintf(stderr, "unknown flag: %s\n", arg.c_str());
+    return false;
+  }
+  return params->files > 0 && params->iterations > 0 &&
+         params->parallelism >= 0;
+}
+
+// Runs the iterations of |config| over |files| and prints its row of results.
+int RunConfig(const BenchmarkConfig& config,
+              const std::vector<const FileDescriptor*>& files,
+              const BenchmarkParams& params) {
+  GrpcCodeGenerator generator;
+  string parameter = string(config.parameter) +
+                     ",parallelism=" + std::to_string(params.parallelism);
+  size_t total_bytes = 0;
+  size_t total_outputs = 0;
+  double total_seconds = 0;
+  for (int iteration = 0; iteration < params.iterations; iteration++) {
+    InMemoryGeneratorContext context;
+    auto start = std::chrono::steady_clock::now();
+    string error;
+    if (!generator.GenerateAll(files, parameter, &context, &error)) {
+      fprintf(stderr, "%s: %s\n", config.name, error.c_str());
+      return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    total_seconds += std::chrono::duration<double>(end - start).count();
+    total_bytes += context.TotalBytes();
+    total_outputs += context.FileCount();
+  }
+  double generated_files =
+      static_cast<double>(files.size()) * params.iterations;
+  printf("%-26s %12.3f %12.0f %14zu %14.2f %12ld\n", config.name,
+         total_seconds, generated_files / total_seconds,
+         total_outputs / params.iterations,
+         total_bytes / total_seconds / (1024.0 * 1024.0), PeakRssKib());
+  return 0;
+}
+
+int RunBenchmark(const BenchmarkParams& params) {
+  DescriptorPool pool;
+  std::vector<const FileDescriptor*> files;
+  for (int i = 0; i < params.fan_out; i++) {
+    const FileDescriptor* file = pool.BuildFile(BuildCommonFile(i, params));
+    if (file == nullptr) {
+      fprintf(stderr, "failed to build common file %d\n", i);
+      return 1;
+    }
+    files.push_back(file);
+  }
+  for (int i = 0; i < params.files; i++) {
+    const FileDescriptor* file = pool.BuildFile(BuildServiceFile(i, params));
+    if (file == nullptr) {
+      fprintf(stderr, "failed to build service file %d\n", i);
+      return 1;
+    }
+    files.push_back(file);
+  }
+
+  printf("descriptor set: %zu files (%d service files x %d services x %d "
+         "methods, nesting %d, fan-out %d), %d iterations, parallelism %d\n",
+         files.size(), params.files, params.services, params.methods,
+         params.nesting, params.fan_out, params.iterations,
+         params.parallelism);
+  printf("%-26s %12s %12s %14s %14s %12s\n", "config", "seconds",
+         "files/sec", "outputs", "MiB/sec", "peak RSS KiB");
+
+  for (const BenchmarkConfig& config : kConfigs) {
+    if (!params.config.empty() && params.config != config.name) {
+      continue;
+    }
+#ifdef _WIN32
+    if (RunConfig(config, files, params) != 0) {
+      return 1;
+    }
+#else
+    // The peak RSS of a process never goes down, so each configuration runs
+    // in a child process of its own, which reports its own peak.
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      int status = RunConfig(config, files, params);
+      fflush(stdout);
+      _exit(status);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      return 1;
+    }
+#endif
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace web
+}  // namespace grpc
+
+int main(int argc, char* argv[]) {
+  grpc::web::BenchmarkParams params;
+  if (!grpc::web::ParseArgs(argc, argv, &params)) {
+    fprintf(stderr,
+            "usage: %s [--files=N] [--services=N] [--methods=N] "
+            "[--nesting=N] [--fan_out=N] [--iterations=N] [--parallelism=N] "
+            "[--config=NAME]\n",
+            argv[0]);
+    return 1;
+  }
+  return grpc::web::RunBenchmark(params);
+}
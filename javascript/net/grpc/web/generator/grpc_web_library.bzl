@@ -0,0 +1,156 @@
+"""Bazel rule generating gRPC-Web clients from a proto_library.
+
+The rule runs protoc-gen-grpc-web directly on the descriptor sets of the
+proto_library instead of going through protoc. Its actions support
+persistent workers, so a single warm generator process serves all of them
+when the worker strategy is enabled (the default), e.g.:
+
+    load(
+        "@com_github_grpc_grpc_web//javascript/net/grpc/web/generator:grpc_web_library.bzl",
+        "grpc_web_library",
+    )
+
+    grpc_web_library(
+        name = "echo_grpc_web",
+        proto = ":echo_proto",
+        import_style = "commonjs+dts",
+        mode = "grpcwebtext",
+    )
+
+Pass --strategy=GrpcWebGenerate=sandboxed to run without workers.
+"""
+
+load("@rules_proto//proto:defs.bzl", "ProtoInfo")
+
+def _import_path(src, proto_info):
+    """Returns the path protoc would use to import src."""
+    root = proto_info.proto_source_root
+    if root and root != "." and src.path.startswith(root + "/"):
+        return src.path[len(root) + 1:]
+    return src.short_path
+
+# Options whose outputs cannot be declared before the generator runs, or
+# which are set by the attributes of the rule.
+_UNSUPPORTED_OPTIONS = {
+    "cache_skip_unchanged": "it leaves the outputs of unchanged files empty",
+    "import_style": "use the import_style attribute",
+    "mode": "use the mode attribute",
+    "multiple_files": "its outputs depend on the services of each file",
+    "out": "every file would be generated into the same output",
+}
+
+def _parse_options(extra_options):
+    """Returns the extra_options as a dict, failing on unsupported ones."""
+    options = {}
+    for entry in extra_options:
+        for option in entry.split(","):
+            key, _, value = option.partition("=")
+            if key in _UNSUPPORTED_OPTIONS:
+                fail("extra_options: %s is not supported, %s" %
+                     (key, _UNSUPPORTED_OPTIONS[key]))
+            options[key] = value
+    return options
+
+def _outputs(proto_file, import_style, options):
+    """Returns the files protoc-gen-grpc-web may generate for proto_file."""
+    base = proto_file[:-len(".proto")]
+    if import_style == "typescript":
+        directory, _, name = base.rpartition("/")
+        prefix = directory + "/" if directory else ""
+        outputs = [
+            prefix + name[:1].upper() + name[1:] + "ServiceClientPb.ts",
+            base + "_pb.d.ts",
+        ]
+    else:
+        outputs = [base + "_grpc_web_pb.js"]
+    if import_style == "commonjs+dts":
+        outputs += [base + "_grpc_web_pb.d.ts", base + "_pb.d.ts"]
+    if options.get("decode_worker") == "True":
+        outputs.append(base + "_grpc_web_worker.js")
+    if options.get("size_manifest") == "True":
+        outputs.append(base + "_grpc_web_size.json")
+    if options.get("profile") == "True":
+        outputs.append(base + "_grpc_web_profile.json")
+    return outputs
+
+def _grpc_web_library_impl(ctx):
+    proto_info = ctx.attr.proto[ProtoInfo]
+    out_dir = "/".join([
+        part
+        for part in [ctx.bin_dir.path, ctx.label.workspace_root, ctx.label.package, ctx.label.name]
+        if part
+    ])
+
+    options = _parse_options(ctx.attr.extra_options)
+    parameter = "import_style=%s,mode=%s" % (ctx.attr.import_style, ctx.attr.mode)
+    if ctx.attr.extra_options:
+        parameter += "," + ",".join(ctx.attr.extra_options)
+
+    files_to_generate = []
+    outputs = []
+    for src in proto_info.direct_sources:
+        proto_file = _import_path(src, proto_info)
+        files_to_generate.append(proto_file)
+        for output in _outputs(proto_file, ctx.attr.import_style, options):
+            outputs.append(ctx.actions.declare_file(ctx.label.name + "/" + output))
+    if options.get("profile") == "True":
+        # The profile of the whole run, see the profile option.
+        outputs.append(ctx.actions.declare_file(ctx.label.name + "/grpc_web_profile.json"))
+
+    args = ctx.actions.args()
+    args.add_all(proto_info.transitive_descriptor_sets, format_each = "--descriptor_set_in=%s")
+    args.add_all(files_to_generate, format_each = "--file_to_generate=%s")
+    args.add(parameter, format = "--parameter=%s")
+    args.add(out_dir, format = "--out_dir=%s")
+    args.add_all(outputs, format_each = "--declared_output=%s")
+    args.use_param_file("@%s", use_always = True)
+    args.set_param_file_format("multiline")
+
+    ctx.actions.run(
+        executable = ctx.executable._generator,
+        arguments = [args],
+        inputs = proto_info.transitive_descriptor_sets,
+        outputs = outputs,
+        mnemonic = "GrpcWebGenerate",
+        progress_message = "Generating gRPC-Web client for %{label}",
+        execution_requirements = {
+            "supports-workers": "1",
+            "requires-worker-protocol": "proto",
+        },
+    )
+
+    return [DefaultInfo(files = depset(outputs))]
+
+grpc_web_library = rule(
+    implementation = _grpc_web_library_impl,
+    doc = "Generates gRPC-Web client code for the services of a proto_library.",
+    attrs = {
+        "proto": attr.label(
+            doc = "The proto_library to generate clients for.",
+            mandatory = True,
+            providers = [ProtoInfo],
+        ),
+        "import_style": attr.string(
+            doc = "The import_style option of protoc-gen-grpc-web.",
+            default = "commonjs",
+            values = ["closure", "commonjs", "commonjs+dts", "typescript", "esm"],
+        ),
+        "mode": attr.string(
+            doc = "The mode option of protoc-gen-grpc-web.",
+            default = "grpcwebtext",
+            values = ["grpcwebtext", "grpcweb"],
+        ),
+        "extra_options": attr.string_list(
+            doc = "Further protoc-gen-grpc-web options, e.g. \"parallelism=0\". " +
+                  "The files written by size_manifest, profile and " +
+                  "decode_worker are declared as outputs too. " +
+                  "multiple_files, out and cache_skip_unchanged are not " +
+                  "supported, nor import_style and mode, which are attributes.",
+        ),
+        "_generator": attr.label(
+            default = Label("//javascript/net/grpc/web/generator:protoc-gen-grpc-web"),
+            executable = True,
+            cfg = "exec",
+        ),
+    },
+)
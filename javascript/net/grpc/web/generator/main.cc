@@ -0,0 +1,49 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <google/protobuf/compiler/plugin.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "javascript/net/grpc/web/generator/grpc_generator.h"
+#include "javascript/net/grpc/web/generator/persistent_worker.h"
+
+int main(int argc, char* argv[]) {
+  if (argc == 2 && std::string(argv[1]) == "--version") {
+    std::cout << argv[0] << " " << grpc::web::GRPC_WEB_VERSION << std::endl;
+    return 0;
+  }
+
+  grpc::web::GrpcCodeGenerator generator;
+  std::vector<std::string> arguments(argv + 1, argv + argc);
+  for (const std::string& argument : arguments) {
+    if (argument == "--persistent_worker") {
+      return grpc::web::RunPersistentWorker(generator, 0, 1);
+    }
+  }
+  // Bazel runs actions that support workers as "<binary> @flagfile" when
+  // they do not run in a worker.
+  if (!arguments.empty() && arguments[0][0] == '@') {
+    return grpc::web::RunWorkRequest(generator, arguments);
+  }
+
+  google::protobuf::compiler::PluginMain(argc, argv, &generator);
+  return 0;
+}
@@ -0,0 +1,387 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "javascript/net/grpc/web/generator/persistent_worker.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <google/protobuf/compiler/plugin.h>
+#include <google/protobuf/compiler/plugin.pb.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+
+using google::protobuf::FileDescriptorProto;
+using google::protobuf::FileDescriptorSet;
+using google::protobuf::compiler::CodeGenerator;
+using google::protobuf::compiler::CodeGeneratorRequest;
+using google::protobuf::compiler::CodeGeneratorResponse;
+using google::protobuf::compiler::GenerateCode;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::FileInputStream;
+using google::protobuf::io::FileOutputStream;
+using google::protobuf::io::StringOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+namespace grpc {
+namespace web {
+namespace {
+
+using std::string;
+
+// Field numbers of the WorkRequest and WorkResponse messages in Bazel's
+// src/main/protobuf/worker_protocol.proto. Only the fields used here are
+// listed; all others are skipped.
+const int kWorkRequestArgumentsField = 1;
+const int kWorkRequestRequestIdField = 3;
+const int kWorkResponseExitCodeField = 1;
+const int kWorkResponseOutputField = 2;
+const int kWorkResponseRequestIdField = 3;
+
+struct WorkRequest {
+  std::vector<string> arguments;
+  int32_t request_id = 0;
+};
+
+bool ReadFile(const string& path, string* contents) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  if (!input) {
+    return false;
+  }
+  contents->assign(std::istreambuf_iterator<char>(input),
+                   std::istreambuf_iterator<char>());
+  return !input.bad();
+}
+
+// Replaces every @FILE argument with the lines of FILE.
+bool ExpandFlagfiles(const std::vector<string>& arguments,
+                     std::vector<string>* expanded, string* error) {
+  for (const string& argument : arguments) {
+    if (argument.empty() || argument[0] != '@') {
+      expanded->push_back(argument);
+      continue;
+    }
+    std::ifstream flagfile(argument.substr(1));
+    if (!flagfile) {
+      *error = "cannot read flagfile " + argument.substr(1);
+      return false;
+    }
+    string line;
+    while (std::getline(flagfile, line)) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (!line.empty()) {
+        expanded->push_back(line);
+      }
+    }
+  }
+  return true;
+}
+
+// Creates |path| and any missing parent directories.
+bool MakeDirectories(const string& path) {
+  for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+    string directory = path.substr(0, slash);
+#ifdef _WIN32
+    int result = _mkdir(directory.c_str());
+#else
+    int result = mkdir(directory.c_str(), 0755);
+#endif
+    if (result != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (slash == string::npos) {
+      return true;
+    }
+  }
+}
+
+bool WriteFile(const string& path, const string& contents) {
+  string::size_type last_slash = path.rfind('/');
+  if (last_slash != string::npos && last_slash > 0 &&
+      !MakeDirectories(path.substr(0, last_slash))) {
+    return false;
+  }
+  std::ofstream output(path,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  return output && output.write(contents.data(), contents.size());
+}
+
+// Adds |name| and its dependencies to |ordered|, dependencies first, as
+// GenerateCode() expects them in CodeGeneratorRequest.proto_file.
+bool AddInDependencyOrder(const string& name,
+                          const std::map<string, FileDescriptorProto>& files,
+                          std::set<string>* added,
+                          std::vector<const FileDescriptorProto*>* ordered,
+                          string* error) {
+  if (!added->insert(name).second) {
+    return true;
+  }
+  const FileDescriptorProto& file = files.at(name);
+  for (const string& dependency : file.dependency()) {
+    if (files.find(dependency) == files.end()) {
+      *error = "no descriptor for " + dependency + ", imported by " + name;
+      return false;
+    }
+    if (!AddInDependencyOrder(dependency, files, added, ordered, error)) {
+      return false;
+    }
+  }
+  ordered->push_back(&file);
+  return true;
+}
+
+// Runs the code generation action described by |arguments|. Returns the
+// exit code; messages for the user are appended to |output|.
+int ProcessWorkRequest(const CodeGenerator& generator,
+                       const std::vector<string>& arguments, string* output) {
+  std::vector<string> expanded;
+  if (!ExpandFlagfiles(arguments, &expanded, output)) {
+    return 1;
+  }
+
+  std::vector<string> descriptor_sets;
+  std::vector<string> files_to_generate;
+  std::vector<string> declared_outputs;
+  string parameter;
+  string out_dir;
+  for (const string& argument : expanded) {
+    string::size_type equals = argument.find('=');
+    string flag = argument.substr(0, equals);
+    string value = equals == string::npos ? "" : argument.substr(equals + 1);
+    if ("--descriptor_set_in" == flag) {
+      descriptor_sets.push_back(value);
+    } else if ("--file_to_generate" == flag) {
+      files_to_generate.push_back(value);
+    } else if ("--parameter" == flag) {
+      parameter = value;
+    } else if ("--out_dir" == flag) {
+      out_dir = value;
+    } else if ("--declared_output" == flag) {
+      declared_outputs.push_back(value);
+    } else {
+      *output = "unknown argument: " + argument;
+      return 1;
+    }
+  }
+  if (out_dir.empty()) {
+    *output = "--out_dir is required";
+    return 1;
+  }
+
+  // Later sets may repeat files from earlier ones, e.g. shared dependencies.
+  std::map<string, FileDescriptorProto> files;
+  for (const string& path : descriptor_sets) {
+    string contents;
+    FileDescriptorSet descriptor_set;
+    if (!ReadFile(path, &contents) ||
+        !descriptor_set.ParseFromString(contents)) {
+      *output = "cannot read descriptor set " + path;
+      return 1;
+    }
+    for (FileDescriptorProto& file : *descriptor_set.mutable_file()) {
+      if (files.find(file.name()) == files.end()) {
+        files[file.name()].Swap(&file);
+      }
+    }
+  }
+
+  CodeGeneratorRequest request;
+  request.set_parameter(parameter);
+  request.mutable_compiler_version()->set_major(GOOGLE_PROTOBUF_VERSION /
+                                                1000000);
+  request.mutable_compiler_version()->set_minor(GOOGLE_PROTOBUF_VERSION /
+                                                1000 % 1000);
+  request.mutable_compiler_version()->set_patch(GOOGLE_PROTOBUF_VERSION %
+                                                1000);
+  request.mutable_compiler_version()->set_suffix(
+      GOOGLE_PROTOBUF_VERSION_SUFFIX);
+
+  std::set<string> added;
+  std::vector<const FileDescriptorProto*> ordered;
+  for (const string& name : files_to_generate) {
+    if (files.find(name) == files.end()) {
+      *output = "no descriptor for " + name;
+      return 1;
+    }
+    request.add_file_to_generate(name);
+    if (!AddInDependencyOrder(name, files, &added, &ordered, output)) {
+      return 1;
+    }
+  }
+  for (const FileDescriptorProto* file : ordered) {
+    *request.add_proto_file() = *file;
+  }
+
+  CodeGeneratorResponse response;
+  string error;
+  if (!GenerateCode(request, generator, &response, &error)) {
+    *output = error;
+    return 1;
+  }
+  if (!response.error().empty()) {
+    *output = "--grpc-web_out: " + response.error();
+    return 1;
+  }
+
+  std::set<string> declared(declared_outputs.begin(), declared_outputs.end());
+  std::set<string> written;
+  for (const CodeGeneratorResponse::File& file : response.file()) {
+    if (!file.insertion_point().empty()) {
+      *output = "insertion points are not supported: " + file.name();
+      return 1;
+    }
+    string path = out_dir + "/" + file.name();
+    // Bazel would silently drop an undeclared output.
+    if (!declared.empty() && declared.find(path) == declared.end()) {
+      *output = "generated " + file.name() + ", which is not declared";
+      return 1;
+    }
+    if (!WriteFile(path, file.content())) {
+      *output = "cannot write " + path;
+      return 1;
+    }
+    written.insert(path);
+  }
+
+  // Bazel fails actions that do not create all of their declared outputs,
+  // but which files are generated depends on the contents of each .proto
+  // file, e.g. no client is generated for files without services.
+  for (const string& path : declared_outputs) {
+    if (written.find(path) == written.end() && !WriteFile(path, "")) {
+      *output = "cannot write " + path;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+bool ReadWorkRequest(FileInputStream* input, WorkRequest* request) {
+  CodedInputStream coded_input(input);
+  uint32_t size;
+  if (!coded_input.ReadVarint32(&size)) {
+    return false;
+  }
+  CodedInputStream::Limit limit = coded_input.PushLimit(size);
+  while (uint32_t tag = coded_input.ReadTag()) {
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    WireFormatLite::WireType wire_type = WireFormatLite::GetTagWireType(tag);
+    if (kWorkRequestArgumentsField == field &&
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED == wire_type) {
+      request->arguments.emplace_back();
+      if (!WireFormatLite::ReadString(&coded_input,
+                                      &request->arguments.back())) {
+        return false;
+      }
+    } else if (kWorkRequestRequestIdField == field &&
+               WireFormatLite::WIRETYPE_VARINT == wire_type) {
+      uint32_t request_id;
+      if (!coded_input.ReadVarint32(&request_id)) {
+        return false;
+      }
+      request->request_id = static_cast<int32_t>(request_id);
+    } else if (!WireFormatLite::SkipField(&coded_input, tag)) {
+      return false;
+    }
+  }
+  if (!coded_input.ConsumedEntireMessage()) {
+    return false;
+  }
+  coded_input.PopLimit(limit);
+  return true;
+}
+
+bool WriteWorkResponse(FileOutputStream* output, int exit_code,
+                       const string& message, int32_t request_id) {
+  string response;
+  {
+    StringOutputStream response_output(&response);
+    CodedOutputStream coded_response(&response_output);
+    WireFormatLite::WriteInt32(kWorkResponseExitCodeField, exit_code,
+                               &coded_response);
+    WireFormatLite::WriteString(kWorkResponseOutputField, message,
+                                &coded_response);
+    WireFormatLite::WriteInt32(kWorkResponseRequestIdField, request_id,
+                               &coded_response);
+  }
+  {
+    CodedOutputStream coded_output(output);
+    coded_output.WriteVarint32(static_cast<uint32_t>(response.size()));
+    coded_output.WriteString(response);
+    if (coded_output.HadError()) {
+      return false;
+    }
+  }
+  return output->Flush();
+}
+
+}  // namespace
+
+int RunPersistentWorker(const CodeGenerator& generator, int input_fd,
+                        int output_fd) {
+#ifdef _WIN32
+  _setmode(input_fd, _O_BINARY);
+  _setmode(output_fd, _O_BINARY);
+#endif
+  FileInputStream input(input_fd);
+  FileOutputStream output(output_fd);
+  while (true) {
+    WorkRequest request;
+    if (!ReadWorkRequest(&input, &request)) {
+      // End of input: Bazel is shutting the worker down.
+      return 0;
+    }
+    string message;
+    int exit_code = ProcessWorkRequest(generator, request.arguments, &message);
+    if (!WriteWorkResponse(&output, exit_code, message, request.request_id)) {
+      return 1;
+    }
+  }
+}
+
+int RunWorkRequest(const CodeGenerator& generator,
+                   const std::vector<string>& arguments) {
+  string message;
+  int exit_code = ProcessWorkRequest(generator, arguments, &message);
+  if (!message.empty()) {
+    std::cerr << message << std::endl;
+  }
+  return exit_code;
+}
+
+}  // namespace web
+}  // namespace grpc
@@ -0,0 +1,61 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef JAVASCRIPT_NET_GRPC_WEB_GENERATOR_PERSISTENT_WORKER_H_
+#define JAVASCRIPT_NET_GRPC_WEB_GENERATOR_PERSISTENT_WORKER_H_
+
+#include <google/protobuf/compiler/code_generator.h>
+
+#include <string>
+#include <vector>
+
+namespace grpc {
+namespace web {
+
+// Runs the generator as a Bazel persistent worker. Reads length-delimited
+// blaze.worker.WorkRequest messages from |input_fd| until end of file and
+// answers each one with a WorkResponse on |output_fd|. Returns the process
+// exit code.
+//
+// The arguments of each request describe one code generation action in place
+// of a protoc invocation:
+//
+//   --descriptor_set_in=PATH   A serialized FileDescriptorSet. Repeated; must
+//                              cover the files to generate and all of their
+//                              transitive dependencies.
+//   --file_to_generate=NAME    A .proto file to generate code for. Repeated.
+//   --parameter=PARAMETER      The generator parameter, as passed to
+//                              --grpc-web_out.
+//   --out_dir=DIR              The directory generated files are written to.
+//   --declared_output=PATH     An output the build system expects. Repeated;
+//                              created empty if nothing was generated for it.
+//
+// Arguments of the form @FILE are replaced with the lines of FILE.
+int RunPersistentWorker(
+    const google::protobuf::compiler::CodeGenerator& generator, int input_fd,
+    int output_fd);
+
+// Runs a single work request given on the command line, as Bazel does when
+// the action does not run in a worker. Errors are printed to stderr.
+int RunWorkRequest(const google::protobuf::compiler::CodeGenerator& generator,
+                   const std::vector<std::string>& arguments);
+
+}  // namespace web
+}  // namespace grpc
+
+#endif  // JAVASCRIPT_NET_GRPC_WEB_GENERATOR_PERSISTENT_WORKER_H_
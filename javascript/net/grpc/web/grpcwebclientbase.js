@@ -28,17 +28,26 @@ goog.module('grpc.web.GrpcWebClientBase');
 goog.module.declareLegacyNamespace();
 
 
+const ClientDuplexStream = goog.requireType('grpc.web.ClientDuplexStream');
 const ClientOptions = goog.requireType('grpc.web.ClientOptions');
 const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
 const ClientUnaryCallImpl = goog.require('grpc.web.ClientUnaryCallImpl');
+const DecodeWorker = goog.require('grpc.web.DecodeWorker');
+const GrpcWebClientDuplexStream = goog.require('grpc.web.GrpcWebClientDuplexStream');
 const GrpcWebClientReadableStream = goog.require('grpc.web.GrpcWebClientReadableStream');
+const HedgedCall = goog.require('grpc.web.HedgedCall');
 const HttpCors = goog.require('goog.net.rpc.HttpCors');
+const IdempotencyLevel = goog.require('grpc.web.IdempotencyLevel');
 const MethodDescriptor = goog.requireType('grpc.web.MethodDescriptor');
+const MethodType = goog.require('grpc.web.MethodType');
 const Request = goog.require('grpc.web.Request');
 const RpcError = goog.require('grpc.web.RpcError');
 const StatusCode = goog.require('grpc.web.StatusCode');
+const UnaryCallBatcher = goog.require('grpc.web.UnaryCallBatcher');
+const UnaryResponse = goog.requireType('grpc.web.UnaryResponse');
 const XhrIo = goog.require('goog.net.XhrIo');
 const googCrypt = goog.require('goog.crypt.base64');
+const uriUtils = goog.require('goog.uri.utils');
 const {AbstractClientBase, PromiseCallOptions, getHostname} = goog.require('grpc.web.AbstractClientBase');
 const {Status} = goog.require('grpc.web.Status');
 const {StreamInterceptor, UnaryInterceptor} = goog.require('grpc.web.Interceptor');
@@ -78,6 +87,54 @@ class GrpcWebClientBase {
     this.withCredentials_ = options.withCredentials ||
         goog.getObjectByName('withCredentials', options) || false;
 
+    /**
+     * @const
+     * @private {boolean}
+     */
+    this.useHttpGet_ = options.useHttpGet ||
+        goog.getObjectByName('useHttpGet', options) || false;
+
+    /**
+     * @const
+     * @private {boolean}
+     */
+    this.coalesceCalls_ = options.coalesceCalls ||
+        goog.getObjectByName('coalesceCalls', options) || false;
+
+    /**
+     * @const
+     * @private {boolean}
+     */
+    this.streamingUploads_ = options.streamingUploads ||
+        goog.getObjectByName('streamingUploads', options) || false;
+
+    /**
+     * The unary calls in flight that identical calls can share, by the key
+     * from getCoalescingKey_().
+     * @const {!Map<string, !Promise<?>>}
+     * @private
+     */
+    this.inflightCalls_ = new Map();
+
+    /** @private {number} */
+    this.coalescableCallCount_ = 0;
+
+    /** @private {number} */
+    this.coalescedCallCount_ = 0;
+
+    /**
+     * @const
+     * @private {number}
+     */
+    this.hedgingDelayMs_ = options.hedgingDelayMs ||
+        goog.getObjectByName('hedgingDelayMs', options) || 0;
+
+    /** @private {number} */
+    this.hedgeCount_ = 0;
+
+    /** @private {number} */
+    this.hedgeWinCount_ = 0;
+
     /**
      * @const {!Array<!StreamInterceptor>}
      * @private
@@ -92,8 +149,43 @@ class GrpcWebClientBase {
     this.unaryInterceptors_ = options.unaryInterceptors ||
         goog.getObjectByName('unaryInterceptors', options) || [];
 
+    const responsePoolSize = options.responsePoolSize !== undefined ?
+        options.responsePoolSize :
+        goog.getObjectByName('responsePoolSize', options);
+
+    /**
+     * @const
+     * @private {number}
+     */
+    this.responsePoolSize_ = responsePoolSize != null ? responsePoolSize : 2;
+
     /** @const @private {?XhrIo} */
     this.xhrIo_ = xhrIo || null;
+
+    const batchUrl =
+        options.batchUrl || goog.getObjectByName('batchUrl', options) || '';
+
+    /**
+     * Sends the unary calls in batches, with the batchUrl option.
+     * @const @private {?UnaryCallBatcher}
+     */
+    this.batcher_ = batchUrl ?
+        new UnaryCallBatcher(
+            batchUrl, this.format_, this.withCredentials_,
+            this.suppressCorsPreflight_,
+            options.batchWindowMs ||
+                goog.getObjectByName('batchWindowMs', options) || 0,
+            () => this.xhrIo_ || new XhrIo()) :
+        null;
+
+    const decodeWorker = options.decodeWorker ||
+        goog.getObjectByName('decodeWorker', options) || null;
+
+    /**
+     * Decodes the responses in a worker, with the decodeWorker option.
+     * @const @private {?DecodeWorker}
+     */
+    this.decodeWorker_ = decodeWorker ? DecodeWorker.get(decodeWorker) : null;
   }
 
   /**
@@ -101,9 +193,8 @@ class GrpcWebClientBase {
    * @export
    */
   rpcCall(method, requestMessage, metadata, methodDescriptor, callback) {
-    const hostname = getHostname(method, methodDescriptor);
     const invoker = GrpcWebClientBase.runInterceptors_(
-        (request) => this.startStream_(request, hostname),
+        (request) => this.startStream_(request, method, methodDescriptor),
         this.streamInterceptors_);
     const stream = /** @type {!ClientReadableStream<?>} */ (invoker.call(
         this, methodDescriptor.createRequest(requestMessage, metadata)));
@@ -122,19 +213,206 @@ class GrpcWebClientBase {
    */
   thenableCall(
       method, requestMessage, metadata, methodDescriptor, options = {}) {
-    const hostname = getHostname(method, methodDescriptor);
     const signal = options && options.signal;
-    const initialInvoker = (request) => new Promise((resolve, reject) => {
+    const initialInvoker = (request) => {
+      // Calls aborted before they start are rejected by startUnaryCall_().
+      const key = this.coalesceCalls_ && !(signal && signal.aborted) ?
+          GrpcWebClientBase.getCoalescingKey_(request, method) :
+          null;
+      if (key === null) {
+        return this.startUnaryCall_(request, method, methodDescriptor, signal);
+      }
+      this.coalescableCallCount_++;
+      let call = this.inflightCalls_.get(key);
+      if (call) {
+        this.coalescedCallCount_++;
+      } else {
+        // The shared call is never cancelled, as other callers may wait for
+        // it. An aborted caller only stops waiting.
+        call = this.startUnaryCall_(request, method, methodDescriptor, null);
+        this.inflightCalls_.set(key, call);
+        const remove = () => this.inflightCalls_.delete(key);
+        call.then(remove, remove);
+      }
+      return signal ? GrpcWebClientBase.abortable_(call, signal) : call;
+    };
+    const invoker = GrpcWebClientBase.runInterceptors_(
+        initialInvoker, this.unaryInterceptors_);
+    const unaryResponse = /** @type {!Promise<?>} */ (invoker.call(
+        this, methodDescriptor.createRequest(requestMessage, metadata)));
+    return unaryResponse.then((response) => response.getResponseMessage());
+  }
+
+  /**
+   * @export
+   * @param {string} method The method to invoke
+   * @param {REQUEST} requestMessage The request proto
+   * @param {!Object<string, string>} metadata User defined call metadata
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>} methodDescriptor Information
+   *     of this RPC method
+   * @param {?PromiseCallOptions=} options Options for the call
+   * @return {!Promise<RESPONSE>}
+   * @template REQUEST, RESPONSE
+   */
+  unaryCall(method, requestMessage, metadata, methodDescriptor, options = {}) {
+    return /** @type {!Promise<RESPONSE>}*/ (this.thenableCall(
+        method, requestMessage, metadata, methodDescriptor, options));
+  }
+
+  /**
+   * Returns how many unary calls could share the call of an identical
+   * request, with the coalesceCalls option.
+   * @export
+   * @return {number}
+   */
+  getCoalescableCallCount() {
+    return this.coalescableCallCount_;
+  }
+
+  /**
+   * Returns how many unary calls shared the call of an identical request
+   * in flight, with the coalesceCalls option, instead of being sent.
+   * @export
+   * @return {number}
+   */
+  getCoalescedCallCount() {
+    return this.coalescedCallCount_;
+  }
+
+  /**
+   * Returns how many unary calls sent a second request, with the
+   * hedgingDelayMs option.
+   * @export
+   * @return {number}
+   */
+  getHedgeCount() {
+    return this.hedgeCount_;
+  }
+
+  /**
+   * Returns how many unary calls took the response of their second request,
+   * with the hedgingDelayMs option.
+   * @export
+   * @return {number}
+   */
+  getHedgeWinCount() {
+    return this.hedgeWinCount_;
+  }
+
+  /**
+   * Returns how many batches of unary calls were sent, with the batchUrl
+   * option.
+   * @export
+   * @return {number}
+   */
+  getBatchCount() {
+    return this.batcher_ ? this.batcher_.getBatchCount() : 0;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  serverStreaming(method, requestMessage, metadata, methodDescriptor) {
+    const invoker = GrpcWebClientBase.runInterceptors_(
+        (request) => this.startStream_(request, method, methodDescriptor),
+        this.streamInterceptors_);
+    return /** @type {!ClientReadableStream<?>} */ (invoker.call(
+        this, methodDescriptor.createRequest(requestMessage, metadata)));
+  }
+
+  /**
+   * Starts a client streaming call. The requests are written to the returned
+   * stream, and the call ends with the single response. Interceptors are
+   * not run.
+   *
+   * @override
+   * @export
+   * @param {string} method The method to invoke
+   * @param {!Object<string, string>} metadata User defined call metadata
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>} methodDescriptor Information
+   *     of this RPC method
+   * @param {function(?RpcError, ?RESPONSE)=} callback Called with the
+   *     response or the error
+   * @return {!ClientDuplexStream<REQUEST, RESPONSE>}
+   * @template REQUEST, RESPONSE
+   */
+  clientStreaming(method, metadata, methodDescriptor, callback) {
+    const stream = this.startDuplexStream_(method, metadata, methodDescriptor);
+    if (callback) {
+      GrpcWebClientBase.setCallback_(stream, callback, false);
+    }
+    return stream;
+  }
+
+  /**
+   * Starts a bidi streaming call. The requests are written to the returned
+   * stream, which the responses are read from once it is ended. Interceptors
+   * are not run.
+   *
+   * @override
+   * @export
+   * @param {string} method The method to invoke
+   * @param {!Object<string, string>} metadata User defined call metadata
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>} methodDescriptor Information
+   *     of this RPC method
+   * @return {!ClientDuplexStream<REQUEST, RESPONSE>}
+   * @template REQUEST, RESPONSE
+   */
+  bidiStreaming(method, metadata, methodDescriptor) {
+    return this.startDuplexStream_(method, metadata, methodDescriptor);
+  }
+
+  /**
+   * @private
+   * @template REQUEST, RESPONSE
+   * @param {string} method The URL of the method
+   * @param {!Object<string, string>} metadata User defined call metadata
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>} methodDescriptor
+   * @return {!ClientDuplexStream<REQUEST, RESPONSE>}
+   */
+  startDuplexStream_(method, metadata, methodDescriptor) {
+    const stream = new GrpcWebClientDuplexStream(
+        this.format_, methodDescriptor.getRequestSerializeFn(),
+        methodDescriptor.getResponseDeserializeFn());
+    const headers = new Map();
+    for (const key in metadata) {
+      headers.set(key, metadata[key]);
+    }
+    const timeout = this.setRequestHeaders_(headers);
+    let path = method;
+    if (this.suppressCorsPreflight_) {
+      path = GrpcWebClientBase.setCorsOverride_(path, toObject(headers));
+      headers.clear();
+    }
+    stream.start(
+        path, toObject(headers), this.withCredentials_,
+        this.streamingUploads_ &&
+            GrpcWebClientDuplexStream.supportsStreamingUpload(),
+        timeout > 0 ? GrpcWebClientBase.getTransportTimeout_(timeout) : 0);
+    return stream;
+  }
+
+  /**
+   * @private
+   * @template REQUEST, RESPONSE
+   * @param {!Request<REQUEST, RESPONSE>} request
+   * @param {string} method The URL of the method the call was made for
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>} callMethodDescriptor The
+   *     descriptor of the method the call was made for
+   * @param {?AbortSignal|undefined} signal Aborts the call
+   * @return {!Promise<!UnaryResponse<REQUEST, RESPONSE>>}
+   */
+  startUnaryCall_(request, method, callMethodDescriptor, signal) {
+    return new Promise((resolve, reject) => {
       // If the signal is already aborted, immediately reject the promise
       // and don't issue the call.
       if (signal && signal.aborted) {
-        const error = new RpcError(StatusCode.CANCELLED, 'Aborted');
-        error.cause = signal.reason;
-        reject(error);
+        reject(GrpcWebClientBase.abortError_(signal));
         return;
       }
 
-      const stream = this.startStream_(request, hostname);
+      const stream = this.startStream_(request, method, callMethodDescriptor);
       let unaryMetadata;
       let unaryStatus;
       let unaryMsg;
@@ -160,60 +438,65 @@ class GrpcWebClientBase {
       if (signal) {
         signal.addEventListener('abort', () => {
           stream.cancel();
-
-          const error = new RpcError(StatusCode.CANCELLED, 'Aborted');
-          error.cause = /** @type {!AbortSignal} */ (signal).reason;
-          reject(error);
+          reject(GrpcWebClientBase.abortError_(
+              /** @type {!AbortSignal} */ (signal)));
         });
       }
     });
-    const invoker = GrpcWebClientBase.runInterceptors_(
-        initialInvoker, this.unaryInterceptors_);
-    const unaryResponse = /** @type {!Promise<?>} */ (invoker.call(
-        this, methodDescriptor.createRequest(requestMessage, metadata)));
-    return unaryResponse.then((response) => response.getResponseMessage());
   }
 
   /**
-   * @export
-   * @param {string} method The method to invoke
-   * @param {REQUEST} requestMessage The request proto
-   * @param {!Object<string, string>} metadata User defined call metadata
-   * @param {!MethodDescriptor<REQUEST, RESPONSE>} methodDescriptor Information
-   *     of this RPC method
-   * @param {?PromiseCallOptions=} options Options for the call
-   * @return {!Promise<RESPONSE>}
+   * @private
    * @template REQUEST, RESPONSE
+   * @param {!Request<REQUEST, RESPONSE>} request
+   * @param {string} method The URL of the method the call was made for
+   * @param {!MethodDescriptor<REQUEST, RESPONSE>} callMethodDescriptor The
+   *     descriptor of the method the call was made for
+   * @return {!ClientReadableStream<RESPONSE>}
    */
-  unaryCall(method, requestMessage, metadata, methodDescriptor, options = {}) {
-    return /** @type {!Promise<RESPONSE>}*/ (this.thenableCall(
-        method, requestMessage, metadata, methodDescriptor, options));
-  }
-
-  /**
-   * @override
-   * @export
-   */
-  serverStreaming(method, requestMessage, metadata, methodDescriptor) {
-    const hostname = getHostname(method, methodDescriptor);
-    const invoker = GrpcWebClientBase.runInterceptors_(
-        (request) => this.startStream_(request, hostname),
-        this.streamInterceptors_);
-    return /** @type {!ClientReadableStream<?>} */ (invoker.call(
-        this, methodDescriptor.createRequest(requestMessage, metadata)));
+  startStream_(request, method, callMethodDescriptor) {
+    const methodDescriptor = request.getMethodDescriptor();
+    // Generated clients pass the full URL of the method, so it is only
+    // rebuilt when an interceptor sent the request to another method.
+    const path = methodDescriptor === callMethodDescriptor ?
+        method :
+        getHostname(method, callMethodDescriptor) + methodDescriptor.getName();
+    const idempotencyLevel = methodDescriptor.getIdempotencyLevel();
+    const isUnary =
+        methodDescriptor.getMethodType() != MethodType.SERVER_STREAMING;
+    const useHttpGet = this.useHttpGet_ &&
+        idempotencyLevel == IdempotencyLevel.NO_SIDE_EFFECTS && isUnary;
+    if (this.batcher_ && !useHttpGet && isUnary) {
+      return this.startBatchedCall_(request);
+    }
+    if (this.hedgingDelayMs_ > 0 && isUnary &&
+        (idempotencyLevel == IdempotencyLevel.NO_SIDE_EFFECTS ||
+         idempotencyLevel == IdempotencyLevel.IDEMPOTENT)) {
+      return new HedgedCall(
+          () => this.sendRequest_(request, path, useHttpGet),
+          this.hedgingDelayMs_, (won) => {
+            if (won) {
+              this.hedgeWinCount_++;
+            } else {
+              this.hedgeCount_++;
+            }
+          });
+    }
+    return this.sendRequest_(request, path, useHttpGet);
   }
 
   /**
+   * Sends the HTTP request of a call.
+   *
    * @private
    * @template REQUEST, RESPONSE
    * @param {!Request<REQUEST, RESPONSE>} request
-   * @param {string} hostname
+   * @param {string} url The URL of the method
+   * @param {boolean} useHttpGet Whether to send a GET request
    * @return {!ClientReadableStream<RESPONSE>}
    */
-  startStream_(request, hostname) {
+  sendRequest_(request, url, useHttpGet) {
     const methodDescriptor = request.getMethodDescriptor();
-    let path = hostname + methodDescriptor.getName();
-
     const xhr = this.xhrIo_ ? this.xhrIo_ : new XhrIo();
     xhr.setWithCredentials(this.withCredentials_);
 
@@ -223,30 +506,76 @@ class GrpcWebClientBase {
     const stream = new GrpcWebClientReadableStream(genericTransportInterface);
     stream.setResponseDeserializeFn(
         methodDescriptor.getResponseDeserializeFn());
+    if (this.decodeWorker_) {
+      stream.setDecodeWorker(this.decodeWorker_, methodDescriptor.getName());
+    }
+    const responseDeserializeIntoFn =
+        methodDescriptor.getResponseDeserializeIntoFn();
+    if (responseDeserializeIntoFn && this.responsePoolSize_ > 0 &&
+        !this.decodeWorker_) {
+      stream.setResponseDeserializeIntoFn(
+          responseDeserializeIntoFn, this.responsePoolSize_);
+    }
 
     const metadata = request.getMetadata();
     for(const key in metadata) {
       xhr.headers.set(key, metadata[key]);
     }
     this.processHeaders_(xhr);
+    if (useHttpGet) {
+      // GET requests have no body.
+      xhr.headers.delete('Content-Type');
+    }
     if (this.suppressCorsPreflight_) {
       const headerObject = toObject(xhr.headers);
       xhr.headers.clear();
-      path = GrpcWebClientBase.setCorsOverride_(path, headerObject);
+      url = GrpcWebClientBase.setCorsOverride_(url, headerObject);
     }
 
     const requestSerializeFn = methodDescriptor.getRequestSerializeFn();
     const serialized = requestSerializeFn(request.getRequestMessage());
+    if (this.format_ == 'binary') {
+      xhr.setResponseType(XhrIo.ResponseType.ARRAY_BUFFER);
+    }
+    if (useHttpGet) {
+      // The URL holds the request, so that browsers and HTTP caches may
+      // cache the response.
+      xhr.send(GrpcWebClientBase.setRequestParam_(url, serialized), 'GET');
+      return stream;
+    }
     let payload = this.encodeRequest_(serialized);
     if (this.format_ == 'text') {
       payload = googCrypt.encodeByteArray(payload);
-    } else if (this.format_ == 'binary') {
-      xhr.setResponseType(XhrIo.ResponseType.ARRAY_BUFFER);
     }
-    xhr.send(path, 'POST', payload);
+    xhr.send(url, 'POST', payload);
     return stream;
   }
 
+  /**
+   * Queues a unary call in the next batch. Its metadata is sent in the batch,
+   * with its grpc-timeout.
+   *
+   * @private
+   * @template REQUEST, RESPONSE
+   * @param {!Request<REQUEST, RESPONSE>} request
+   * @return {!ClientReadableStream<RESPONSE>}
+   */
+  startBatchedCall_(request) {
+    const methodDescriptor = request.getMethodDescriptor();
+    const headers = new Map();
+    const metadata = request.getMetadata();
+    for (const key in metadata) {
+      headers.set(key, metadata[key]);
+    }
+    const timeout = GrpcWebClientBase.setTimeoutHeader_(headers);
+    const serialized = methodDescriptor.getRequestSerializeFn()(
+        request.getRequestMessage());
+    return this.batcher_.add(
+        methodDescriptor.getName(), toObject(headers), serialized,
+        timeout > 0 ? GrpcWebClientBase.getTransportTimeout_(timeout) : 0,
+        methodDescriptor.getResponseDeserializeFn());
+  }
+
   /**
    * @private
    * @static
@@ -347,33 +676,139 @@ class GrpcWebClientBase {
    * @param {!XhrIo} xhr The xhr object
    */
   processHeaders_(xhr) {
+    const timeout = this.setRequestHeaders_(xhr.headers);
+    if (timeout > 0) {
+      xhr.setTimeoutInterval(GrpcWebClientBase.getTransportTimeout_(timeout));
+    }
+  }
+
+  /**
+   * Adds the grpc-web headers to |headers|, which holds the call metadata,
+   * and turns its deadline into a grpc-timeout.
+   *
+   * @private
+   * @param {!Map<string, string>} headers The request headers
+   * @return {number} The grpc-timeout in ms, or 0 if there is none
+   */
+  setRequestHeaders_(headers) {
     if (this.format_ == 'text') {
-      xhr.headers.set('Content-Type', 'application/grpc-web-text');
-      xhr.headers.set('Accept', 'application/grpc-web-text');
+      headers.set('Content-Type', 'application/grpc-web-text');
+      headers.set('Accept', 'application/grpc-web-text');
     } else {
-      xhr.headers.set('Content-Type', 'application/grpc-web+proto');
+      headers.set('Content-Type', 'application/grpc-web+proto');
     }
-    xhr.headers.set('X-User-Agent', 'grpc-web-javascript/0.1');
-    xhr.headers.set('X-Grpc-Web', '1');
-    if (xhr.headers.has('deadline')) {
-      const deadline = Number(xhr.headers.get('deadline'));  // in ms
-      const currentTime = (new Date()).getTime();
-      let timeout = Math.ceil(deadline - currentTime);
-      xhr.headers.delete('deadline');
-      if (timeout === Infinity) {
-        // grpc-timeout header defaults to infinity if not set.
-        timeout = 0;
-      }
-      if (timeout > 0) {
-        xhr.headers.set('grpc-timeout', timeout + 'm');
-        // Also set timeout on the xhr request to terminate the HTTP request
-        // if the server doesn't respond within the deadline. We use 110% of
-        // grpc-timeout for this to allow the server to terminate the connection
-        // with DEADLINE_EXCEEDED rather than terminating it in the Browser, but
-        // at least 1 second in case the user is on a high-latency network.
-        xhr.setTimeoutInterval(Math.max(1000, Math.ceil(timeout * 1.1)));
-      }
+    headers.set('X-User-Agent', 'grpc-web-javascript/0.1');
+    headers.set('X-Grpc-Web', '1');
+    return GrpcWebClientBase.setTimeoutHeader_(headers);
+  }
+
+  /**
+   * Turns the deadline in |headers|, if any, into a grpc-timeout.
+   *
+   * @private
+   * @static
+   * @param {!Map<string, string>} headers The call metadata
+   * @return {number} The grpc-timeout in ms, or 0 if there is none
+   */
+  static setTimeoutHeader_(headers) {
+    if (!headers.has('deadline')) {
+      return 0;
+    }
+    const deadline = Number(headers.get('deadline'));  // in ms
+    const currentTime = (new Date()).getTime();
+    let timeout = Math.ceil(deadline - currentTime);
+    headers.delete('deadline');
+    if (timeout === Infinity) {
+      // grpc-timeout header defaults to infinity if not set.
+      timeout = 0;
+    }
+    if (timeout > 0) {
+      headers.set('grpc-timeout', timeout + 'm');
+      return timeout;
+    }
+    return 0;
+  }
+
+  /**
+   * Returns when to terminate the HTTP request of a call with |timeout| if
+   * the server doesn't respond within the deadline. We use 110% of
+   * grpc-timeout for this to allow the server to terminate the connection
+   * with DEADLINE_EXCEEDED rather than terminating it in the Browser, but at
+   * least 1 second in case the user is on a high-latency network.
+   *
+   * @private
+   * @static
+   * @param {number} timeout The grpc-timeout in ms
+   * @return {number} The timeout of the HTTP request in ms
+   */
+  static getTransportTimeout_(timeout) {
+    return Math.max(1000, Math.ceil(timeout * 1.1));
+  }
+
+  /**
+   * Returns the key identifying the calls that can share the call of
+   * |request|: calls to the same side-effect-free method, with the same
+   * serialized request and metadata. Returns null if the call cannot be
+   * shared.
+   *
+   * @private
+   * @static
+   * @param {!Request<?, ?>} request
+   * @param {string} method The URL of the method the call was made for
+   * @return {?string}
+   */
+  static getCoalescingKey_(request, method) {
+    const methodDescriptor = request.getMethodDescriptor();
+    if (methodDescriptor.getIdempotencyLevel() !=
+        IdempotencyLevel.NO_SIDE_EFFECTS) {
+      return null;
     }
+    const serialized = methodDescriptor.getRequestSerializeFn()(
+        request.getRequestMessage());
+    const metadata = request.getMetadata();
+    const headers = Object.keys(metadata).sort().map(
+        (key) => key + ':' + metadata[key]);
+    return [
+      method,
+      methodDescriptor.getName(),
+      typeof serialized == 'string' ? serialized :
+                                      googCrypt.encodeByteArray(serialized),
+      ...headers,
+    ].join('\n');
+  }
+
+  /**
+   * Returns a promise that settles like |promise|, or rejects when |signal|
+   * aborts.
+   *
+   * @private
+   * @static
+   * @template T
+   * @param {!Promise<T>} promise
+   * @param {!AbortSignal} signal
+   * @return {!Promise<T>}
+   */
+  static abortable_(promise, signal) {
+    if (signal.aborted) {
+      return Promise.reject(GrpcWebClientBase.abortError_(signal));
+    }
+    return new Promise((resolve, reject) => {
+      signal.addEventListener(
+          'abort', () => reject(GrpcWebClientBase.abortError_(signal)));
+      promise.then(resolve, reject);
+    });
+  }
+
+  /**
+   * @private
+   * @static
+   * @param {!AbortSignal} signal
+   * @return {!RpcError} The error of calls aborted by |signal|
+   */
+  static abortError_(signal) {
+    const error = new RpcError(StatusCode.CANCELLED, 'Aborted');
+    error.cause = signal.reason;
+    return error;
   }
 
   /**
@@ -388,6 +823,23 @@ class GrpcWebClientBase {
         method, HttpCors.HTTP_HEADERS_PARAM_NAME, headerObject));
   }
 
+  /**
+   * Adds the serialized request to the URL of a GET request, as the unpadded
+   * web-safe base64 query param $req=.
+   *
+   * @private
+   * @static
+   * @param {string} path The URL of the method
+   * @param {!Uint8Array|!Array<number>} serialized The serialized request
+   * @return {string} The URL holding the request
+   */
+  static setRequestParam_(path, serialized) {
+    return uriUtils.appendParam(
+        path, GrpcWebClientBase.REQUEST_PARAM_NAME,
+        googCrypt.encodeByteArray(
+            serialized, googCrypt.Alphabet.WEBSAFE_NO_PADDING));
+  }
+
   /**
    * @private
    * @static
@@ -407,5 +859,12 @@ class GrpcWebClientBase {
 }
 
 
+/**
+ * The query param holding the request of GET requests.
+ * @const {string}
+ */
+GrpcWebClientBase.REQUEST_PARAM_NAME = '$req';
+
+
 
 exports = GrpcWebClientBase;
@@ -19,8 +19,10 @@ goog.module('grpc.web.GrpcWebClientBaseTest');
 goog.setTestOnly('grpc.web.GrpcWebClientBaseTest');
 
 const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
+const DecodeWorker = goog.require('grpc.web.DecodeWorker');
 const ErrorCode = goog.require('goog.net.ErrorCode');
 const GrpcWebClientBase = goog.require('grpc.web.GrpcWebClientBase');
+const IdempotencyLevel = goog.require('grpc.web.IdempotencyLevel');
 const MethodDescriptor = goog.require('grpc.web.MethodDescriptor');
 const ReadyState = goog.require('goog.net.XmlHttp.ReadyState');
 const Request = goog.requireType('grpc.web.Request');
@@ -322,8 +324,436 @@ testSuite({
     assertEquals('Intercepted value', response.data);
   },
 
+  testRpcCallSendsToMethodUrl() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase(/* options= */ {}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply());
+
+    client.rpcCall(
+        'http://host/Service/Method', new MockRequest(), /* metadata= */ {},
+        methodDescriptor, (error, response) => {});
+    assertEquals('http://host/Service/Method', xhr.getLastUri());
+  },
+
+  testServerStreamingReusesResponses() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase(/* options= */ {}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply(String(bytes[0])),
+        (bytes, reply) => {
+          reply.data = String(bytes[0]);
+          return reply;
+        });
+
+    const responses = [];
+    const data = [];
+    client
+        .serverStreaming(
+            'url', new MockRequest(), /* metadata= */ {}, methodDescriptor)
+        .on('data', (response) => {
+          responses.push(response);
+          data.push(response.data);
+        });
+    // Three DATA frames holding 1, 2 and 3.
+    xhr.simulatePartialResponse(
+        googCrypt.encodeByteArray(new Uint8Array(
+            [0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 2, 0, 0, 0, 0, 1, 3])),
+        DEFAULT_RESPONSE_HEADERS);
+
+    assertElementsEquals(['1', '2', '3'], data);
+    assertNotEquals(responses[0], responses[1]);
+    assertEquals(responses[0], responses[2]);
+  },
+
+  testServerStreamingWithoutResponsePool() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'responsePoolSize': 0}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply(String(bytes[0])),
+        (bytes, reply) => fail('should not reuse responses'));
+
+    const responses = [];
+    client
+        .serverStreaming(
+            'url', new MockRequest(), /* metadata= */ {}, methodDescriptor)
+        .on('data', (response) => {
+          responses.push(response);
+        });
+    xhr.simulatePartialResponse(
+        googCrypt.encodeByteArray(new Uint8Array(
+            [0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 2, 0, 0, 0, 0, 1, 3])),
+        DEFAULT_RESPONSE_HEADERS);
+
+    assertEquals(3, responses.length);
+    assertNotEquals(responses[0], responses[2]);
+  },
+
+  async testRpcCallWithHttpGet() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'useHttpGet': true}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [251, 255, 3], (bytes) => new MockReply('value'),
+        /* responseDeserializeIntoFn= */ null,
+        IdempotencyLevel.NO_SIDE_EFFECTS);
+
+    const response = await new Promise((resolve, reject) => {
+      client.rpcCall(
+          'http://host/Service/Method', new MockRequest(), /* metadata= */ {},
+          methodDescriptor, (error, response) => {
+            assertNull(error);
+            resolve(response);
+          });
+      xhr.simulatePartialResponse(
+          googCrypt.encodeByteArray(new Uint8Array(DEFAULT_RPC_RESPONSE)),
+          DEFAULT_RESPONSE_HEADERS);
+      xhr.simulateReadyStateChange(ReadyState.COMPLETE);
+    });
+
+    assertEquals('value', response.data);
+    assertEquals('GET', xhr.getLastMethod());
+    assertEquals('http://host/Service/Method?$req=-_8D', xhr.getLastUri());
+    assertUndefined(xhr.getLastContent());
+    const headers = /** @type {!Object} */ (xhr.getLastRequestHeaders());
+    assertFalse('Content-Type' in headers);
+  },
+
+  async testThenableCallCoalescesIdenticalCalls() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'coalesceCalls': true}, xhr);
+    let sendCount = 0;
+    const send = xhr.send;
+    xhr.send = function(...args) {
+      sendCount++;
+      return send.apply(this, args);
+    };
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply('value'),
+        /* responseDeserializeIntoFn= */ null,
+        IdempotencyLevel.NO_SIDE_EFFECTS);
+
+    const calls = [
+      client.thenableCall(
+          'url', new MockRequest(), {'key': 'value'}, methodDescriptor),
+      client.thenableCall(
+          'url', new MockRequest(), {'key': 'value'}, methodDescriptor),
+    ];
+    xhr.simulatePartialResponse(
+        googCrypt.encodeByteArray(new Uint8Array(DEFAULT_RPC_RESPONSE)),
+        DEFAULT_RESPONSE_HEADERS);
+    xhr.simulateReadyStateChange(ReadyState.COMPLETE);
+    const responses = await Promise.all(calls);
+
+    assertEquals(1, sendCount);
+    assertEquals('value', responses[0].data);
+    assertEquals(responses[0], responses[1]);
+    assertEquals(2, client.getCoalescableCallCount());
+    assertEquals(1, client.getCoalescedCallCount());
+
+    // The call is no longer in flight, so the next one is sent.
+    client.thenableCall(
+        'url', new MockRequest(), {'key': 'value'}, methodDescriptor);
+    assertEquals(2, sendCount);
+    assertEquals(1, client.getCoalescedCallCount());
+  },
+
+  async testThenableCallCoalescingWithAbortedCaller() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'coalesceCalls': true}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply('value'),
+        /* responseDeserializeIntoFn= */ null,
+        IdempotencyLevel.NO_SIDE_EFFECTS);
+    const controller = new AbortController();
+
+    const abortedCall = client.thenableCall(
+        'url', new MockRequest(), /* metadata= */ {}, methodDescriptor,
+        {signal: controller.signal});
+    const call = client.thenableCall(
+        'url', new MockRequest(), /* metadata= */ {}, methodDescriptor);
+    controller.abort();
+    const error = await assertRejects(abortedCall);
+    assertEquals(StatusCode.CANCELLED, error.code);
+
+    xhr.simulatePartialResponse(
+        googCrypt.encodeByteArray(new Uint8Array(DEFAULT_RPC_RESPONSE)),
+        DEFAULT_RESPONSE_HEADERS);
+    xhr.simulateReadyStateChange(ReadyState.COMPLETE);
+    assertEquals('value', (await call).data);
+  },
+
+  testThenableCallDoesNotCoalesceOtherMethods() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'coalesceCalls': true}, xhr);
+    const methodDescriptor = createMethodDescriptor(
+        (bytes) => new MockReply('value'));
+
+    client.thenableCall(
+        'url', new MockRequest(), /* metadata= */ {}, methodDescriptor);
+    assertEquals(0, client.getCoalescableCallCount());
+  },
+
+  testRpcCallWithHttpGetSendsOtherMethodsAsPost() {
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'useHttpGet': true}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply(),
+        /* responseDeserializeIntoFn= */ null, IdempotencyLevel.IDEMPOTENT);
+
+    client.rpcCall(
+        'http://host/Service/Method', new MockRequest(), /* metadata= */ {},
+        methodDescriptor, (error, response) => {});
+    assertEquals('POST', xhr.getLastMethod());
+    assertEquals('http://host/Service/Method', xhr.getLastUri());
+  },
+
+  async testUnaryCallsAreBatched() {
+    const xhr = new XhrIo();
+    const client =
+        new GrpcWebClientBase({'batchUrl': 'http://host/batch'}, xhr);
+    const createDescriptor = (name) => new MethodDescriptor(
+        name, /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3], (bytes) => new MockReply('value'));
+
+    const calls = [
+      client.thenableCall(
+          'url', new MockRequest(), {'key': 'value'},
+          createDescriptor('/Service/A')),
+      client.thenableCall(
+          'url', new MockRequest(), /* metadata= */ {},
+          createDescriptor('/Service/B')),
+    ];
+    // The calls are sent once the window of the batch ends.
+    await new Promise((resolve) => setTimeout(resolve, 0));
+
+    assertEquals(1, client.getBatchCount());
+    assertEquals('POST', xhr.getLastMethod());
+    assertEquals('http://host/batch', xhr.getLastUri());
+    const headers = /** @type {!Object} */ (xhr.getLastRequestHeaders());
+    assertEquals(
+        'application/grpc-web-batch-text', headers['Content-Type']);
+    assertElementsEquals(
+        [
+          ...createFrame(128, ':path: /Service/A\r\nkey: value\r\n'),
+          ...createFrame(0, [1, 2, 3]),
+          ...createFrame(128, ':path: /Service/B\r\n'),
+          ...createFrame(0, [1, 2, 3]),
+        ],
+        googCrypt.decodeStringToUint8Array(
+            /** @type {string} */ (xhr.getLastContent())));
+
+    xhr.simulatePartialResponse(
+        googCrypt.encodeByteArray(new Uint8Array([
+          ...createFrame(0, [4, 5, 6]),
+          ...createFrame(128, 'grpc-status:0\r\n'),
+          ...createFrame(128, 'grpc-status:5\r\ngrpc-message:gone\r\n'),
+        ])),
+        {'Content-Type': 'application/grpc-web-batch-text'});
+    xhr.simulateReadyStateChange(ReadyState.COMPLETE);
+    assertEquals('value', (await calls[0]).data);
+    const error = await assertRejects(calls[1]);
+    assertEquals(StatusCode.NOT_FOUND, error.code);
+    assertEquals('gone', error.message);
+  },
+
+  async testBatchedCallCancelledBeforeSend() {
+    const xhr = new XhrIo();
+    const client =
+        new GrpcWebClientBase({'batchUrl': 'http://host/batch'}, xhr);
+    let sendCount = 0;
+    const send = xhr.send;
+    xhr.send = function(...args) {
+      sendCount++;
+      return send.apply(this, args);
+    };
+
+    const call = client.rpcCall(
+        'url', new MockRequest(), /* metadata= */ {},
+        createMethodDescriptor((bytes) => new MockReply('value')),
+        (error, response) => fail('Cancelled calls do not call back'));
+    call.cancel();
+    await new Promise((resolve) => setTimeout(resolve, 0));
+
+    assertEquals(0, sendCount);
+    assertEquals(0, client.getBatchCount());
+  },
+
+  async testClientStreamingSendsRequestsOnEnd() {
+    const fetches = mockFetch(new Response(
+        googCrypt.encodeByteArray(DEFAULT_RPC_RESPONSE),
+        {'headers': DEFAULT_RESPONSE_HEADERS}));
+    try {
+      const client = new GrpcWebClientBase();
+      const methodDescriptor = createMethodDescriptor((bytes) => {
+        assertElementsEquals(DEFAULT_RPC_RESPONSE_DATA, [].slice.call(bytes));
+        return new MockReply('value');
+      });
+
+      const response = await new Promise((resolve, reject) => {
+        const stream = client.clientStreaming(
+            'url', /* metadata= */ {}, methodDescriptor,
+            (error, response) => {
+              assertNull(error);
+              resolve(response);
+            });
+        stream.write(new MockRequest());
+        stream.write(new MockRequest());
+        assertEquals(0, fetches.calls.length);
+        stream.end();
+      });
+
+      assertEquals('value', response.data);
+      assertEquals(1, fetches.calls.length);
+      assertEquals('url', fetches.calls[0].url);
+      assertEquals('POST', fetches.calls[0].init['method']);
+      assertEquals(
+          'application/grpc-web-text',
+          fetches.calls[0].init['headers']['Content-Type']);
+      // Both requests, as frames holding [1, 2, 3].
+      assertEquals(
+          googCrypt.encodeByteArray(
+              [0, 0, 0, 0, 3, 1, 2, 3, 0, 0, 0, 0, 3, 1, 2, 3]),
+          new TextDecoder().decode(fetches.calls[0].init['body']));
+    } finally {
+      fetches.restore();
+    }
+  },
+
+  async testBidiStreamingError() {
+    const fetches = mockFetch(new Response('', {
+      'headers': {
+        'Content-Type': 'application/grpc-web+proto',
+        'grpc-status': '5',
+        'grpc-message': 'not found',
+      },
+    }));
+    try {
+      const client = new GrpcWebClientBase({'format': 'binary'});
+      const methodDescriptor =
+          createMethodDescriptor((bytes) => new MockReply('value'));
+
+      const error = await new Promise((resolve, reject) => {
+        const stream = client.bidiStreaming(
+            'url', /* metadata= */ {}, methodDescriptor);
+        stream.on('data', (response) => reject());
+        stream.on('error', resolve);
+        stream.write(new MockRequest()).end();
+      });
+
+      assertEquals(StatusCode.NOT_FOUND, error.code);
+      assertEquals('not found', error.message);
+      assertElementsEquals(
+          [0, 0, 0, 0, 3, 1, 2, 3],
+          [].slice.call(fetches.calls[0].init['body']));
+    } finally {
+      fetches.restore();
+    }
+  },
+
+  async testServerStreamingWithDecodeWorker() {
+    const {worker, scope} = createWorkerChannel();
+    DecodeWorker.serve(
+        {'/Service/Method': (bytes) => ({data: String(bytes[0])})}, scope);
+    const xhr = new XhrIo();
+    const client = new GrpcWebClientBase({'decodeWorker': worker}, xhr);
+    const methodDescriptor = new MethodDescriptor(
+        '/Service/Method', /* methodType= */ null, MockRequest, MockReply,
+        (request) => [1, 2, 3],
+        (bytes) => fail('should decode responses in the worker'));
+
+    const events = [];
+    const ended = new Promise((resolve) => {
+      client
+          .serverStreaming(
+              'url', new MockRequest(), /* metadata= */ {}, methodDescriptor)
+          .on('data', (response) => events.push(response.data))
+          .on('end', () => {
+            events.push('end');
+            resolve();
+          });
+    });
+    xhr.simulatePartialResponse(
+        googCrypt.encodeByteArray(
+            new Uint8Array([...createFrame(0, [1]), ...createFrame(0, [2])])),
+        DEFAULT_RESPONSE_HEADERS);
+    // The response ends before the worker has decoded it.
+    xhr.simulateReadyStateChange(ReadyState.COMPLETE);
+    await ended;
+
+    assertElementsEquals(['1', '2', 'end'], events);
+  },
+
 });
 
+/**
+ * Replaces fetch() with a function resolving to |response|. Returns the calls
+ * made to it, and a function restoring fetch().
+ * @param {!Response} response
+ * @return {{calls: !Array<{url: string, init: !Object}>, restore: function()}}
+ */
+function mockFetch(response) {
+  const originalFetch = goog.global['fetch'];
+  const calls = [];
+  goog.global['fetch'] = (url, init) => {
+    calls.push({url: url, init: init});
+    return Promise.resolve(response);
+  };
+  return {
+    calls: calls,
+    restore: () => {
+      goog.global['fetch'] = originalFetch;
+    },
+  };
+}
+
+/**
+ * Returns a fake Worker and the global scope of its worker, both on this
+ * thread. Messages are delivered asynchronously, as they are by Workers.
+ * @return {{worker: !Object, scope: !Object}}
+ */
+function createWorkerChannel() {
+  const createEnd = () => ({
+    listeners: [],
+    addEventListener(type, listener) {
+      this.listeners.push(listener);
+    },
+  });
+  const worker = createEnd();
+  const scope = createEnd();
+  const connect = (from, to) => {
+    from.postMessage = (data) => {
+      setTimeout(() => to.listeners.forEach((listener) => listener({data})));
+    };
+  };
+  connect(worker, scope);
+  connect(scope, worker);
+  return {worker, scope};
+}
+
+/**
+ * Returns a gRPC-Web frame holding |data|, or the bytes of the string |data|.
+ * @param {number} type The frame type
+ * @param {string|!Array<number>} data
+ * @return {!Array<number>}
+ */
+function createFrame(type, data) {
+  const bytes = typeof data == 'string' ?
+      data.split('').map((c) => c.charCodeAt(0)) :
+      data;
+  const length = bytes.length;
+  return [
+    type, length >>> 24 & 0xFF, length >>> 16 & 0xFF, length >>> 8 & 0xFF,
+    length & 0xFF, ...bytes,
+  ];
+}
+
 /** Mocks a request proto object. */
 class MockRequest {
   /**
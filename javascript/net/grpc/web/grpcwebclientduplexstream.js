@@ -0,0 +1,613 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview gRPC web client Duplex Stream over fetch()
+ *
+ * XMLHttpRequest cannot stream request bodies, so client streaming and bidi
+ * streaming calls are sent with fetch(). Where the browser can stream request
+ * bodies (fetch() with duplex: 'half', which needs HTTP/2 or later), each
+ * request is uploaded as soon as it is written. Elsewhere, the requests are
+ * buffered and sent in one request body when the stream is ended, which the
+ * server reads as the same stream of requests.
+ *
+ * Either way the browser only reads the response once the request body is
+ * complete, so bidi calls are half duplex: responses arrive after end().
+ */
+goog.module('grpc.web.GrpcWebClientDuplexStream');
+
+goog.module.declareLegacyNamespace();
+
+
+const ClientDuplexStream = goog.require('grpc.web.ClientDuplexStream');
+const GrpcWebStreamParser = goog.require('grpc.web.GrpcWebStreamParser');
+const RpcError = goog.require('grpc.web.RpcError');
+const StatusCode = goog.require('grpc.web.StatusCode');
+const crypt = goog.require('goog.crypt');
+const googCrypt = goog.require('goog.crypt.base64');
+const googString = goog.require('goog.string');
+const {Status} = goog.require('grpc.web.Status');
+
+
+
+const GRPC_STATUS = 'grpc-status';
+const GRPC_STATUS_MESSAGE = 'grpc-message';
+
+/** @type {!Array<string>} */
+const EXCLUDED_RESPONSE_HEADERS =
+    ['content-type', GRPC_STATUS, GRPC_STATUS_MESSAGE];
+
+/** @type {?boolean} */
+let streamingUploadSupported = null;
+
+/**
+ * A stream that the client writes requests to and reads responses from.
+ * Used for client streaming and bidi streaming calls.
+ * @template REQUEST, RESPONSE
+ * @implements {ClientDuplexStream<REQUEST, RESPONSE>}
+ * @final
+ * @unrestricted
+ */
+class GrpcWebClientDuplexStream {
+  /**
+   * @param {string} format The wire format, 'text' or 'binary'
+   * @param {function(REQUEST):!Uint8Array} requestSerializeFn The serialize
+   *     function for the request proto
+   * @param {function(?):RESPONSE} responseDeserializeFn The deserialize
+   *     function for the response proto
+   */
+  constructor(format, requestSerializeFn, responseDeserializeFn) {
+    /** @const @private {boolean} */
+    this.isText_ = format == 'text';
+
+    /** @const @private {function(REQUEST):!Uint8Array} */
+    this.requestSerializeFn_ = requestSerializeFn;
+
+    /** @const @private {function(?):RESPONSE} */
+    this.responseDeserializeFn_ = responseDeserializeFn;
+
+    /**
+     * @private {?ReadableStreamDefaultController} Where requests are
+     *     written while they are uploaded, or null if they are buffered
+     */
+    this.controller_ = null;
+
+    /**
+     * @const @private {!Array<!Uint8Array>} The requests written so far, if
+     *     they are buffered
+     */
+    this.buffered_ = [];
+
+    /**
+     * @private {!Array<number>} The last bytes of the request body, not
+     *     base64-encoded yet, in text format
+     */
+    this.unencoded_ = [];
+
+    /**
+     * @private {?function()} Sends the buffered requests, if requests are
+     *     not uploaded as they are written
+     */
+    this.send_ = null;
+
+    /** @const @private {!AbortController} */
+    this.abortController_ = new AbortController();
+
+    /** @private {?number} The deadline timer */
+    this.timer_ = null;
+
+    /** @private {boolean} Whether the stream has been half-closed */
+    this.ended_ = false;
+
+    /** @private {boolean} Whether the stream has been aborted */
+    this.aborted_ = false;
+
+    /** @private {boolean} Whether the deadline of the call has passed */
+    this.timedOut_ = false;
+
+    /** @private {boolean} Whether an error has been sent */
+    this.errorSent_ = false;
+
+    /** @const @private {!GrpcWebStreamParser} The grpc-web stream parser */
+    this.parser_ = new GrpcWebStreamParser();
+
+    /** @private {string} The base64 response text not decoded yet */
+    this.responseText_ = '';
+
+    /** @const @private {!Array<function(!RESPONSE)>} */
+    this.onDataCallbacks_ = [];
+
+    /** @const @private {!Array<function(!Status)>} */
+    this.onStatusCallbacks_ = [];
+
+    /** @const @private {!Array<function(!Object<string, string>)>} */
+    this.onMetadataCallbacks_ = [];
+
+    /** @const @private {!Array<function(!RpcError)>} */
+    this.onErrorCallbacks_ = [];
+
+    /** @const @private {!Array<function(...):?>} */
+    this.onEndCallbacks_ = [];
+  }
+
+  /**
+   * Returns whether fetch() can stream request bodies. Browsers that cannot
+   * ignore the duplex option and send a ReadableStream body as text.
+   * @return {boolean}
+   */
+  static supportsStreamingUpload() {
+    if (streamingUploadSupported === null) {
+      streamingUploadSupported = false;
+      if (typeof ReadableStream != 'undefined' &&
+          typeof Request != 'undefined') {
+        let duplexAccessed = false;
+        try {
+          const hasContentType =
+              new Request('data:,', /** @type {!RequestInit} */ ({
+                'body': new ReadableStream(),
+                'method': 'POST',
+                get 'duplex'() {
+                  duplexAccessed = true;
+                  return 'half';
+                },
+              })).headers.has('Content-Type');
+          streamingUploadSupported = duplexAccessed && !hasContentType;
+        } catch (e) {
+          // Not supported.
+        }
+      }
+    }
+    return streamingUploadSupported;
+  }
+
+  /**
+   * Starts the call, before any request is written.
+   *
+   * @param {string} url The URL of the method
+   * @param {!Object<string, string>} headers The request headers
+   * @param {boolean} withCredentials Whether to send cookies to other
+   *     origins
+   * @param {boolean} streamingUpload Whether to upload requests as they are
+   *     written, rather than when the stream is ended
+   * @param {number} timeout The time in ms after which the call is
+   *     aborted, or 0
+   */
+  start(url, headers, withCredentials, streamingUpload, timeout) {
+    const init = {
+      'method': 'POST',
+      'headers': headers,
+      'credentials': withCredentials ? 'include' : 'same-origin',
+      'signal': this.abortController_.signal,
+    };
+    if (timeout > 0) {
+      this.timer_ = setTimeout(() => {
+        this.timedOut_ = true;
+        this.abortController_.abort();
+        if (this.send_ && !this.ended_) {
+          // No request was sent, so fetch() cannot report the timeout.
+          this.aborted_ = true;
+          this.handleError_(
+              new RpcError(StatusCode.DEADLINE_EXCEEDED, 'Timeout'));
+        }
+      }, timeout);
+    }
+    if (!streamingUpload) {
+      this.send_ = () => {
+        init['body'] = this.concatBuffered_();
+        this.fetch_(url, init);
+      };
+      return;
+    }
+    init['body'] = new ReadableStream({
+      'start': (controller) => {
+        this.controller_ = controller;
+      },
+    });
+    init['duplex'] = 'half';
+    this.fetch_(url, init);
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  write(request) {
+    if (this.ended_ || this.aborted_) {
+      return this;
+    }
+    const frame = this.encodeBody_(
+        GrpcWebClientDuplexStream.encodeFrame_(
+            this.requestSerializeFn_(request)));
+    if (this.controller_) {
+      this.controller_.enqueue(frame);
+    } else {
+      this.buffered_.push(frame);
+    }
+    return this;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  end() {
+    if (this.ended_ || this.aborted_) {
+      return this;
+    }
+    this.ended_ = true;
+    const rest = this.finishBody_();
+    if (this.controller_) {
+      if (rest.length) {
+        this.controller_.enqueue(rest);
+      }
+      this.controller_.close();
+    } else {
+      if (rest.length) {
+        this.buffered_.push(rest);
+      }
+      this.send_();
+    }
+    return this;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  on(eventType, callback) {
+    if (eventType == 'data') {
+      this.onDataCallbacks_.push(callback);
+    } else if (eventType == 'status') {
+      this.onStatusCallbacks_.push(callback);
+    } else if (eventType == 'metadata') {
+      this.onMetadataCallbacks_.push(callback);
+    } else if (eventType == 'end') {
+      this.onEndCallbacks_.push(callback);
+    } else if (eventType == 'error') {
+      this.onErrorCallbacks_.push(callback);
+    }
+    return this;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  removeListener(eventType, callback) {
+    const callbacks = eventType == 'data' ? this.onDataCallbacks_ :
+        eventType == 'status'             ? this.onStatusCallbacks_ :
+        eventType == 'metadata'           ? this.onMetadataCallbacks_ :
+        eventType == 'end'                ? this.onEndCallbacks_ :
+        eventType == 'error'              ? this.onErrorCallbacks_ :
+                                            [];
+    const index = callbacks.indexOf(callback);
+    if (index > -1) {
+      callbacks.splice(index, 1);
+    }
+    return this;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  cancel() {
+    this.aborted_ = true;
+    this.abortController_.abort();
+    this.clearTimer_();
+  }
+
+  /**
+   * Sends the request and reads the response.
+   *
+   * @private
+   * @param {string} url
+   * @param {!Object} init
+   */
+  fetch_(url, init) {
+    fetch(url, /** @type {!RequestInit} */ (init))
+        .then((response) => this.readResponse_(response))
+        .catch((error) => {
+          this.clearTimer_();
+          if (this.aborted_) {
+            return;
+          }
+          if (this.timedOut_) {
+            this.handleError_(
+                new RpcError(StatusCode.DEADLINE_EXCEEDED, 'Timeout'));
+          } else {
+            this.handleError_(
+                new RpcError(StatusCode.UNAVAILABLE, String(error)));
+          }
+        });
+  }
+
+  /**
+   * @private
+   * @param {!Response} response
+   * @return {!Promise<void>}
+   */
+  async readResponse_(response) {
+    const headers = {};
+    response.headers.forEach((value, key) => {
+      headers[key.toLowerCase()] = value;
+    });
+    const metadata = {};
+    Object.keys(headers).forEach((header) => {
+      if (!EXCLUDED_RESPONSE_HEADERS.includes(header)) {
+        metadata[header] = headers[header];
+      }
+    });
+    this.sendMetadataCallbacks_(metadata);
+
+    if (GRPC_STATUS in headers) {
+      // A trailers-only response.
+      this.clearTimer_();
+      const code = /** @type {!StatusCode} */ (Number(headers[GRPC_STATUS]));
+      this.handleError_(
+          new RpcError(code, headers[GRPC_STATUS_MESSAGE] || '', metadata));
+      if (code == StatusCode.OK) {
+        this.sendEndCallbacks_();
+      }
+      return;
+    }
+    if (!response.ok) {
+      this.clearTimer_();
+      this.handleError_(new RpcError(
+          StatusCode.fromHttpStatus(response.status),
+          'http status code: ' + response.status));
+      return;
+    }
+    const contentType = (headers['content-type'] || '').toLowerCase();
+    if (!googString.startsWith(contentType, 'application/grpc')) {
+      this.clearTimer_();
+      this.handleError_(
+          new RpcError(StatusCode.UNKNOWN, 'Unknown Content-type received.'));
+      return;
+    }
+
+    const reader = response.body.getReader();
+    while (true) {
+      const {done, value} = await reader.read();
+      if (done || this.errorSent_) {
+        break;
+      }
+      this.handleBytes_(value);
+    }
+    this.clearTimer_();
+    if (!this.errorSent_) {
+      this.sendEndCallbacks_();
+    }
+  }
+
+  /**
+   * Parses a chunk of the response body and dispatches the responses and
+   * trailers in it.
+   *
+   * @private
+   * @param {!Uint8Array} chunk
+   */
+  handleBytes_(chunk) {
+    let bytes = chunk;
+    if (this.isText_) {
+      this.responseText_ += crypt.byteArrayToString(chunk);
+      const end = this.responseText_.length - this.responseText_.length % 4;
+      if (end == 0) {
+        return;
+      }
+      bytes =
+          googCrypt.decodeStringToUint8Array(this.responseText_.substr(0, end));
+      this.responseText_ = this.responseText_.substr(end);
+    }
+    let messages;
+    try {
+      messages = this.parser_.parse(bytes);
+    } catch (err) {
+      this.handleError_(
+          new RpcError(StatusCode.UNKNOWN, 'Error in parsing response body'));
+      return;
+    }
+    if (!messages) {
+      return;
+    }
+    const FrameType = GrpcWebStreamParser.FrameType;
+    for (let i = 0; i < messages.length && !this.errorSent_; i++) {
+      if (FrameType.DATA in messages[i]) {
+        let response;
+        try {
+          response = this.responseDeserializeFn_(messages[i][FrameType.DATA]);
+        } catch (err) {
+          this.handleError_(new RpcError(
+              StatusCode.INTERNAL,
+              `Error when deserializing response data; error: ${err}`));
+          return;
+        }
+        this.sendDataCallbacks_(response);
+      }
+      if (FrameType.TRAILER in messages[i]) {
+        const trailers = GrpcWebClientDuplexStream.parseHttp1Headers_(
+            crypt.byteArrayToString(messages[i][FrameType.TRAILER]));
+        let code = StatusCode.OK;
+        let message = '';
+        if (GRPC_STATUS in trailers) {
+          code = /** @type {!StatusCode} */ (Number(trailers[GRPC_STATUS]));
+          delete trailers[GRPC_STATUS];
+        }
+        if (GRPC_STATUS_MESSAGE in trailers) {
+          message = trailers[GRPC_STATUS_MESSAGE];
+          delete trailers[GRPC_STATUS_MESSAGE];
+        }
+        this.handleError_(new RpcError(code, message, trailers));
+      }
+    }
+  }
+
+  /**
+   * Returns the bytes to add to the request body for |frame|. In text format
+   * only whole groups of 3 bytes are base64-encoded, so that the body is a
+   * single base64 string without padding in the middle.
+   *
+   * @private
+   * @param {!Uint8Array} frame
+   * @return {!Uint8Array}
+   */
+  encodeBody_(frame) {
+    if (!this.isText_) {
+      return frame;
+    }
+    const bytes = this.unencoded_.concat(Array.from(frame));
+    const end = bytes.length - bytes.length % 3;
+    this.unencoded_ = bytes.slice(end);
+    return new Uint8Array(crypt.stringToByteArray(
+        googCrypt.encodeByteArray(bytes.slice(0, end))));
+  }
+
+  /**
+   * Returns the last bytes of the request body.
+   *
+   * @private
+   * @return {!Uint8Array}
+   */
+  finishBody_() {
+    const bytes = this.unencoded_;
+    this.unencoded_ = [];
+    return new Uint8Array(
+        crypt.stringToByteArray(googCrypt.encodeByteArray(bytes)));
+  }
+
+  /**
+   * @private
+   * @return {!Uint8Array} The buffered requests, concatenated
+   */
+  concatBuffered_() {
+    let length = 0;
+    for (let i = 0; i < this.buffered_.length; i++) {
+      length += this.buffered_[i].length;
+    }
+    const body = new Uint8Array(length);
+    let pos = 0;
+    for (let i = 0; i < this.buffered_.length; i++) {
+      body.set(this.buffered_[i], pos);
+      pos += this.buffered_[i].length;
+    }
+    this.buffered_.length = 0;
+    return body;
+  }
+
+  /** @private */
+  clearTimer_() {
+    if (this.timer_ !== null) {
+      clearTimeout(this.timer_);
+      this.timer_ = null;
+    }
+  }
+
+  /**
+   * @private
+   * @static
+   * @param {!Uint8Array|!Array<number>} serialized The serialized proto
+   * @return {!Uint8Array} The application/grpc-web data frame of |serialized|
+   */
+  static encodeFrame_(serialized) {
+    const length = serialized.length;
+    const frame = new Uint8Array(5 + length);
+    frame[1] = (length >>> 24) & 0xff;
+    frame[2] = (length >>> 16) & 0xff;
+    frame[3] = (length >>> 8) & 0xff;
+    frame[4] = length & 0xff;
+    frame.set(serialized, 5);
+    return frame;
+  }
+
+  /**
+   * @private
+   * @static
+   * @param {string} str The raw http header string
+   * @return {!Object<string, string>} The header:value pairs
+   */
+  static parseHttp1Headers_(str) {
+    const chunks = str.trim().split('\r\n');
+    const headers = {};
+    for (let i = 0; i < chunks.length; i++) {
+      const pos = chunks[i].indexOf(':');
+      headers[chunks[i].substring(0, pos).trim()] =
+          chunks[i].substring(pos + 1).trim();
+    }
+    return headers;
+  }
+
+  /**
+   * Sends the status of the call, and an error if it failed. Nothing is
+   * sent after an error.
+   *
+   * @private
+   * @param {!RpcError} error
+   */
+  handleError_(error) {
+    if (this.errorSent_) {
+      return;
+    }
+    const details = decodeURIComponent(error.message || '');
+    if (error.code != StatusCode.OK) {
+      this.errorSent_ = true;
+      this.abortController_.abort();
+      for (let i = 0; i < this.onErrorCallbacks_.length; i++) {
+        this.onErrorCallbacks_[i](
+            new RpcError(error.code, details, error.metadata));
+      }
+    }
+    const status = /** @type {!Status} */ ({
+      code: error.code,
+      details: details,
+      metadata: error.metadata,
+    });
+    for (let i = 0; i < this.onStatusCallbacks_.length; i++) {
+      this.onStatusCallbacks_[i](status);
+    }
+  }
+
+  /**
+   * @private
+   * @param {!RESPONSE} data
+   */
+  sendDataCallbacks_(data) {
+    for (let i = 0; i < this.onDataCallbacks_.length; i++) {
+      this.onDataCallbacks_[i](data);
+    }
+  }
+
+  /**
+   * @private
+   * @param {!Object<string, string>} metadata
+   */
+  sendMetadataCallbacks_(metadata) {
+    for (let i = 0; i < this.onMetadataCallbacks_.length; i++) {
+      this.onMetadataCallbacks_[i](metadata);
+    }
+  }
+
+  /** @private */
+  sendEndCallbacks_() {
+    for (let i = 0; i < this.onEndCallbacks_.length; i++) {
+      this.onEndCallbacks_[i]();
+    }
+  }
+}
+
+
+
+exports = GrpcWebClientDuplexStream;
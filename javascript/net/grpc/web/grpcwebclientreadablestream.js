@@ -32,6 +32,7 @@ goog.module.declareLegacyNamespace();
 
 
 const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
+const DecodeWorker = goog.requireType('grpc.web.DecodeWorker');
 const ErrorCode = goog.require('goog.net.ErrorCode');
 const EventType = goog.require('goog.net.EventType');
 const GrpcWebStreamParser = goog.require('grpc.web.GrpcWebStreamParser');
@@ -80,6 +81,33 @@ class GrpcWebClientReadableStream {
      */
     this.responseDeserializeFn_ = null;
 
+    /**
+     * @private
+     * @type {?function(?, !RESPONSE):!RESPONSE} The deserialize function
+     *   overwriting a pooled response, if responses are reused
+     */
+    this.responseDeserializeIntoFn_ = null;
+
+    /**
+     * @const
+     * @private
+     * @type {!Array<!RESPONSE>} The responses reused, in turn, by the
+     *   next responses
+     */
+    this.responsePool_ = [];
+
+    /**
+     * @private
+     * @type {number} The number of responses to reuse
+     */
+    this.responsePoolSize_ = 0;
+
+    /**
+     * @private
+     * @type {number} The number of responses received
+     */
+    this.responseCount_ = 0;
+
     /**
      * @const
      * @private
@@ -134,13 +162,39 @@ class GrpcWebClientReadableStream {
      */
     this.parser_ = new GrpcWebStreamParser();
 
+    /**
+     * @private
+     * @type {?DecodeWorker} The worker decoding the responses, if any
+     */
+    this.decodeWorker_ = null;
+
+    /**
+     * @private
+     * @type {number} The id of the response in the decode worker
+     */
+    this.decodeId_ = 0;
+
+    /**
+     * @private
+     * @type {number} The number of chunks posted to the decode worker and not
+     *   decoded yet
+     */
+    this.pendingDecodes_ = 0;
+
+    /**
+     * @private
+     * @type {boolean} Whether the response is complete, but waits for the
+     *   decode worker
+     */
+    this.completePending_ = false;
+
     const self = this;
     events.listen(this.xhr_, EventType.READY_STATE_CHANGE, function(e) {
       let contentType = self.xhr_.getStreamingResponseHeader('Content-Type');
       if (!contentType) return;
       contentType = contentType.toLowerCase();
 
-      let byteSource;
+      let chunk;
       if (googString.startsWith(contentType, 'application/grpc-web-text')) {
         // Ensure responseText is not null
         const responseText = self.xhr_.getResponseText() || '';
@@ -148,143 +202,216 @@ class GrpcWebClientReadableStream {
         const newData = responseText.substr(self.pos_, newPos - self.pos_);
         if (newData.length == 0) return;
         self.pos_ = newPos;
-        byteSource = googCrypt.decodeStringToUint8Array(newData);
+        chunk = newData;
       } else if (googString.startsWith(contentType, 'application/grpc')) {
-        byteSource = new Uint8Array(
+        chunk = new Uint8Array(
             /** @type {!ArrayBuffer} */ (self.xhr_.getResponse()));
       } else {
         self.handleError_(
             new RpcError(StatusCode.UNKNOWN, 'Unknown Content-type received.'));
         return;
       }
+      if (self.decodeWorker_) {
+        if (chunk.length == 0) return;
+        self.pendingDecodes_++;
+        self.decodeWorker_.decode(self.decodeId_, chunk);
+        return;
+      }
       let messages = null;
       try {
-        messages = self.parser_.parse(byteSource);
+        messages = self.parser_.parse(
+            typeof chunk == 'string' ?
+                googCrypt.decodeStringToUint8Array(chunk) :
+                chunk);
       } catch (err) {
         self.handleError_(
             new RpcError(StatusCode.UNKNOWN, 'Error in parsing response body'));
       }
       if (messages) {
-        const FrameType = GrpcWebStreamParser.FrameType;
-        for (let i = 0; i < messages.length; i++) {
-          if (FrameType.DATA in messages[i]) {
-            const data = messages[i][FrameType.DATA];
-            if (data) {
-              let isResponseDeserialized = false;
-              let response;
-              try {
-                response = self.responseDeserializeFn_(data);
-                isResponseDeserialized = true;
-              } catch (err) {
-                self.handleError_(new RpcError(
-                    StatusCode.INTERNAL,
-                    `Error when deserializing response data; error: ${err}` +
-                        `, response: ${response}`));
-              }
-              if (isResponseDeserialized) {
-                self.sendDataCallbacks_(response);
-              }
-            }
-          }
-          if (FrameType.TRAILER in messages[i]) {
-            if (messages[i][FrameType.TRAILER].length > 0) {
-              let trailerString = '';
-              for (let pos = 0; pos < messages[i][FrameType.TRAILER].length;
-                   pos++) {
-                trailerString +=
-                    String.fromCharCode(messages[i][FrameType.TRAILER][pos]);
-              }
-              const trailers = self.parseHttp1Headers_(trailerString);
-              let grpcStatusCode = StatusCode.OK;
-              let grpcStatusMessage = '';
-              if (GRPC_STATUS in trailers) {
-                grpcStatusCode =
-                    /** @type {!StatusCode} */ (Number(trailers[GRPC_STATUS]));
-                delete trailers[GRPC_STATUS];
-              }
-              if (GRPC_STATUS_MESSAGE in trailers) {
-                grpcStatusMessage = trailers[GRPC_STATUS_MESSAGE];
-                delete trailers[GRPC_STATUS_MESSAGE];
-              }
-              self.handleError_(
-                  new RpcError(grpcStatusCode, grpcStatusMessage, trailers));
-            }
-          }
-        }
+        self.handleMessages_(messages, false);
       }
     });
 
     events.listen(this.xhr_, EventType.COMPLETE, function(e) {
-      const lastErrorCode = self.xhr_.getLastErrorCode();
-      let grpcStatusCode = StatusCode.UNKNOWN;
-      let grpcStatusMessage = '';
-      const initialMetadata = /** @type {!Metadata} */ ({});
-
-      // Get response headers with lower case keys.
-      const rawResponseHeaders = self.xhr_.getResponseHeaders();
-      const responseHeaders = {};
-      for (const key in rawResponseHeaders) {
-        if (rawResponseHeaders.hasOwnProperty(key)) {
-          responseHeaders[key.toLowerCase()] = rawResponseHeaders[key];
-        }
+      if (self.pendingDecodes_ > 0) {
+        self.completePending_ = true;
+        return;
       }
+      self.handleComplete_();
+    });
+  }
 
-      Object.keys(responseHeaders).forEach((header_) => {
-        if (!(EXCLUDED_RESPONSE_HEADERS.includes(header_))) {
-          initialMetadata[header_] = responseHeaders[header_];
-        }
-      });
-      self.sendMetadataCallbacks_(initialMetadata);
-
-      // There's an XHR level error
-      let xhrStatusCode = -1;
-      if (lastErrorCode != ErrorCode.NO_ERROR) {
-        switch (lastErrorCode) {
-          case ErrorCode.ABORT:
-            grpcStatusCode = StatusCode.ABORTED;
-            break;
-          case ErrorCode.TIMEOUT:
-            grpcStatusCode = StatusCode.DEADLINE_EXCEEDED;
-            break;
-          case ErrorCode.HTTP_ERROR:
-            xhrStatusCode = self.xhr_.getStatus();
-            grpcStatusCode = StatusCode.fromHttpStatus(xhrStatusCode);
-            break;
-          default:
-            grpcStatusCode = StatusCode.UNAVAILABLE;
-        }
-        if (grpcStatusCode == StatusCode.ABORTED && self.aborted_) {
-          return;
+  /**
+   * Decodes the responses in |decodeWorker| instead of this thread. The
+   * responses are the plain objects decoded by the worker, so the response
+   * deserialize functions are not used.
+   *
+   * @param {!DecodeWorker} decodeWorker
+   * @param {string} method The method, e.g. /grpc.gateway.testing.EchoService/Echo
+   */
+  setDecodeWorker(decodeWorker, method) {
+    this.decodeWorker_ = decodeWorker;
+    this.decodeId_ = decodeWorker.open(
+        method,
+        (messages, code, error) => this.onDecoded_(messages, code, error));
+  }
+
+  /**
+   * Handles the results of decoding a chunk in the decode worker.
+   *
+   * @private
+   * @param {!Array<!Object>} messages The frames, with decoded data
+   * @param {?StatusCode} code The code of the error, if any
+   * @param {?string} error The error, if any
+   */
+  onDecoded_(messages, code, error) {
+    this.pendingDecodes_--;
+    if (this.aborted_) return;
+    if (error) {
+      this.handleError_(new RpcError(/** @type {!StatusCode} */ (code), error));
+    } else {
+      this.handleMessages_(messages, true);
+    }
+    if (this.pendingDecodes_ == 0 && this.completePending_) {
+      this.completePending_ = false;
+      this.handleComplete_();
+    }
+  }
+
+  /**
+   * Dispatches the frames parsed from the response body.
+   *
+   * @private
+   * @param {!Array<!Object>} messages The frames
+   * @param {boolean} decoded Whether the data frames hold decoded responses
+   */
+  handleMessages_(messages, decoded) {
+    const FrameType = GrpcWebStreamParser.FrameType;
+    for (let i = 0; i < messages.length; i++) {
+      if (FrameType.DATA in messages[i]) {
+        const data = messages[i][FrameType.DATA];
+        if (data) {
+          let isResponseDeserialized = false;
+          let response;
+          try {
+            response = decoded ? data : this.deserializeResponse_(data);
+            isResponseDeserialized = true;
+          } catch (err) {
+            this.handleError_(new RpcError(
+                StatusCode.INTERNAL,
+                `Error when deserializing response data; error: ${err}` +
+                    `, response: ${response}`));
+          }
+          if (isResponseDeserialized) {
+            this.sendDataCallbacks_(response);
+          }
         }
-        let errorMessage = ErrorCode.getDebugMessage(lastErrorCode);
-        if (xhrStatusCode != -1) {
-          errorMessage += ', http status code: ' + xhrStatusCode;
+      }
+      if (FrameType.TRAILER in messages[i]) {
+        if (messages[i][FrameType.TRAILER].length > 0) {
+          let trailerString = '';
+          for (let pos = 0; pos < messages[i][FrameType.TRAILER].length;
+               pos++) {
+            trailerString +=
+                String.fromCharCode(messages[i][FrameType.TRAILER][pos]);
+          }
+          const trailers = this.parseHttp1Headers_(trailerString);
+          let grpcStatusCode = StatusCode.OK;
+          let grpcStatusMessage = '';
+          if (GRPC_STATUS in trailers) {
+            grpcStatusCode =
+                /** @type {!StatusCode} */ (Number(trailers[GRPC_STATUS]));
+            delete trailers[GRPC_STATUS];
+          }
+          if (GRPC_STATUS_MESSAGE in trailers) {
+            grpcStatusMessage = trailers[GRPC_STATUS_MESSAGE];
+            delete trailers[GRPC_STATUS_MESSAGE];
+          }
+          this.handleError_(
+              new RpcError(grpcStatusCode, grpcStatusMessage, trailers));
         }
+      }
+    }
+  }
+
+  /**
+   * Handles the end of the response.
+   *
+   * @private
+   */
+  handleComplete_() {
+    if (this.decodeWorker_) {
+      this.decodeWorker_.close(this.decodeId_);
+    }
+    const lastErrorCode = this.xhr_.getLastErrorCode();
+    let grpcStatusCode = StatusCode.UNKNOWN;
+    let grpcStatusMessage = '';
+    const initialMetadata = /** @type {!Metadata} */ ({});
+
+    // Get response headers with lower case keys.
+    const rawResponseHeaders = this.xhr_.getResponseHeaders();
+    const responseHeaders = {};
+    for (const key in rawResponseHeaders) {
+      if (rawResponseHeaders.hasOwnProperty(key)) {
+        responseHeaders[key.toLowerCase()] = rawResponseHeaders[key];
+      }
+    }
 
-        self.handleError_(new RpcError(grpcStatusCode, errorMessage));
+    Object.keys(responseHeaders).forEach((header_) => {
+      if (!(EXCLUDED_RESPONSE_HEADERS.includes(header_))) {
+        initialMetadata[header_] = responseHeaders[header_];
+      }
+    });
+    this.sendMetadataCallbacks_(initialMetadata);
+
+    // There's an XHR level error
+    let xhrStatusCode = -1;
+    if (lastErrorCode != ErrorCode.NO_ERROR) {
+      switch (lastErrorCode) {
+        case ErrorCode.ABORT:
+          grpcStatusCode = StatusCode.ABORTED;
+          break;
+        case ErrorCode.TIMEOUT:
+          grpcStatusCode = StatusCode.DEADLINE_EXCEEDED;
+          break;
+        case ErrorCode.HTTP_ERROR:
+          xhrStatusCode = this.xhr_.getStatus();
+          grpcStatusCode = StatusCode.fromHttpStatus(xhrStatusCode);
+          break;
+        default:
+          grpcStatusCode = StatusCode.UNAVAILABLE;
+      }
+      if (grpcStatusCode == StatusCode.ABORTED && this.aborted_) {
         return;
       }
+      let errorMessage = ErrorCode.getDebugMessage(lastErrorCode);
+      if (xhrStatusCode != -1) {
+        errorMessage += ', http status code: ' + xhrStatusCode;
+      }
 
-      let errorEmitted = false;
+      this.handleError_(new RpcError(grpcStatusCode, errorMessage));
+      return;
+    }
 
-      // Check whethere there are grpc specific response headers
-      if (GRPC_STATUS in responseHeaders) {
-        grpcStatusCode = /** @type {!StatusCode} */ (
-            Number(responseHeaders[GRPC_STATUS]));
-        if (GRPC_STATUS_MESSAGE in responseHeaders) {
-          grpcStatusMessage = responseHeaders[GRPC_STATUS_MESSAGE];
-        }
-        if (grpcStatusCode != StatusCode.OK) {
-          self.handleError_(new RpcError(
-              grpcStatusCode, grpcStatusMessage || '', responseHeaders));
-          errorEmitted = true;
-        }
-      }
+    let errorEmitted = false;
 
-      if (!errorEmitted) {
-        self.sendEndCallbacks_();
+    // Check whethere there are grpc specific response headers
+    if (GRPC_STATUS in responseHeaders) {
+      grpcStatusCode = /** @type {!StatusCode} */ (
+          Number(responseHeaders[GRPC_STATUS]));
+      if (GRPC_STATUS_MESSAGE in responseHeaders) {
+        grpcStatusMessage = responseHeaders[GRPC_STATUS_MESSAGE];
       }
-    });
+      if (grpcStatusCode != StatusCode.OK) {
+        this.handleError_(new RpcError(
+            grpcStatusCode, grpcStatusMessage || '', responseHeaders));
+        errorEmitted = true;
+      }
+    }
+
+    if (!errorEmitted) {
+      this.sendEndCallbacks_();
+    }
   }
 
   /**
@@ -348,12 +475,45 @@ class GrpcWebClientReadableStream {
     this.responseDeserializeFn_ = responseDeserializeFn;
   }
 
+  /**
+   * Reuses responses: each response is deserialized into the one received
+   * |poolSize| responses earlier, once there is one.
+   *
+   * @param {function(?, !RESPONSE):!RESPONSE} responseDeserializeIntoFn The
+   *   function deserializing into an existing response
+   * @param {number} poolSize The number of responses to reuse
+   */
+  setResponseDeserializeIntoFn(responseDeserializeIntoFn, poolSize) {
+    this.responseDeserializeIntoFn_ = responseDeserializeIntoFn;
+    this.responsePoolSize_ = poolSize;
+  }
+
+  /**
+   * @private
+   * @param {?} data The serialized response
+   * @return {!RESPONSE} The response
+   */
+  deserializeResponse_(data) {
+    if (!this.responseDeserializeIntoFn_) {
+      return this.responseDeserializeFn_(data);
+    }
+    const index = this.responseCount_++ % this.responsePoolSize_;
+    const response = index < this.responsePool_.length ?
+        this.responseDeserializeIntoFn_(data, this.responsePool_[index]) :
+        this.responseDeserializeFn_(data);
+    this.responsePool_[index] = response;
+    return response;
+  }
+
   /**
    * @override
    * @export
    */
   cancel() {
     this.aborted_ = true;
+    if (this.decodeWorker_) {
+      this.decodeWorker_.close(this.decodeId_);
+    }
     this.xhr_.abort();
   }
 
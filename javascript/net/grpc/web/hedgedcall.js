@@ -0,0 +1,235 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview A unary call hedged by a second identical request, for
+ * clients created with the hedgingDelayMs option.
+ *
+ * If the first request has not received a response after the hedging delay,
+ * a second one is sent, and the call takes the response of whichever request
+ * receives one first. The other request is cancelled. A request failing while
+ * the other one is still in flight is ignored, so that the call only fails
+ * once both requests have failed.
+ */
+goog.module('grpc.web.HedgedCall');
+
+goog.module.declareLegacyNamespace();
+
+
+const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
+
+
+
+/** @type {!Array<string>} */
+const EVENT_TYPES = ['data', 'status', 'metadata', 'error', 'end'];
+
+/**
+ * A request of the call, and the events it sent while no request had won.
+ * @typedef {{
+ *   stream: !ClientReadableStream<?>,
+ *   events: !Array<{type: string, value: ?}>,
+ *   failed: boolean,
+ * }}
+ */
+let Attempt;
+
+/**
+ * @template RESPONSE
+ * @implements {ClientReadableStream<RESPONSE>}
+ * @final
+ * @unrestricted
+ */
+class HedgedCall {
+  /**
+   * Starts the call.
+   *
+   * @param {function():!ClientReadableStream<RESPONSE>} startAttempt Sends a
+   *     request of the call
+   * @param {number} delay The time in ms after which the second request is
+   *     sent
+   * @param {function(boolean)} onHedge Called with false when the second
+   *     request is sent, and with true when the call succeeds with its
+   *     response
+   */
+  constructor(startAttempt, delay, onHedge) {
+    /** @const @private {function():!ClientReadableStream<RESPONSE>} */
+    this.startAttempt_ = startAttempt;
+
+    /** @const @private {function(boolean)} */
+    this.onHedge_ = onHedge;
+
+    /** @const @private {!Array<!Attempt>} The requests sent */
+    this.attempts_ = [];
+
+    /** @private {?Attempt} The request whose events are sent */
+    this.winner_ = null;
+
+    /** @private {boolean} Whether the call was cancelled */
+    this.cancelled_ = false;
+
+    /** @const @private {!Object<string, !Array<function(?)>>} */
+    this.callbacks_ = {
+      'data': [],
+      'status': [],
+      'metadata': [],
+      'error': [],
+      'end': [],
+    };
+
+    /** @private {?number} Sends the second request */
+    this.timer_ = null;
+
+    this.sendAttempt_();
+    if (!this.winner_) {
+      this.timer_ = setTimeout(() => {
+        this.timer_ = null;
+        this.sendAttempt_();
+        this.onHedge_(false);
+      }, delay);
+    }
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  on(eventType, callback) {
+    if (eventType in this.callbacks_) {
+      this.callbacks_[eventType].push(callback);
+    }
+    return this;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  removeListener(eventType, callback) {
+    const callbacks = this.callbacks_[eventType] || [];
+    const index = callbacks.indexOf(callback);
+    if (index > -1) {
+      callbacks.splice(index, 1);
+    }
+    return this;
+  }
+
+  /**
+   * Cancels every request in flight.
+   * @override
+   * @export
+   */
+  cancel() {
+    if (this.cancelled_) {
+      return;
+    }
+    this.cancelled_ = true;
+    this.clearTimer_();
+    for (const attempt of this.attempts_) {
+      if (!attempt.failed) {
+        attempt.stream.cancel();
+      }
+    }
+  }
+
+  /**
+   * @private
+   */
+  sendAttempt_() {
+    const attempt = {stream: this.startAttempt_(), events: [], failed: false};
+    this.attempts_.push(attempt);
+    for (const type of EVENT_TYPES) {
+      attempt.stream.on(type, (value) => this.onEvent_(attempt, type, value));
+    }
+  }
+
+  /**
+   * Sends the events of the winning request. Until there is one, the events
+   * are kept, and a request wins once it receives a response, ends, or fails
+   * while the other request is not in flight.
+   *
+   * @private
+   * @param {!Attempt} attempt
+   * @param {string} type
+   * @param {?} value
+   */
+  onEvent_(attempt, type, value) {
+    if (this.cancelled_ || attempt.failed) {
+      return;
+    }
+    if (this.winner_) {
+      if (attempt === this.winner_) {
+        this.sendEvent_(type, value);
+      }
+      return;
+    }
+    attempt.events.push({type: type, value: value});
+    if (type == 'error' &&
+        this.attempts_.some((other) => other !== attempt && !other.failed)) {
+      attempt.failed = true;
+    } else if (type == 'data' || type == 'error' || type == 'end') {
+      this.setWinner_(attempt, type != 'error');
+    }
+  }
+
+  /**
+   * @private
+   * @param {!Attempt} attempt
+   * @param {boolean} succeeded Whether the request did not fail
+   */
+  setWinner_(attempt, succeeded) {
+    this.winner_ = attempt;
+    this.clearTimer_();
+    for (const other of this.attempts_) {
+      if (other !== attempt && !other.failed) {
+        other.stream.cancel();
+      }
+    }
+    if (succeeded && attempt !== this.attempts_[0]) {
+      this.onHedge_(true);
+    }
+    const events = attempt.events;
+    attempt.events = [];
+    for (const event of events) {
+      this.sendEvent_(event.type, event.value);
+    }
+  }
+
+  /**
+   * @private
+   * @param {string} type
+   * @param {?} value
+   */
+  sendEvent_(type, value) {
+    for (const callback of this.callbacks_[type].slice()) {
+      callback(value);
+    }
+  }
+
+  /**
+   * @private
+   */
+  clearTimer_() {
+    if (this.timer_ !== null) {
+      clearTimeout(this.timer_);
+      this.timer_ = null;
+    }
+  }
+}
+
+
+
+exports = HedgedCall;
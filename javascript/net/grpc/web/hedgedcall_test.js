@@ -0,0 +1,158 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+goog.module('grpc.web.HedgedCallTest');
+goog.setTestOnly('grpc.web.HedgedCallTest');
+
+const HedgedCall = goog.require('grpc.web.HedgedCall');
+const testSuite = goog.require('goog.testing.testSuite');
+goog.require('goog.testing.jsunit');
+
+
+/** A request of a hedged call, whose events are sent by the test. */
+class MockStream {
+  constructor() {
+    /** @const {!Object<string, !Array<function(?)>>} */
+    this.callbacks = {};
+
+    /** @type {boolean} */
+    this.cancelled = false;
+  }
+
+  /**
+   * @param {string} eventType
+   * @param {function(?)} callback
+   * @return {!MockStream}
+   */
+  on(eventType, callback) {
+    (this.callbacks[eventType] = this.callbacks[eventType] || [])
+        .push(callback);
+    return this;
+  }
+
+  /**
+   * @param {string} eventType
+   * @param {?=} value
+   */
+  send(eventType, value = undefined) {
+    (this.callbacks[eventType] || []).forEach((callback) => callback(value));
+  }
+
+  cancel() {
+    this.cancelled = true;
+  }
+}
+
+/**
+ * Starts a hedged call, recording its requests, its events and the calls to
+ * its onHedge callback.
+ * @param {number} delay
+ * @return {{call: !HedgedCall, streams: !Array<!MockStream>,
+ *     events: !Array<string>, hedges: !Array<boolean>}}
+ */
+function startCall(delay) {
+  const streams = [];
+  const events = [];
+  const hedges = [];
+  const call = new HedgedCall(() => {
+    const stream = new MockStream();
+    streams.push(stream);
+    return stream;
+  }, delay, (won) => hedges.push(won));
+  for (const type of ['data', 'status', 'metadata', 'error', 'end']) {
+    call.on(type, (value) => events.push(`${type} ${value}`));
+  }
+  return {call, streams, events, hedges};
+}
+
+/** @return {!Promise<void>} Resolves after the hedging delays of 0 ms */
+function waitForHedge() {
+  return new Promise((resolve) => setTimeout(resolve, 10));
+}
+
+testSuite({
+  async testFastResponseIsNotHedged() {
+    const {streams, events, hedges} = startCall(/* delay= */ 5);
+    streams[0].send('data', 'a');
+    streams[0].send('status', 0);
+    streams[0].send('end');
+    await waitForHedge();
+
+    assertEquals(1, streams.length);
+    assertElementsEquals(['data a', 'status 0', 'end undefined'], events);
+    assertElementsEquals([], hedges);
+  },
+
+  async testFirstResponseWins() {
+    const {streams, events, hedges} = startCall(/* delay= */ 0);
+    await waitForHedge();
+    assertEquals(2, streams.length);
+
+    streams[1].send('data', 'b');
+    streams[0].send('data', 'a');
+    streams[1].send('end');
+
+    assertElementsEquals(['data b', 'end undefined'], events);
+    assertTrue(streams[0].cancelled);
+    assertFalse(streams[1].cancelled);
+    assertElementsEquals([false, true], hedges);
+  },
+
+  async testFailureWaitsForTheOtherRequest() {
+    const {streams, events, hedges} = startCall(/* delay= */ 0);
+    await waitForHedge();
+
+    streams[0].send('error', 'unavailable');
+    streams[0].send('status', 14);
+    assertElementsEquals([], events);
+
+    streams[1].send('error', 'not found');
+    streams[1].send('status', 5);
+    assertElementsEquals(['error not found', 'status 5'], events);
+    assertElementsEquals([false], hedges);
+  },
+
+  async testFailureBeforeTheHedge() {
+    const {streams, events} = startCall(/* delay= */ 5);
+    streams[0].send('metadata', 'm');
+    streams[0].send('error', 'unavailable');
+    await waitForHedge();
+
+    assertEquals(1, streams.length);
+    assertElementsEquals(['metadata m', 'error unavailable'], events);
+  },
+
+  async testCancel() {
+    const {call, streams, events} = startCall(/* delay= */ 0);
+    await waitForHedge();
+    call.cancel();
+    streams[1].send('data', 'b');
+
+    assertTrue(streams[0].cancelled);
+    assertTrue(streams[1].cancelled);
+    assertElementsEquals([], events);
+  },
+
+  async testCancelBeforeTheHedge() {
+    const {call, streams} = startCall(/* delay= */ 0);
+    call.cancel();
+    await waitForHedge();
+
+    assertEquals(1, streams.length);
+    assertTrue(streams[0].cancelled);
+  },
+});
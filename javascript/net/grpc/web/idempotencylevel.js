@@ -0,0 +1,23 @@
+/**
+ * @fileoverview gRPC-Web method idempotency levels.
+ */
+
+goog.module('grpc.web.IdempotencyLevel');
+
+goog.module.declareLegacyNamespace();
+
+/**
+ * Mirrors the idempotency_level option of a method in its .proto file:
+ * IdempotencyLevel.NO_SIDE_EFFECTS: the method only reads. Such unary calls
+ *     can be sent as cacheable GET requests (see the useHttpGet option).
+ * IdempotencyLevel.IDEMPOTENT: the method may have side effects, but calling
+ *     it several times has the same effect as calling it once.
+ *
+ * @enum {string}
+ */
+const IdempotencyLevel = {
+  'NO_SIDE_EFFECTS': 'no_side_effects',
+  'IDEMPOTENT': 'idempotent',
+};
+
+exports = IdempotencyLevel;
@@ -8,6 +8,7 @@ goog.module('grpc.web.MethodDescriptor');
 goog.module.declareLegacyNamespace();
 
 const CallOptions = goog.require('grpc.web.CallOptions');
+const IdempotencyLevel = goog.requireType('grpc.web.IdempotencyLevel');
 const Metadata = goog.requireType('grpc.web.Metadata');
 const MethodDescriptorInterface = goog.requireType('grpc.web.MethodDescriptorInterface');
 const MethodType = goog.requireType('grpc.web.MethodType');
@@ -31,10 +32,15 @@ const MethodDescriptor = class {
    * @param {function(new: RESPONSE, ...)} responseType
    * @param {function(REQUEST): ?} requestSerializeFn
    * @param {function(?): RESPONSE} responseDeserializeFn
+   * @param {?function(?, RESPONSE): RESPONSE=} responseDeserializeIntoFn
+   *     Deserializes into a response returned by an earlier call, which it
+   *     overwrites and returns. Lets server streams reuse their responses.
+   * @param {?IdempotencyLevel=} idempotencyLevel
    */
   constructor(
       name, methodType, requestType, responseType, requestSerializeFn,
-      responseDeserializeFn) {
+      responseDeserializeFn, responseDeserializeIntoFn = null,
+      idempotencyLevel = null) {
     /** @const */
     this.name = name;
     /** @const */
@@ -47,6 +53,10 @@ const MethodDescriptor = class {
     this.requestSerializeFn = requestSerializeFn;
     /** @const */
     this.responseDeserializeFn = responseDeserializeFn;
+    /** @const */
+    this.responseDeserializeIntoFn = responseDeserializeIntoFn;
+    /** @const */
+    this.idempotencyLevel = idempotencyLevel;
   }
 
   /**
@@ -112,6 +122,16 @@ const MethodDescriptor = class {
   getRequestSerializeFn() {
     return this.requestSerializeFn;
   }
+
+  /** @override */
+  getResponseDeserializeIntoFn() {
+    return this.responseDeserializeIntoFn;
+  }
+
+  /** @override */
+  getIdempotencyLevel() {
+    return this.idempotencyLevel;
+  }
 };
 
 
@@ -8,6 +8,7 @@ goog.module('grpc.web.MethodDescriptorInterface');
 goog.module.declareLegacyNamespace();
 
 const CallOptions = goog.requireType('grpc.web.CallOptions');
+const IdempotencyLevel = goog.requireType('grpc.web.IdempotencyLevel');
 const Metadata = goog.requireType('grpc.web.Metadata');
 const MethodType = goog.requireType('grpc.web.MethodType');
 const Request = goog.requireType('grpc.web.Request');
@@ -57,4 +58,14 @@ MethodDescriptorInterface.prototype.getResponseDeserializeFn = function() {};
 /** @return {function(REQUEST): ?} */
 MethodDescriptorInterface.prototype.getRequestSerializeFn = function() {};
 
+/**
+ * @return {?function(?, RESPONSE): RESPONSE} A deserializer that overwrites
+ *     a previously deserialized response instead of creating one, if any.
+ */
+MethodDescriptorInterface.prototype.getResponseDeserializeIntoFn = function() {
+};
+
+/** @return {?IdempotencyLevel} */
+MethodDescriptorInterface.prototype.getIdempotencyLevel = function() {};
+
 exports = MethodDescriptorInterface;
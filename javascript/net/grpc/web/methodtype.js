@@ -10,6 +10,7 @@ goog.module.declareLegacyNamespace();
  * Available method types:
  * MethodType.UNARY: unary request and unary response.
  * MethodType.SERVER_STREAMING: unary request and streaming responses.
+ * MethodType.CLIENT_STREAMING: streaming requests and unary response.
  * MethodType.BIDI_STREAMING: streaming requests and streaming responses.
  *
  * @enum {string}
@@ -17,7 +18,10 @@ goog.module.declareLegacyNamespace();
 const MethodType = {
   'UNARY': 'unary',
   'SERVER_STREAMING': 'server_streaming',
-  // Bidi streaming is experimental. Do not use.
+  // Client and bidi streaming need fetch() and are experimental. Responses
+  // are only received once all requests are sent, see
+  // GrpcWebClientDuplexStream.
+  'CLIENT_STREAMING': 'client_streaming',
   'BIDI_STREAMING': 'bidi_streaming',
 };
 
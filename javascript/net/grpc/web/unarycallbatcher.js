@@ -0,0 +1,530 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview Sends the unary calls started within a short window in one
+ * HTTP request, for clients created with the batchUrl option.
+ *
+ * Browsers only open about 6 HTTP/1.1 connections per origin, so pages
+ * starting many small calls at once wait for connections. A batch is a POST
+ * request of type application/grpc-web-batch, or
+ * application/grpc-web-batch-text for a base64 body, whose body holds, for
+ * each call, a trailer frame with its ":path" and metadata as HTTP/1 header
+ * lines, followed by a data frame with its request. The response holds, for
+ * each call in the same order, a data frame with its response if it
+ * succeeded, then a trailer frame with its status and metadata.
+ */
+goog.module('grpc.web.UnaryCallBatcher');
+
+goog.module.declareLegacyNamespace();
+
+
+const ClientReadableStream = goog.require('grpc.web.ClientReadableStream');
+const ErrorCode = goog.require('goog.net.ErrorCode');
+const EventType = goog.require('goog.net.EventType');
+const GrpcWebStreamParser = goog.require('grpc.web.GrpcWebStreamParser');
+const HttpCors = goog.require('goog.net.rpc.HttpCors');
+const RpcError = goog.require('grpc.web.RpcError');
+const StatusCode = goog.require('grpc.web.StatusCode');
+const XhrIo = goog.require('goog.net.XhrIo');
+const crypt = goog.require('goog.crypt');
+const events = goog.require('goog.events');
+const googCrypt = goog.require('goog.crypt.base64');
+const googString = goog.require('goog.string');
+const {Status} = goog.require('grpc.web.Status');
+
+
+
+const GRPC_STATUS = 'grpc-status';
+const GRPC_STATUS_MESSAGE = 'grpc-message';
+
+const BATCH_CONTENT_TYPE = 'application/grpc-web-batch';
+const BATCH_TEXT_CONTENT_TYPE = 'application/grpc-web-batch-text';
+
+/**
+ * The most calls sent in one batch. More calls started within the window are
+ * sent in the next batch.
+ * @type {number}
+ */
+const MAX_BATCH_SIZE = 100;
+
+/**
+ * A unary call sent in a batch. The events of the call are only sent once
+ * its trailers are received: 'metadata', 'data', 'error' if it failed,
+ * 'status', then 'end'.
+ * @template RESPONSE
+ * @implements {ClientReadableStream<RESPONSE>}
+ * @final
+ * @unrestricted
+ */
+class BatchedCall {
+  /**
+   * @param {!UnaryCallBatcher} batcher
+   * @param {string} path The method, e.g. /grpc.gateway.testing.EchoService/Echo
+   * @param {!Object<string, string>} metadata The call metadata, with its
+   *     grpc-timeout
+   * @param {!Uint8Array} serialized The serialized request
+   * @param {number} timeout The time in ms after which the call is
+   *     aborted, or 0
+   * @param {function(?):!RESPONSE} responseDeserializeFn
+   */
+  constructor(batcher, path, metadata, serialized, timeout,
+              responseDeserializeFn) {
+    /** @const @private {!UnaryCallBatcher} */
+    this.batcher_ = batcher;
+
+    /** @const {string} */
+    this.path = path;
+
+    /** @const {!Object<string, string>} */
+    this.metadata = metadata;
+
+    /** @const {!Uint8Array} */
+    this.serialized = serialized;
+
+    /** @const {number} */
+    this.timeout = timeout;
+
+    /** @const @private {function(?):!RESPONSE} */
+    this.responseDeserializeFn_ = responseDeserializeFn;
+
+    /** @private {?XhrIo} The request of the batch, once it is sent */
+    this.xhr_ = null;
+
+    /** @private {!Array<!BatchedCall<?>>} The calls of the batch */
+    this.batchCalls_ = [];
+
+    /** @private {!Array<!Uint8Array>} The serialized responses received */
+    this.responses_ = [];
+
+    /** @type {boolean} Whether the call was cancelled */
+    this.cancelled = false;
+
+    /** @type {boolean} Whether the status of the call was sent */
+    this.done = false;
+
+    /** @const @private {!Object<string, !Array<function(?)>>} */
+    this.callbacks_ = {
+      'data': [],
+      'status': [],
+      'metadata': [],
+      'error': [],
+      'end': [],
+    };
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  on(eventType, callback) {
+    if (eventType in this.callbacks_) {
+      this.callbacks_[eventType].push(callback);
+    }
+    return this;
+  }
+
+  /**
+   * @override
+   * @export
+   */
+  removeListener(eventType, callback) {
+    const callbacks = this.callbacks_[eventType] || [];
+    const index = callbacks.indexOf(callback);
+    if (index > -1) {
+      callbacks.splice(index, 1);
+    }
+    return this;
+  }
+
+  /**
+   * Removes the call from its batch if it was not sent yet. Otherwise, its
+   * events are not sent, and the batch is aborted once all its calls are
+   * cancelled.
+   * @override
+   * @export
+   */
+  cancel() {
+    if (this.cancelled || this.done) {
+      return;
+    }
+    this.cancelled = true;
+    if (!this.xhr_) {
+      this.batcher_.removeQueued(this);
+    } else if (this.batchCalls_.every(
+                   (call) => call.cancelled || call.done)) {
+      this.xhr_.abort();
+    }
+  }
+
+  /**
+   * @param {!XhrIo} xhr The request of the batch
+   * @param {!Array<!BatchedCall<?>>} calls The calls of the batch
+   */
+  setBatch(xhr, calls) {
+    this.xhr_ = xhr;
+    this.batchCalls_ = calls;
+  }
+
+  /**
+   * @param {!Uint8Array} data A serialized response
+   */
+  addResponse(data) {
+    this.responses_.push(data);
+  }
+
+  /**
+   * Sends the events of the call, once its trailers or an error of the batch
+   * are received.
+   *
+   * @param {!StatusCode} code
+   * @param {string} message
+   * @param {!Object<string, string>} metadata
+   */
+  finish(code, message, metadata) {
+    if (this.done || this.cancelled) {
+      return;
+    }
+    this.done = true;
+    this.send_('metadata', metadata);
+    let status = {code: code, details: message, metadata: metadata};
+    if (code == StatusCode.OK) {
+      try {
+        const responses =
+            this.responses_.map((data) => this.responseDeserializeFn_(data));
+        responses.forEach((response) => this.send_('data', response));
+      } catch (err) {
+        status = {
+          code: StatusCode.INTERNAL,
+          details: `Error when deserializing response data; error: ${err}`,
+          metadata: metadata,
+        };
+      }
+    }
+    if (status.code != StatusCode.OK) {
+      this.send_(
+          'error', new RpcError(status.code, status.details, status.metadata));
+    }
+    this.send_('status', /** @type {!Status} */ (status));
+    this.send_('end');
+  }
+
+  /**
+   * @private
+   * @param {string} eventType
+   * @param {*=} value
+   */
+  send_(eventType, value = undefined) {
+    this.callbacks_[eventType].slice().forEach((callback) => callback(value));
+  }
+}
+
+
+
+/**
+ * Collects the unary calls started within a window, and sends them in one
+ * batch.
+ * @final
+ * @unrestricted
+ */
+class UnaryCallBatcher {
+  /**
+   * @param {string} url The URL batches are sent to
+   * @param {string} format The wire format, 'text' or 'binary'
+   * @param {boolean} withCredentials
+   * @param {boolean} suppressCorsPreflight Whether to send the request
+   *     headers in the URL
+   * @param {number} windowMs How long after its first call a batch is sent
+   * @param {function():!XhrIo} xhrFactory Returns the XhrIo of a batch
+   */
+  constructor(
+      url, format, withCredentials, suppressCorsPreflight, windowMs,
+      xhrFactory) {
+    /** @const @private {string} */
+    this.url_ = url;
+
+    /** @const @private {boolean} */
+    this.isText_ = format == 'text';
+
+    /** @const @private {boolean} */
+    this.withCredentials_ = withCredentials;
+
+    /** @const @private {boolean} */
+    this.suppressCorsPreflight_ = suppressCorsPreflight;
+
+    /** @const @private {number} */
+    this.windowMs_ = windowMs;
+
+    /** @const @private {function():!XhrIo} */
+    this.xhrFactory_ = xhrFactory;
+
+    /** @private {!Array<!BatchedCall<?>>} The calls not sent yet */
+    this.queue_ = [];
+
+    /** @private {?number} The timer sending the queued calls */
+    this.timer_ = null;
+
+    /** @private {number} */
+    this.batchCount_ = 0;
+  }
+
+  /**
+   * Queues a unary call, sent in a batch once the window of the batch ends.
+   *
+   * @template RESPONSE
+   * @param {string} path The method, e.g. /grpc.gateway.testing.EchoService/Echo
+   * @param {!Object<string, string>} metadata The call metadata, with its
+   *     grpc-timeout
+   * @param {!Uint8Array} serialized The serialized request
+   * @param {number} timeout The time in ms after which the call is
+   *     aborted, or 0
+   * @param {function(?):!RESPONSE} responseDeserializeFn
+   * @return {!ClientReadableStream<RESPONSE>}
+   */
+  add(path, metadata, serialized, timeout, responseDeserializeFn) {
+    const call = new BatchedCall(
+        this, path, metadata, serialized, timeout, responseDeserializeFn);
+    this.queue_.push(call);
+    if (this.queue_.length >= MAX_BATCH_SIZE) {
+      this.flush();
+    } else if (this.timer_ === null) {
+      this.timer_ = setTimeout(() => this.flush(), this.windowMs_);
+    }
+    return call;
+  }
+
+  /**
+   * Returns how many batches were sent.
+   * @return {number}
+   */
+  getBatchCount() {
+    return this.batchCount_;
+  }
+
+  /**
+   * Sends the queued calls now.
+   */
+  flush() {
+    if (this.timer_ !== null) {
+      clearTimeout(this.timer_);
+      this.timer_ = null;
+    }
+    const calls = this.queue_;
+    this.queue_ = [];
+    if (calls.length == 0) {
+      return;
+    }
+    this.batchCount_++;
+
+    const body = [];
+    for (const call of calls) {
+      let lines = ':path: ' + call.path + '\r\n';
+      for (const key in call.metadata) {
+        lines += key + ': ' + call.metadata[key] + '\r\n';
+      }
+      UnaryCallBatcher.appendFrame_(
+          body, GrpcWebStreamParser.FrameType.TRAILER,
+          crypt.stringToUtf8ByteArray(lines));
+      UnaryCallBatcher.appendFrame_(
+          body, GrpcWebStreamParser.FrameType.DATA, call.serialized);
+    }
+
+    const xhr = this.xhrFactory_();
+    xhr.setWithCredentials(this.withCredentials_);
+    const headers = {
+      'Content-Type': this.isText_ ? BATCH_TEXT_CONTENT_TYPE :
+                                     BATCH_CONTENT_TYPE,
+      'X-User-Agent': 'grpc-web-javascript/0.1',
+      'X-Grpc-Web': '1',
+    };
+    if (this.isText_) {
+      headers['Accept'] = BATCH_TEXT_CONTENT_TYPE;
+    } else {
+      xhr.setResponseType(XhrIo.ResponseType.ARRAY_BUFFER);
+    }
+    // The batch is only aborted by the deadline of its last call, if all
+    // its calls have one.
+    if (calls.every((call) => call.timeout > 0)) {
+      xhr.setTimeoutInterval(
+          Math.max(...calls.map((call) => call.timeout)));
+    }
+    calls.forEach((call) => call.setBatch(xhr, calls));
+    this.listen_(xhr, calls);
+
+    let url = this.url_;
+    if (this.suppressCorsPreflight_) {
+      url = /** @type {string} */ (HttpCors.setHttpHeadersWithOverwriteParam(
+          url, HttpCors.HTTP_HEADERS_PARAM_NAME, headers));
+    } else {
+      for (const key in headers) {
+        xhr.headers.set(key, headers[key]);
+      }
+    }
+    const payload = new Uint8Array(body);
+    xhr.send(
+        url, 'POST',
+        this.isText_ ? googCrypt.encodeByteArray(payload) : payload);
+  }
+
+  /**
+   * Removes a cancelled call that was not sent yet.
+   *
+   * @param {!BatchedCall<?>} call
+   */
+  removeQueued(call) {
+    this.queue_.splice(this.queue_.indexOf(call), 1);
+  }
+
+  /**
+   * Dispatches the responses to |calls| as the response of |xhr| arrives.
+   *
+   * @private
+   * @param {!XhrIo} xhr
+   * @param {!Array<!BatchedCall<?>>} calls
+   */
+  listen_(xhr, calls) {
+    const parser = new GrpcWebStreamParser();
+    let pos = 0;
+    let index = 0;
+    let failed = false;
+    /** @type {string} Why the response cannot be read, if it cannot */
+    let unreadable = 'Incomplete response';
+    const fail = (code, message) => {
+      failed = true;
+      calls.slice(index).forEach((call) => call.finish(code, message, {}));
+      index = calls.length;
+    };
+
+    events.listen(xhr, EventType.READY_STATE_CHANGE, () => {
+      if (failed) return;
+      let contentType = xhr.getStreamingResponseHeader('Content-Type');
+      if (!contentType) return;
+      contentType = contentType.toLowerCase();
+
+      let bytes;
+      if (googString.startsWith(contentType, BATCH_TEXT_CONTENT_TYPE)) {
+        const responseText = xhr.getResponseText() || '';
+        const newPos = responseText.length - responseText.length % 4;
+        const newData = responseText.substr(pos, newPos - pos);
+        if (newData.length == 0) return;
+        pos = newPos;
+        bytes = googCrypt.decodeStringToUint8Array(newData);
+      } else if (googString.startsWith(contentType, BATCH_CONTENT_TYPE)) {
+        // Array buffers are only available once complete.
+        const response = xhr.getResponse();
+        if (!response || pos > 0) return;
+        bytes = new Uint8Array(/** @type {!ArrayBuffer} */ (response));
+        pos = bytes.length;
+      } else {
+        // HTTP errors are reported once complete.
+        unreadable = 'Unknown Content-type received.';
+        return;
+      }
+      let messages;
+      try {
+        messages = parser.parse(bytes);
+      } catch (err) {
+        fail(StatusCode.UNKNOWN, 'Error in parsing response body');
+        return;
+      }
+      const FrameType = GrpcWebStreamParser.FrameType;
+      for (const message of messages) {
+        if (index >= calls.length) {
+          break;
+        }
+        if (FrameType.DATA in message) {
+          calls[index].addResponse(message[FrameType.DATA]);
+        }
+        if (FrameType.TRAILER in message) {
+          const trailers = UnaryCallBatcher.parseHttp1Headers_(
+              crypt.utf8ByteArrayToString(message[FrameType.TRAILER]));
+          const code = /** @type {!StatusCode} */ (
+              Number(trailers[GRPC_STATUS] || StatusCode.UNKNOWN));
+          const statusMessage =
+              decodeURIComponent(trailers[GRPC_STATUS_MESSAGE] || '');
+          delete trailers[GRPC_STATUS];
+          delete trailers[GRPC_STATUS_MESSAGE];
+          calls[index++].finish(code, statusMessage, trailers);
+        }
+      }
+    });
+
+    events.listen(xhr, EventType.COMPLETE, () => {
+      const lastErrorCode = xhr.getLastErrorCode();
+      if (lastErrorCode == ErrorCode.NO_ERROR) {
+        fail(StatusCode.UNKNOWN, unreadable);
+        return;
+      }
+      let code;
+      let message = ErrorCode.getDebugMessage(lastErrorCode);
+      switch (lastErrorCode) {
+        case ErrorCode.ABORT:
+          code = StatusCode.ABORTED;
+          break;
+        case ErrorCode.TIMEOUT:
+          code = StatusCode.DEADLINE_EXCEEDED;
+          break;
+        case ErrorCode.HTTP_ERROR:
+          code = StatusCode.fromHttpStatus(xhr.getStatus());
+          message += ', http status code: ' + xhr.getStatus();
+          break;
+        default:
+          code = StatusCode.UNAVAILABLE;
+      }
+      fail(code, message);
+    });
+  }
+
+  /**
+   * @private
+   * @static
+   * @param {!Array<number>} body
+   * @param {number} type The frame type
+   * @param {!Uint8Array|!Array<number>} data
+   */
+  static appendFrame_(body, type, data) {
+    const length = data.length;
+    body.push(
+        type, length >>> 24 & 0xFF, length >>> 16 & 0xFF, length >>> 8 & 0xFF,
+        length & 0xFF);
+    for (let i = 0; i < length; i++) {
+      body.push(data[i]);
+    }
+  }
+
+  /**
+   * @private
+   * @static
+   * @param {string} str The raw http header string
+   * @return {!Object<string, string>} The header:value pairs
+   */
+  static parseHttp1Headers_(str) {
+    const headers = {};
+    for (const line of str.trim().split('\r\n')) {
+      const pos = line.indexOf(':');
+      if (pos > 0) {
+        headers[line.substring(0, pos).trim()] =
+            line.substring(pos + 1).trim();
+      }
+    }
+    return headers;
+  }
+}
+
+
+
+exports = UnaryCallBatcher;
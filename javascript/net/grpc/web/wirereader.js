@@ -0,0 +1,532 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview Reader of the protocol buffer wire format.
+ *
+ * Used by the message decoders that protoc-gen-grpc-web generates with the
+ * plain_codecs option. A generated decoder reads each tag with uint32(),
+ * reads the field value with the method for its type and passes the tags of
+ * unknown fields to skip(), until pos reaches the end of the message.
+ */
+goog.module('grpc.web.WireReader');
+
+goog.module.declareLegacyNamespace();
+
+
+/** @const {number} */
+const TWO_TO_32 = 4294967296;
+
+/** @const {?TextDecoder} */
+const textDecoder =
+    typeof TextDecoder !== 'undefined' ? new TextDecoder('utf-8') : null;
+
+/**
+ * Strings at least this long are decoded with TextDecoder, when available.
+ * @const {number}
+ */
+const TEXT_DECODER_MIN_LENGTH = 64;
+
+/**
+ * @param {number} lo The low 32 bits, unsigned.
+ * @param {number} hi The high 32 bits, unsigned.
+ * @return {number} The signed 64 bit value, which loses precision beyond
+ *     2^53.
+ */
+function joinSigned(lo, hi) {
+  if (hi & 0x80000000) {
+    lo = (~lo + 1) >>> 0;
+    hi = ~hi >>> 0;
+    if (lo === 0) {
+      hi = (hi + 1) >>> 0;
+    }
+    return -(hi * TWO_TO_32 + lo);
+  }
+  return hi * TWO_TO_32 + lo;
+}
+
+/**
+ * @param {number} lo The low 32 bits, unsigned.
+ * @param {number} hi The high 32 bits, unsigned.
+ * @return {string} The unsigned 64 bit value in decimal.
+ */
+function joinUnsignedDecimal(lo, hi) {
+  if (hi <= 0x1FFFFF) {
+    // Exactly representable as a number.
+    return String(hi * TWO_TO_32 + lo);
+  }
+  // Splits the value into 24 bit digits and converts those to base 1e7.
+  const low = lo & 0xFFFFFF;
+  const mid = ((lo >>> 24) | (hi << 8)) & 0xFFFFFF;
+  const high = (hi >> 16) & 0xFFFF;
+  let digitA = low + mid * 6777216 + high * 6710656;
+  let digitB = mid + high * 8147497;
+  let digitC = high * 2;
+  const base = 10000000;
+  if (digitA >= base) {
+    digitB += Math.floor(digitA / base);
+    digitA %= base;
+  }
+  if (digitB >= base) {
+    digitC += Math.floor(digitB / base);
+    digitB %= base;
+  }
+  const pad = (digit, needed) => {
+    const partial = digit ? String(digit) : '';
+    return needed ? '0000000'.slice(partial.length) + partial : partial;
+  };
+  return pad(digitC, false) + pad(digitB, digitC) + pad(digitA, true);
+}
+
+/**
+ * @param {number} lo The low 32 bits, unsigned.
+ * @param {number} hi The high 32 bits, unsigned.
+ * @return {string} The signed 64 bit value in decimal.
+ */
+function joinSignedDecimal(lo, hi) {
+  if (hi & 0x80000000) {
+    lo = (~lo + 1) >>> 0;
+    hi = ~hi >>> 0;
+    if (lo === 0) {
+      hi = (hi + 1) >>> 0;
+    }
+    return '-' + joinUnsignedDecimal(lo, hi);
+  }
+  return joinUnsignedDecimal(lo, hi);
+}
+
+/**
+ * @param {!Uint8Array} bytes
+ * @param {number} start
+ * @param {number} end
+ * @return {string}
+ */
+function decodeUtf8(bytes, start, end) {
+  let result = '';
+  const codeUnits = [];
+  let i = start;
+  while (i < end) {
+    const c = bytes[i++];
+    if (c < 0x80) {
+      codeUnits.push(c);
+    } else if (c < 0xE0) {
+      codeUnits.push(((c & 0x1F) << 6) | (bytes[i++] & 0x3F));
+    } else if (c < 0xF0) {
+      codeUnits.push(
+          ((c & 0x0F) << 12) | ((bytes[i++] & 0x3F) << 6) |
+          (bytes[i++] & 0x3F));
+    } else {
+      const codePoint = (((c & 0x07) << 18) | ((bytes[i++] & 0x3F) << 12) |
+                         ((bytes[i++] & 0x3F) << 6) | (bytes[i++] & 0x3F)) -
+          0x10000;
+      codeUnits.push(
+          0xD800 + (codePoint >> 10), 0xDC00 + (codePoint & 0x3FF));
+    }
+    if (codeUnits.length >= 8192) {
+      result += String.fromCharCode.apply(null, codeUnits);
+      codeUnits.length = 0;
+    }
+  }
+  return result + String.fromCharCode.apply(null, codeUnits);
+}
+
+
+
+/**
+ * Reads protocol buffer wire format values from a byte array.
+ * @final
+ */
+class WireReader {
+  /**
+   * @param {!Uint8Array} bytes The encoded message.
+   */
+  constructor(bytes) {
+    /**
+     * @const
+     * @private {!Uint8Array}
+     */
+    this.bytes_ = bytes;
+
+    /**
+     * The position of the next byte to read.
+     * @export {number}
+     */
+    this.pos = 0;
+
+    /**
+     * The end of the input.
+     * @export @const {number}
+     */
+    this.len = bytes.length;
+
+    /**
+     * View of the input for reading floating point values, created on first
+     * use.
+     * @private {?DataView}
+     */
+    this.view_ = null;
+
+    /**
+     * The low 32 bits of the last 64 bit value read.
+     * @private {number}
+     */
+    this.lo_ = 0;
+
+    /**
+     * The high 32 bits of the last 64 bit value read.
+     * @private {number}
+     */
+    this.hi_ = 0;
+  }
+
+  /**
+   * Moves to |pos|, failing if it is past the end of the input.
+   * @private
+   * @param {number} pos
+   */
+  seek_(pos) {
+    if (pos > this.len) {
+      throw new Error('Truncated message');
+    }
+    this.pos = pos;
+  }
+
+  /**
+   * Reads a varint of up to 64 bits into lo_ and hi_.
+   * @private
+   */
+  readVarint64_() {
+    const bytes = this.bytes_;
+    let pos = this.pos;
+    let lo = 0;
+    let hi = 0;
+    let b = 0x80;
+    for (let shift = 0; shift < 28 && b >= 0x80; shift += 7) {
+      b = bytes[pos++];
+      lo |= (b & 0x7F) << shift;
+    }
+    if (b >= 0x80) {
+      b = bytes[pos++];
+      lo |= (b & 0x0F) << 28;
+      hi = (b & 0x7F) >> 4;
+      for (let shift = 3; shift < 32 && b >= 0x80; shift += 7) {
+        b = bytes[pos++];
+        hi |= (b & 0x7F) << shift;
+      }
+      if (b >= 0x80) {
+        throw new Error('Invalid varint');
+      }
+    }
+    this.seek_(pos);
+    this.lo_ = lo >>> 0;
+    this.hi_ = hi >>> 0;
+  }
+
+  /**
+   * Reads a little endian 64 bit value into lo_ and hi_.
+   * @private
+   */
+  readFixed64_() {
+    this.lo_ = this.fixed32();
+    this.hi_ = this.fixed32();
+  }
+
+  /**
+   * Reads a varint, keeping its low 32 bits. Also reads tags and lengths.
+   * @export
+   * @return {number}
+   */
+  uint32() {
+    const bytes = this.bytes_;
+    let pos = this.pos;
+    let b = bytes[pos++];
+    if (b < 0x80) {
+      this.pos = pos;
+      return b;
+    }
+    let value = b & 0x7F;
+    for (let shift = 7; b >= 0x80 && shift < 70; shift += 7) {
+      b = bytes[pos++];
+      if (shift < 32) {
+        value |= (b & 0x7F) << shift;
+      }
+    }
+    if (b >= 0x80) {
+      throw new Error('Invalid varint');
+    }
+    this.seek_(pos);
+    return value >>> 0;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  int32() {
+    return this.uint32() | 0;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  sint32() {
+    const value = this.uint32();
+    return (value >>> 1) ^ -(value & 1);
+  }
+
+  /**
+   * @export
+   * @return {boolean}
+   */
+  bool() {
+    this.readVarint64_();
+    return this.lo_ !== 0 || this.hi_ !== 0;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  uint64() {
+    this.readVarint64_();
+    return this.hi_ * TWO_TO_32 + this.lo_;
+  }
+
+  /**
+   * @export
+   * @return {string}
+   */
+  uint64String() {
+    this.readVarint64_();
+    return joinUnsignedDecimal(this.lo_, this.hi_);
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  int64() {
+    this.readVarint64_();
+    return joinSigned(this.lo_, this.hi_);
+  }
+
+  /**
+   * @export
+   * @return {string}
+   */
+  int64String() {
+    this.readVarint64_();
+    return joinSignedDecimal(this.lo_, this.hi_);
+  }
+
+  /**
+   * Reads a zigzag encoded varint into lo_ and hi_ as two's complement.
+   * @private
+   */
+  readZigzag64_() {
+    this.readVarint64_();
+    const sign = -(this.lo_ & 1);
+    const lo = ((this.lo_ >>> 1) | (this.hi_ << 31)) ^ sign;
+    const hi = (this.hi_ >>> 1) ^ sign;
+    this.lo_ = lo >>> 0;
+    this.hi_ = hi >>> 0;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  sint64() {
+    this.readZigzag64_();
+    return joinSigned(this.lo_, this.hi_);
+  }
+
+  /**
+   * @export
+   * @return {string}
+   */
+  sint64String() {
+    this.readZigzag64_();
+    return joinSignedDecimal(this.lo_, this.hi_);
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  fixed32() {
+    const bytes = this.bytes_;
+    const pos = this.pos;
+    this.seek_(pos + 4);
+    return (bytes[pos] | (bytes[pos + 1] << 8) | (bytes[pos + 2] << 16) |
+            (bytes[pos + 3] << 24)) >>> 0;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  sfixed32() {
+    return this.fixed32() | 0;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  fixed64() {
+    this.readFixed64_();
+    return this.hi_ * TWO_TO_32 + this.lo_;
+  }
+
+  /**
+   * @export
+   * @return {string}
+   */
+  fixed64String() {
+    this.readFixed64_();
+    return joinUnsignedDecimal(this.lo_, this.hi_);
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  sfixed64() {
+    this.readFixed64_();
+    return joinSigned(this.lo_, this.hi_);
+  }
+
+  /**
+   * @export
+   * @return {string}
+   */
+  sfixed64String() {
+    this.readFixed64_();
+    return joinSignedDecimal(this.lo_, this.hi_);
+  }
+
+  /**
+   * @private
+   * @return {!DataView}
+   */
+  getView_() {
+    if (!this.view_) {
+      this.view_ = new DataView(
+          this.bytes_.buffer, this.bytes_.byteOffset, this.bytes_.byteLength);
+    }
+    return this.view_;
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  float() {
+    const pos = this.pos;
+    this.seek_(pos + 4);
+    return this.getView_().getFloat32(pos, true);
+  }
+
+  /**
+   * @export
+   * @return {number}
+   */
+  double() {
+    const pos = this.pos;
+    this.seek_(pos + 8);
+    return this.getView_().getFloat64(pos, true);
+  }
+
+  /**
+   * @export
+   * @return {string}
+   */
+  string() {
+    const end = this.limit();
+    const start = this.pos;
+    this.pos = end;
+    if (textDecoder && end - start >= TEXT_DECODER_MIN_LENGTH) {
+      return textDecoder.decode(this.bytes_.subarray(start, end));
+    }
+    return decodeUtf8(this.bytes_, start, end);
+  }
+
+  /**
+   * @export
+   * @return {!Uint8Array} A copy of the bytes.
+   */
+  bytes() {
+    const end = this.limit();
+    const value = this.bytes_.slice(this.pos, end);
+    this.pos = end;
+    return value;
+  }
+
+  /**
+   * Reads the length of a length-delimited value.
+   * @export
+   * @return {number} The position where the value ends.
+   */
+  limit() {
+    const end = this.uint32() + this.pos;
+    if (end > this.len) {
+      throw new Error('Truncated message');
+    }
+    return end;
+  }
+
+  /**
+   * Skips the value of an unknown field.
+   * @export
+   * @param {number} tag The tag of the field, as read by uint32().
+   */
+  skip(tag) {
+    if (tag < 8) {
+      throw new Error('Invalid field number 0');
+    }
+    switch (tag & 7) {
+      case 0:
+        this.readVarint64_();
+        break;
+      case 1:
+        this.seek_(this.pos + 8);
+        break;
+      case 2:
+        this.pos = this.limit();
+        break;
+      case 3: {
+        const endTag = (tag & ~7) | 4;
+        for (let nested = this.uint32(); nested !== endTag;
+             nested = this.uint32()) {
+          this.skip(nested);
+        }
+        break;
+      }
+      case 5:
+        this.seek_(this.pos + 4);
+        break;
+      default:
+        throw new Error('Invalid wire type ' + (tag & 7));
+    }
+  }
+}
+
+
+
+exports = WireReader;
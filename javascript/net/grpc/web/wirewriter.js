@@ -0,0 +1,498 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/**
+ * @fileoverview Writer of the protocol buffer wire format.
+ *
+ * Used by the message encoders that protoc-gen-grpc-web generates with the
+ * plain_codecs option. A generated encoder writes each tag with uint32()
+ * followed by the field value. Nested messages and packed fields are written
+ * between fork() and ldelim(), which prefix them with their length.
+ */
+goog.module('grpc.web.WireWriter');
+
+goog.module.declareLegacyNamespace();
+
+
+const googCrypt = goog.require('goog.crypt.base64');
+
+
+/** @const {number} */
+const TWO_TO_32 = 4294967296;
+
+/**
+ * The low 32 bits of the last value split by split().
+ * @type {number}
+ */
+let splitLo = 0;
+
+/**
+ * The high 32 bits of the last value split by split().
+ * @type {number}
+ */
+let splitHi = 0;
+
+/**
+ * Sets splitLo and splitHi to the two's complement of the integer |value|.
+ * @param {number} value
+ */
+function split(value) {
+  const negative = value < 0;
+  if (negative) {
+    value = -value;
+  }
+  let lo = value >>> 0;
+  let hi = Math.floor((value - lo) / TWO_TO_32) >>> 0;
+  if (negative) {
+    lo = (~lo + 1) >>> 0;
+    hi = ~hi >>> 0;
+    if (lo === 0) {
+      hi = (hi + 1) >>> 0;
+    }
+  }
+  splitLo = lo;
+  splitHi = hi;
+}
+
+/**
+ * Sets splitLo and splitHi to the two's complement of the decimal integer
+ * |value|.
+ * @param {string} value
+ */
+function splitDecimal(value) {
+  const negative = value.length > 0 && value[0] === '-';
+  let lo = 0;
+  let hi = 0;
+  // Adds six digits at a time, which keeps lo * 1e6 below 2^53.
+  for (let begin = negative ? 1 : 0; begin < value.length;) {
+    const end = Math.min(begin + 6, value.length);
+    const digits = Number(value.slice(begin, end));
+    if (isNaN(digits)) {
+      throw new Error('Invalid decimal integer: ' + value);
+    }
+    const multiplier = Math.pow(10, end - begin);
+    hi = (hi * multiplier) % TWO_TO_32;
+    lo = lo * multiplier + digits;
+    if (lo >= TWO_TO_32) {
+      hi = (hi + Math.floor(lo / TWO_TO_32)) % TWO_TO_32;
+      lo %= TWO_TO_32;
+    }
+    begin = end;
+  }
+  if (negative) {
+    lo = (~lo + 1) >>> 0;
+    hi = ~hi >>> 0;
+    if (lo === 0) {
+      hi = (hi + 1) >>> 0;
+    }
+  }
+  splitLo = lo >>> 0;
+  splitHi = hi >>> 0;
+}
+
+/**
+ * Applies the zigzag encoding to splitLo and splitHi.
+ */
+function zigzagSplit() {
+  const sign = splitHi >> 31;
+  const hi = ((splitHi << 1) | (splitLo >>> 31)) ^ sign;
+  const lo = (splitLo << 1) ^ sign;
+  splitLo = lo >>> 0;
+  splitHi = hi >>> 0;
+}
+
+/**
+ * @param {number} value
+ * @return {number} The size of |value| as a varint.
+ */
+function varint32Size(value) {
+  if (value < 0x80) return 1;
+  if (value < 0x4000) return 2;
+  if (value < 0x200000) return 3;
+  if (value < 0x10000000) return 4;
+  return 5;
+}
+
+
+
+/**
+ * Writes protocol buffer wire format values into a growing byte array.
+ * @final
+ */
+class WireWriter {
+  constructor() {
+    /** @private {!Uint8Array} */
+    this.buffer_ = new Uint8Array(64);
+
+    /**
+     * The position of the next byte to write.
+     * @private {number}
+     */
+    this.pos_ = 0;
+
+    /**
+     * View of the buffer for writing floating point values, created on first
+     * use.
+     * @private {?DataView}
+     */
+    this.view_ = null;
+  }
+
+  /**
+   * Makes room for |size| more bytes.
+   * @private
+   * @param {number} size
+   */
+  reserve_(size) {
+    const needed = this.pos_ + size;
+    if (needed <= this.buffer_.length) {
+      return;
+    }
+    const buffer = new Uint8Array(Math.max(needed, this.buffer_.length * 2));
+    buffer.set(this.buffer_.subarray(0, this.pos_));
+    this.buffer_ = buffer;
+    this.view_ = null;
+  }
+
+  /**
+   * @private
+   * @return {!DataView}
+   */
+  getView_() {
+    if (!this.view_) {
+      this.view_ = new DataView(this.buffer_.buffer);
+    }
+    return this.view_;
+  }
+
+  /**
+   * @private
+   * @param {number} lo The low 32 bits, unsigned.
+   * @param {number} hi The high 32 bits, unsigned.
+   */
+  writeVarint64_(lo, hi) {
+    this.reserve_(10);
+    const buffer = this.buffer_;
+    let pos = this.pos_;
+    while (hi > 0 || lo > 0x7F) {
+      buffer[pos++] = (lo & 0x7F) | 0x80;
+      lo = ((lo >>> 7) | (hi << 25)) >>> 0;
+      hi >>>= 7;
+    }
+    buffer[pos++] = lo;
+    this.pos_ = pos;
+  }
+
+  /**
+   * @private
+   * @param {number} lo The low 32 bits, unsigned.
+   * @param {number} hi The high 32 bits, unsigned.
+   */
+  writeFixed64_(lo, hi) {
+    this.fixed32(lo);
+    this.fixed32(hi);
+  }
+
+  /**
+   * Writes a varint. Also writes tags and lengths.
+   * @export
+   * @param {number} value
+   */
+  uint32(value) {
+    this.reserve_(5);
+    const buffer = this.buffer_;
+    let pos = this.pos_;
+    value >>>= 0;
+    while (value > 0x7F) {
+      buffer[pos++] = (value & 0x7F) | 0x80;
+      value >>>= 7;
+    }
+    buffer[pos++] = value;
+    this.pos_ = pos;
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  int32(value) {
+    if (value >= 0) {
+      this.uint32(value);
+    } else {
+      // Negative values are sign extended to 64 bits.
+      this.writeVarint64_(value >>> 0, 0xFFFFFFFF);
+    }
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  sint32(value) {
+    this.uint32((value << 1) ^ (value >> 31));
+  }
+
+  /**
+   * @export
+   * @param {boolean} value
+   */
+  bool(value) {
+    this.reserve_(1);
+    this.buffer_[this.pos_++] = value ? 1 : 0;
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  uint64(value) {
+    split(value);
+    this.writeVarint64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {string} value
+   */
+  uint64String(value) {
+    splitDecimal(value);
+    this.writeVarint64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  int64(value) {
+    split(value);
+    this.writeVarint64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {string} value
+   */
+  int64String(value) {
+    splitDecimal(value);
+    this.writeVarint64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  sint64(value) {
+    split(value);
+    zigzagSplit();
+    this.writeVarint64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {string} value
+   */
+  sint64String(value) {
+    splitDecimal(value);
+    zigzagSplit();
+    this.writeVarint64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  fixed32(value) {
+    this.reserve_(4);
+    const buffer = this.buffer_;
+    const pos = this.pos_;
+    buffer[pos] = value;
+    buffer[pos + 1] = value >>> 8;
+    buffer[pos + 2] = value >>> 16;
+    buffer[pos + 3] = value >>> 24;
+    this.pos_ = pos + 4;
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  sfixed32(value) {
+    this.fixed32(value);
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  fixed64(value) {
+    split(value);
+    this.writeFixed64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {string} value
+   */
+  fixed64String(value) {
+    splitDecimal(value);
+    this.writeFixed64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  sfixed64(value) {
+    split(value);
+    this.writeFixed64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {string} value
+   */
+  sfixed64String(value) {
+    splitDecimal(value);
+    this.writeFixed64_(splitLo, splitHi);
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  float(value) {
+    this.reserve_(4);
+    this.getView_().setFloat32(this.pos_, value, true);
+    this.pos_ += 4;
+  }
+
+  /**
+   * @export
+   * @param {number} value
+   */
+  double(value) {
+    this.reserve_(8);
+    this.getView_().setFloat64(this.pos_, value, true);
+    this.pos_ += 8;
+  }
+
+  /**
+   * Writes |value| as length-delimited UTF-8. Unpaired surrogates are
+   * replaced with U+FFFD.
+   * @export
+   * @param {string} value
+   */
+  string(value) {
+    const start = this.fork();
+    this.reserve_(value.length * 3);
+    const buffer = this.buffer_;
+    let pos = this.pos_;
+    for (let i = 0; i < value.length; i++) {
+      let c = value.charCodeAt(i);
+      if (c < 0x80) {
+        buffer[pos++] = c;
+      } else if (c < 0x800) {
+        buffer[pos++] = 0xC0 | (c >> 6);
+        buffer[pos++] = 0x80 | (c & 0x3F);
+      } else {
+        if (c >= 0xD800 && c < 0xE000) {
+          const next = i + 1 < value.length ? value.charCodeAt(i + 1) : 0;
+          if (c < 0xDC00 && next >= 0xDC00 && next < 0xE000) {
+            i++;
+            c = 0x10000 + ((c - 0xD800) << 10) + (next - 0xDC00);
+            buffer[pos++] = 0xF0 | (c >> 18);
+            buffer[pos++] = 0x80 | ((c >> 12) & 0x3F);
+            buffer[pos++] = 0x80 | ((c >> 6) & 0x3F);
+            buffer[pos++] = 0x80 | (c & 0x3F);
+            continue;
+          }
+          c = 0xFFFD;
+        }
+        buffer[pos++] = 0xE0 | (c >> 12);
+        buffer[pos++] = 0x80 | ((c >> 6) & 0x3F);
+        buffer[pos++] = 0x80 | (c & 0x3F);
+      }
+    }
+    this.pos_ = pos;
+    this.ldelim(start);
+  }
+
+  /**
+   * Writes length-delimited bytes.
+   * @export
+   * @param {!Uint8Array|string} value The bytes, or their base64 encoding.
+   */
+  bytes(value) {
+    const bytes = typeof value === 'string' ?
+        googCrypt.decodeStringToUint8Array(value) :
+        value;
+    this.uint32(bytes.length);
+    this.reserve_(bytes.length);
+    this.buffer_.set(bytes, this.pos_);
+    this.pos_ += bytes.length;
+  }
+
+  /**
+   * Starts a length-delimited value, such as a nested message or a packed
+   * field. Its length is written by the matching ldelim().
+   * @export
+   * @return {number} The start of the value, to pass to ldelim().
+   */
+  fork() {
+    // Reserves one byte for the length, which is enough below 128 bytes.
+    this.reserve_(1);
+    return ++this.pos_;
+  }
+
+  /**
+   * Ends the length-delimited value started by fork().
+   * @export
+   * @param {number} start The return value of fork().
+   */
+  ldelim(start) {
+    const length = this.pos_ - start;
+    if (length < 0x80) {
+      this.buffer_[start - 1] = length;
+      return;
+    }
+    const extra = varint32Size(length) - 1;
+    this.reserve_(extra);
+    const buffer = this.buffer_;
+    buffer.copyWithin(start + extra, start, this.pos_);
+    let pos = start - 1;
+    let remaining = length;
+    while (remaining > 0x7F) {
+      buffer[pos++] = (remaining & 0x7F) | 0x80;
+      remaining >>>= 7;
+    }
+    buffer[pos] = remaining;
+    this.pos_ += extra;
+  }
+
+  /**
+   * Returns the bytes written. The writer must not be used afterwards.
+   * @export
+   * @return {!Uint8Array}
+   */
+  finish() {
+    return this.buffer_.subarray(0, this.pos_);
+  }
+}
+
+
+
+exports = WireWriter;
@@ -0,0 +1,121 @@
+goog.module('grpc.web.WireWriterTest');
+goog.setTestOnly('grpc.web.WireWriterTest');
+
+const WireReader = goog.require('grpc.web.WireReader');
+const WireWriter = goog.require('grpc.web.WireWriter');
+const testSuite = goog.require('goog.testing.testSuite');
+
+
+/**
+ * @param {function(!WireWriter)} write
+ * @return {!Array<number>}
+ */
+function encode(write) {
+  const writer = new WireWriter();
+  write(writer);
+  return Array.from(writer.finish());
+}
+
+testSuite({
+  testVarints() {
+    assertArrayEquals([0], encode((writer) => writer.uint32(0)));
+    assertArrayEquals([0xAC, 0x02], encode((writer) => writer.uint32(300)));
+    assertArrayEquals(
+        [0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01],
+        encode((writer) => writer.int32(-1)));
+    assertArrayEquals([0x03], encode((writer) => writer.sint32(-2)));
+    assertArrayEquals(
+        [0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01],
+        encode((writer) => writer.uint64String('18446744073709551615')));
+  },
+
+  testRoundTrip() {
+    const writer = new WireWriter();
+    writer.uint32(4000000000);
+    writer.int32(-7);
+    writer.sint32(-99);
+    writer.bool(true);
+    writer.int64(-1234567890123);
+    writer.uint64String('12345678901234567890');
+    writer.sint64String('-9223372036854775808');
+    writer.fixed32(4294967295);
+    writer.sfixed32(-5);
+    writer.fixed64(9007199254740991);
+    writer.sfixed64String('-42');
+    writer.float(-2.25);
+    writer.double(0.1);
+    writer.string('héllo 😀');
+    writer.bytes(new Uint8Array([0, 1, 255]));
+    writer.bytes('aGk=');
+
+    const reader = new WireReader(writer.finish());
+    assertEquals(4000000000, reader.uint32());
+    assertEquals(-7, reader.int32());
+    assertEquals(-99, reader.sint32());
+    assertTrue(reader.bool());
+    assertEquals(-1234567890123, reader.int64());
+    assertEquals('12345678901234567890', reader.uint64String());
+    assertEquals('-9223372036854775808', reader.sint64String());
+    assertEquals(4294967295, reader.fixed32());
+    assertEquals(-5, reader.sfixed32());
+    assertEquals(9007199254740991, reader.fixed64());
+    assertEquals('-42', reader.sfixed64String());
+    assertEquals(-2.25, reader.float());
+    assertEquals(0.1, reader.double());
+    assertEquals('héllo 😀', reader.string());
+    assertArrayEquals([0, 1, 255], Array.from(reader.bytes()));
+    assertArrayEquals([0x68, 0x69], Array.from(reader.bytes()));
+    assertEquals(reader.len, reader.pos);
+  },
+
+  testUnpairedSurrogate() {
+    assertArrayEquals(
+        [5, 0x61, 0xEF, 0xBF, 0xBD, 0x62],
+        encode((writer) => writer.string('a\ud800b')));
+  },
+
+  testLongDelimitedValue() {
+    const writer = new WireWriter();
+    writer.uint32(10);
+    const start = writer.fork();
+    writer.string('x'.repeat(20000));
+    writer.ldelim(start);
+    writer.uint32(16);
+    writer.uint32(1);
+
+    const reader = new WireReader(writer.finish());
+    assertEquals(10, reader.uint32());
+    const end = reader.limit();
+    assertEquals(20000, reader.string().length);
+    assertEquals(end, reader.pos);
+    assertEquals(16, reader.uint32());
+    assertEquals(1, reader.uint32());
+  },
+
+  testSkip() {
+    const writer = new WireWriter();
+    writer.uint32(8);
+    writer.int64(-1);
+    writer.uint32(17);
+    writer.fixed64(1);
+    writer.uint32(26);
+    writer.string('skipped');
+    writer.uint32(37);
+    writer.fixed32(1);
+    writer.uint32(40);
+    writer.uint32(7);
+
+    const reader = new WireReader(writer.finish());
+    for (let i = 0; i < 4; i++) {
+      reader.skip(reader.uint32());
+    }
+    assertEquals(40, reader.uint32());
+    assertEquals(7, reader.uint32());
+  },
+
+  testTruncated() {
+    const bytes = new Uint8Array(encode((writer) => writer.string('abc')));
+    const reader = new WireReader(bytes.subarray(0, 3));
+    assertThrows(() => reader.string());
+  },
+});
@@ -0,0 +1,226 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/batch_gateway.h"
+
+#include <google/protobuf/descriptor.h>
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+using google::protobuf::DescriptorPool;
+using google::protobuf::MethodDescriptor;
+using grpc::ByteBuffer;
+using grpc::ClientContext;
+using grpc::Slice;
+using grpc::Status;
+using grpc::StatusCode;
+
+namespace {
+
+// The request headers sent by clients with the suppressCorsPreflight option.
+const char kHttpHeadersParam[] = "$httpHeaders";
+
+const char kBatchContentType[] = "application/grpc-web-batch";
+const char kBatchTextContentType[] = "application/grpc-web-batch-text";
+
+// The most calls accepted in a batch, as many as clients send in one, see
+// MAX_BATCH_SIZE in unarycallbatcher.js.
+const size_t kMaxBatchSize = 100;
+
+// A call of a batch.
+struct BatchedCall {
+  std::string path;
+  std::multimap<std::string, std::string> headers;
+  std::string request;
+  ClientContext context;
+  ByteBuffer request_buffer;
+  ByteBuffer response;
+  // Whether the call was forwarded, and has metadata.
+  bool started = false;
+  Status status;
+  std::promise<void> done;
+};
+
+// Reads the gRPC-Web frame at |*pos| in |body|, and moves |*pos| past it.
+// Returns false if there is no complete frame.
+bool ReadFrame(const std::string& body, size_t* pos, uint8_t* flags,
+               std::string* data) {
+  if (body.size() - *pos < 5) {
+    return false;
+  }
+  *flags = static_cast<uint8_t>(body[*pos]);
+  uint32_t size = 0;
+  for (int i = 1; i <= 4; ++i) {
+    size = size << 8 | static_cast<uint8_t>(body[*pos + i]);
+  }
+  if (body.size() - *pos - 5 < size) {
+    return false;
+  }
+  *data = body.substr(*pos + 5, size);
+  *pos += 5 + size;
+  return true;
+}
+
+}  // namespace
+
+BatchGateway::BatchGateway(std::shared_ptr<grpc::Channel> channel)
+    : stub_(channel) {}
+
+void BatchGateway::Serve(int port) {
+  ServeHttp(port, [this](const HttpRequest& request) {
+    return Handle(request);
+  });
+}
+
+std::string BatchGateway::Handle(const HttpRequest& request) {
+  if (request.method == "OPTIONS") {
+    // A CORS preflight, sent for the batch content types.
+    return HttpResponse(
+        "204 No Content",
+        "Access-Control-Allow-Methods: POST, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: *\r\n"
+        "Access-Control-Max-Age: 1728000\r\n",
+        "");
+  }
+  if (request.method != "POST") {
+    return HttpResponse("405 Method Not Allowed", "Allow: POST, OPTIONS\r\n",
+                        "");
+  }
+
+  std::multimap<std::string, std::string> headers = request.headers;
+  size_t question_mark = request.target.find('?');
+  std::string http_headers;
+  if (question_mark != std::string::npos &&
+      GetQueryParam(request.target.substr(question_mark + 1),
+                    kHttpHeadersParam, &http_headers)) {
+    // These replace the headers of the request, e.g. its text/plain type.
+    std::multimap<std::string, std::string> overrides;
+    ParseHeaders(http_headers, &overrides);
+    for (const auto& header : overrides) {
+      headers.erase(header.first);
+    }
+    headers.insert(overrides.begin(), overrides.end());
+  }
+  auto content_type = headers.find("content-type");
+  std::string type =
+      content_type == headers.end() ? "" : content_type->second;
+  bool text = type.compare(0, sizeof(kBatchTextContentType) - 1,
+                           kBatchTextContentType) == 0;
+  if (!text && type.compare(0, sizeof(kBatchContentType) - 1,
+                            kBatchContentType) != 0) {
+    return HttpResponse("415 Unsupported Media Type", "", "");
+  }
+
+  std::string body = request.body;
+  std::string response;
+  if ((text && !Base64Decode(request.body, &body)) ||
+      !CallBatch(body, &response)) {
+    return HttpResponse("400 Bad Request", "", "");
+  }
+  return HttpResponse(
+      "200 OK",
+      std::string("Content-Type: ") +
+          (text ? kBatchTextContentType : kBatchContentType) +
+          "\r\nCache-Control: no-store\r\n",
+      text ? Base64Encode(response) : response);
+}
+
+bool BatchGateway::CallBatch(const std::string& body, std::string* response) {
+  std::vector<std::unique_ptr<BatchedCall>> calls;
+  size_t pos = 0;
+  while (pos < body.size()) {
+    uint8_t header_flags;
+    std::string header_lines;
+    uint8_t data_flags;
+    std::unique_ptr<BatchedCall> call(new BatchedCall());
+    if (calls.size() >= kMaxBatchSize ||
+        !ReadFrame(body, &pos, &header_flags, &header_lines) ||
+        header_flags != 0x80 ||
+        !ReadFrame(body, &pos, &data_flags, &call->request) ||
+        data_flags != 0x00) {
+      return false;
+    }
+    ParseHeaders(header_lines, &call->headers);
+    auto path = call->headers.find(":path");
+    if (path == call->headers.end()) {
+      return false;
+    }
+    call->path = path->second;
+    // Checked before any call is forwarded, so that the whole batch is
+    // rejected.
+    if (!SetCallMetadata(call->headers, &call->context, nullptr)) {
+      return false;
+    }
+    calls.push_back(std::move(call));
+  }
+
+  for (const auto& call : calls) {
+    std::string full_name = call->path.empty() ? "" : call->path.substr(1);
+    std::replace(full_name.begin(), full_name.end(), '/', '.');
+    const MethodDescriptor* method =
+        DescriptorPool::generated_pool()->FindMethodByName(full_name);
+    if (method == nullptr) {
+      call->status =
+          Status(StatusCode::UNIMPLEMENTED, "Unknown method " + call->path);
+    } else if (method->client_streaming() || method->server_streaming()) {
+      call->status = Status(StatusCode::UNIMPLEMENTED,
+                            "Batches only support unary methods");
+    }
+    if (!call->status.ok()) {
+      call->done.set_value();
+      continue;
+    }
+    Slice request_slice(call->request);
+    call->request_buffer = ByteBuffer(&request_slice, 1);
+    call->started = true;
+    BatchedCall* batched_call = call.get();
+    stub_.UnaryCall(&call->context, call->path, grpc::StubOptions(),
+                    &call->request_buffer, &call->response,
+                    [batched_call](Status status) {
+                      batched_call->status = status;
+                      batched_call->done.set_value();
+                    });
+  }
+
+  // The results are written in the order of the calls, once all are done.
+  response->clear();
+  for (const auto& call : calls) {
+    call->done.get_future().wait();
+    std::string trailers =
+        "grpc-status:" + std::to_string(call->status.error_code()) + "\r\n" +
+        "grpc-message:" + PercentEncode(call->status.error_message()) +
+        "\r\n";
+    if (call->started) {
+      AppendMetadata(call->context.GetServerInitialMetadata(), ":",
+                     &trailers, nullptr);
+      AppendMetadata(call->context.GetServerTrailingMetadata(), ":",
+                     &trailers, nullptr);
+    }
+    if (call->status.ok()) {
+      AppendFrame(0x00, ToString(call->response), response);
+    }
+    AppendFrame(0x80, trailers, response);
+  }
+  return true;
+}
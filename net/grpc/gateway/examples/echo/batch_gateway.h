@@ -0,0 +1,60 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_BATCH_GATEWAY_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_BATCH_GATEWAY_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <memory>
+#include <string>
+
+#include "net/grpc/gateway/examples/echo/http_util.h"
+
+// Serves the batches of unary calls sent by clients created with the batchUrl
+// option: POST requests of type application/grpc-web-batch(-text), on any
+// path. For each call, the body holds a header frame with its ":path" and
+// metadata as "name: value" lines, followed by a data frame with its request.
+// The calls are forwarded to |channel| concurrently, and answered in their
+// order in a single response holding, for each call, a data frame with its
+// response if it succeeded, then a trailer frame with its status and
+// metadata.
+//
+// Like HttpGetGateway, this is a minimal HTTP/1.1 server for trying and
+// benchmarking the transport locally.
+class BatchGateway {
+ public:
+  explicit BatchGateway(std::shared_ptr<grpc::Channel> channel);
+
+  // Accepts connections on |port|, each in its own thread. Only returns if
+  // it cannot listen on |port|.
+  void Serve(int port);
+
+ private:
+  // Returns the HTTP response to |request|.
+  std::string Handle(const HttpRequest& request);
+
+  // Makes the calls in the batch |body|, and sets |response| to the body
+  // holding their results. Returns false, without making any call, if |body|
+  // is malformed, holds more than 100 calls, or metadata which is not valid.
+  bool CallBatch(const std::string& body, std::string* response);
+
+  grpc::GenericStub stub_;
+};
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_BATCH_GATEWAY_H_
@@ -0,0 +1,299 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Makes ServerStreamingEcho calls to the echo server with payloads of each
+// kind, through a local TCP relay counting the bytes the server sends, and
+// reports the bytes on the wire and, given the server's pid, the CPU time the
+// server spent per response, e.g. to compare the server with and without
+// --compression:
+//
+//   compression_benchmark --server_pid=$(pidof server)
+//
+// The payloads are JSON records, log lines and random base64, which compress
+// well, fairly and hardly at all. Exits with 1 if a call fails.
+
+#include <arpa/inet.h>
+#include <grpcpp/grpcpp.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+#include "net/grpc/gateway/examples/echo/proc_stats.h"
+
+using grpc::gateway::testing::EchoService;
+using grpc::gateway::testing::ServerStreamingEchoRequest;
+using grpc::gateway::testing::ServerStreamingEchoResponse;
+
+namespace {
+
+// Returns |size| bytes of the payload |kind|: "json", "text" or "random".
+std::string MakePayload(const std::string& kind, size_t size) {
+  static const char kWords[][8] = {"request", "served", "user",  "cache",
+                                   "miss",    "hit",    "items", "latency"};
+  static const char kBase64Chars[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::mt19937 generator(size);
+  std::uniform_int_distribution<int> number(0, 99999);
+  std::string payload = kind == "json" ? "[" : "";
+  while (payload.size() < size) {
+    if (kind == "json") {
+      int id = number(generator);
+      payload += "{\"id\":" + std::to_string(id) + ",\"name\":\"user" +
+                 std::to_string(id) + "\",\"email\":\"user" +
+                 std::to_string(id) + "@example.com\",\"active\":" +
+                 (id % 2 ? "true" : "false") +
+                 ",\"score\":" + std::to_string(number(generator) % 100) +
+                 ",\"tags\":[\"" + kWords[id % 8] + "\",\"" +
+                 kWords[id / 8 % 8] + "\"]},";
+    } else if (kind == "text") {
+      payload += "2018-10-18T12:00:" + std::to_string(number(generator) % 60) +
+                 " INFO " + kWords[number(generator) % 8] + " " +
+                 kWords[number(generator) % 8] + " path=/api/items/" +
+                 std::to_string(number(generator)) +
+                 " latency_ms=" + std::to_string(number(generator) % 500) +
+                 "\n";
+    } else {
+      // Like an image or other already compressed data, base64-encoded since
+      // the message is a string.
+      payload += kBase64Chars[number(generator) % 64];
+    }
+  }
+  payload.resize(size);
+  return payload;
+}
+
+// Forwards the connections accepted on a local port to |server|, counting the
+// bytes received from the server.
+class ByteCountingRelay {
+ public:
+  explicit ByteCountingRelay(const std::string& server) : server_(server) {}
+
+  // Starts listening on a free local port, and returns it, or 0 on failure.
+  int Start() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_size = sizeof(address);
+    if (fd < 0 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&address), address_size) < 0 ||
+        listen(fd, SOMAXCONN) < 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address),
+                    &address_size) < 0) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      return 0;
+    }
+    std::thread([this, fd]() {
+      while (true) {
+        int connection = accept(fd, nullptr, nullptr);
+        if (connection >= 0) {
+          std::thread(&ByteCountingRelay::Relay, this, connection).detach();
+        }
+      }
+    }).detach();
+    return ntohs(address.sin_port);
+  }
+
+  int64_t server_bytes() const { return server_bytes_; }
+
+ private:
+  void Relay(int client) {
+    int server = ConnectToServer();
+    if (server < 0) {
+      close(client);
+      return;
+    }
+    std::thread upstream(&ByteCountingRelay::Copy, this, client, server,
+                         nullptr);
+    Copy(server, client, &server_bytes_);
+    upstream.join();
+    close(client);
+    close(server);
+  }
+
+  // Copies the bytes read from |from| to |to| until |from| is closed, adding
+  // their count to |bytes| unless it is null.
+  void Copy(int from, int to, std::atomic<int64_t>* bytes) {
+    char buffer[64 * 1024];
+    ssize_t size;
+    while ((size = read(from, buffer, sizeof(buffer))) > 0) {
+      if (bytes != nullptr) {
+        *bytes += size;
+      }
+      for (ssize_t written = 0; written < size;) {
+        ssize_t result = write(to, buffer + written, size - written);
+        if (result <= 0) {
+          shutdown(from, SHUT_RD);
+          return;
+        }
+        written += result;
+      }
+    }
+    shutdown(to, SHUT_WR);
+  }
+
+  int ConnectToServer() {
+    size_t colon = server_.rfind(':');
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (colon == std::string::npos ||
+        getaddrinfo(server_.substr(0, colon).c_str(),
+                    server_.substr(colon + 1).c_str(), &hints,
+                    &addresses) != 0) {
+      return -1;
+    }
+    int fd = -1;
+    for (addrinfo* address = addresses; address != nullptr && fd < 0;
+         address = address->ai_next) {
+      fd = socket(address->ai_family, address->ai_socktype,
+                  address->ai_protocol);
+      if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+  }
+
+  const std::string server_;
+  std::atomic<int64_t> server_bytes_{0};
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string server_flag = "--server=";
+  const std::string server_pid_flag = "--server_pid=";
+  const std::string payloads_flag = "--payloads=";
+  const std::string message_size_flag = "--message_size=";
+  const std::string messages_per_call_flag = "--messages_per_call=";
+  const std::string concurrency_flag = "--concurrency=";
+  const std::string seconds_flag = "--seconds=";
+  std::string server = "localhost:9090";
+  int server_pid = 0;
+  std::string payloads = "json,text,random";
+  int message_size = 64000;
+  int messages_per_call = 10;
+  int concurrency = 4;
+  int seconds = 5;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, server_flag.size(), server_flag) == 0) {
+      server = arg.substr(server_flag.size());
+    } else if (arg.compare(0, server_pid_flag.size(), server_pid_flag) == 0) {
+      server_pid = std::stoi(arg.substr(server_pid_flag.size()));
+    } else if (arg.compare(0, payloads_flag.size(), payloads_flag) == 0) {
+      payloads = arg.substr(payloads_flag.size());
+    } else if (arg.compare(0, message_size_flag.size(), message_size_flag) ==
+               0) {
+      message_size = std::stoi(arg.substr(message_size_flag.size()));
+    } else if (arg.compare(0, messages_per_call_flag.size(),
+                           messages_per_call_flag) == 0) {
+      messages_per_call = std::stoi(arg.substr(messages_per_call_flag.size()));
+    } else if (arg.compare(0, concurrency_flag.size(), concurrency_flag) ==
+               0) {
+      concurrency = std::stoi(arg.substr(concurrency_flag.size()));
+    } else if (arg.compare(0, seconds_flag.size(), seconds_flag) == 0) {
+      seconds = std::stoi(arg.substr(seconds_flag.size()));
+    }
+  }
+
+  ByteCountingRelay relay(server);
+  int relay_port = relay.Start();
+  if (relay_port == 0) {
+    std::cerr << "Cannot start the relay" << std::endl;
+    return 1;
+  }
+  std::shared_ptr<grpc::Channel> channel =
+      grpc::CreateChannel("127.0.0.1:" + std::to_string(relay_port),
+                          grpc::InsecureChannelCredentials());
+  std::unique_ptr<EchoService::Stub> stub(EchoService::NewStub(channel));
+  std::istringstream payload_list(payloads);
+  std::string payload;
+  bool failed = false;
+  while (std::getline(payload_list, payload, ',')) {
+    ServerStreamingEchoRequest request;
+    request.set_message(MakePayload(payload, message_size));
+    request.set_message_count(messages_per_call);
+    request.set_message_interval(0);
+    std::atomic<int> message_count(0);
+    std::atomic<int> error_count(0);
+    int64_t bytes_start = relay.server_bytes();
+    double cpu_start = server_pid != 0 ? ProcessCpuSeconds(server_pid) : 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < concurrency; i++) {
+      threads.emplace_back([&]() {
+        while (std::chrono::steady_clock::now() < end) {
+          grpc::ClientContext context;
+          std::unique_ptr<grpc::ClientReader<ServerStreamingEchoResponse>>
+              reader = stub->ServerStreamingEcho(&context, request);
+          ServerStreamingEchoResponse response;
+          while (reader->Read(&response)) {
+            if (response.message() != request.message()) {
+              error_count++;
+            }
+            message_count++;
+          }
+          if (!reader->Finish().ok()) {
+            error_count++;
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double wire_bytes =
+        static_cast<double>(relay.server_bytes() - bytes_start) /
+        message_count;
+    std::cout << payload << ": " << message_count / elapsed.count()
+              << " responses/s, " << wire_bytes << " bytes on the wire per "
+              << message_size << "-byte response ("
+              << 100 * wire_bytes / message_size << "%)";
+    if (server_pid != 0) {
+      std::cout << ", "
+                << (ProcessCpuSeconds(server_pid) - cpu_start) * 1e6 /
+                       message_count
+                << " us of server CPU per response";
+    }
+    std::cout << ", " << error_count << " failed" << std::endl;
+    failed = failed || error_count > 0;
+  }
+  return failed ? 1 : 0;
+}
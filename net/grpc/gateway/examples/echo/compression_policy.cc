@@ -0,0 +1,134 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/compression_policy.h"
+
+#include <sstream>
+
+namespace {
+
+const struct {
+  const char* name;
+  grpc_compression_algorithm algorithm;
+} kAlgorithms[] = {
+    {"identity", GRPC_COMPRESS_NONE},
+    {"deflate", GRPC_COMPRESS_DEFLATE},
+    {"gzip", GRPC_COMPRESS_GZIP},
+};
+
+const struct {
+  const char* name;
+  grpc_compression_level level;
+} kLevels[] = {
+    {"low", GRPC_COMPRESS_LEVEL_LOW},
+    {"medium", GRPC_COMPRESS_LEVEL_MED},
+    {"high", GRPC_COMPRESS_LEVEL_HIGH},
+};
+
+}  // namespace
+
+bool CompressionPolicy::Parse(const std::string& spec, std::string* error) {
+  std::istringstream rule_list(spec);
+  std::string rule_spec;
+  while (std::getline(rule_list, rule_spec, ',')) {
+    size_t equals = rule_spec.find('=');
+    if (equals == std::string::npos || equals == 0) {
+      *error = "Expected METHOD=COMPRESSION[:MIN_BYTES]: " + rule_spec;
+      return false;
+    }
+    size_t colon = rule_spec.find(':', equals);
+    std::string compression = rule_spec.substr(
+        equals + 1,
+        colon == std::string::npos ? std::string::npos : colon - equals - 1);
+    Rule rule;
+    bool found = false;
+    for (const auto& algorithm : kAlgorithms) {
+      if (compression == algorithm.name) {
+        rule.algorithm = algorithm.algorithm;
+        found = true;
+      }
+    }
+    for (const auto& level : kLevels) {
+      if (compression == level.name) {
+        rule.level_set = true;
+        rule.level = level.level;
+        found = true;
+      }
+    }
+    if (!found) {
+      *error = "Unknown compression: " + compression;
+      return false;
+    }
+    if (colon != std::string::npos) {
+      std::string min_bytes = rule_spec.substr(colon + 1);
+      if (min_bytes.empty() ||
+          min_bytes.find_first_not_of("0123456789") != std::string::npos) {
+        *error = "Invalid MIN_BYTES: " + rule_spec;
+        return false;
+      }
+      rule.min_message_size = std::stoul(min_bytes);
+    }
+    rules_[rule_spec.substr(0, equals)] = rule;
+  }
+  return true;
+}
+
+void CompressionPolicy::SetCallCompression(
+    const char* method, grpc::ServerContextBase* context) const {
+  const Rule* rule = FindRule(method);
+  if (rule != nullptr) {
+    SetCompression(*rule, context);
+  }
+}
+
+void CompressionPolicy::SetResponseCompression(
+    const char* method, size_t message_size,
+    grpc::ServerContextBase* context) const {
+  const Rule* rule = FindRule(method);
+  if (rule != nullptr && message_size >= rule->min_message_size) {
+    SetCompression(*rule, context);
+  }
+}
+
+grpc::WriteOptions CompressionPolicy::GetWriteOptions(
+    const char* method, size_t message_size) const {
+  grpc::WriteOptions options;
+  const Rule* rule = FindRule(method);
+  if (rule != nullptr && message_size < rule->min_message_size) {
+    options.set_no_compression();
+  }
+  return options;
+}
+
+const CompressionPolicy::Rule* CompressionPolicy::FindRule(
+    const char* method) const {
+  auto rule = rules_.find(method);
+  if (rule == rules_.end()) {
+    rule = rules_.find("*");
+  }
+  return rule != rules_.end() ? &rule->second : nullptr;
+}
+
+void CompressionPolicy::SetCompression(const Rule& rule,
+                                       grpc::ServerContextBase* context) {
+  if (rule.level_set) {
+    context->set_compression_level(rule.level);
+  } else {
+    context->set_compression_algorithm(rule.algorithm);
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_COMPRESSION_POLICY_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_COMPRESSION_POLICY_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <grpc/compression.h>
+#include <grpcpp/grpcpp.h>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+
+// Decides, per method, which responses of the echo service are compressed and
+// how. Responses smaller than the minimum size of their method's rule are sent
+// uncompressed, since compressing them costs more CPU than the bytes it saves.
+//
+// A rule either names an algorithm, which is used whatever the client accepts,
+// or a level, with which gRPC picks an algorithm from those the client lists
+// in grpc-accept-encoding, and sends the responses uncompressed to clients
+// which cannot decompress them, e.g. gRPC-Web clients.
+//
+// Not changed once the server starts, so it can be shared by all the calls.
+class CompressionPolicy {
+ public:
+  // Adds the rules in |spec|, a comma-separated list of
+  // METHOD=COMPRESSION[:MIN_BYTES], e.g. "ServerStreamingEcho=medium:1024".
+  // METHOD is the method name, or * for the methods without a rule of their
+  // own, COMPRESSION is identity, deflate or gzip, or the level low, medium
+  // or high, and MIN_BYTES defaults to 0. Returns false with |error| set if
+  // |spec| is invalid.
+  bool Parse(const std::string& spec, std::string* error);
+
+  // Sets the compression of the call of |method| with |context|, whose
+  // responses are then compressed unless written with the options returned
+  // by GetWriteOptions(). Must be called before its first response is sent.
+  void SetCallCompression(const char* method,
+                          grpc::ServerContextBase* context) const;
+
+  // Like SetCallCompression(), for a call of |method| whose only response
+  // has |message_size| bytes, and which is left uncompressed if too small.
+  void SetResponseCompression(const char* method, size_t message_size,
+                              grpc::ServerContextBase* context) const;
+
+  // Returns the options with which to write a response of |message_size|
+  // bytes to a stream of |method|, which turn off its compression if it is
+  // too small.
+  grpc::WriteOptions GetWriteOptions(const char* method,
+                                     size_t message_size) const;
+
+ private:
+  struct Rule {
+    // Used unless |level_set|.
+    grpc_compression_algorithm algorithm = GRPC_COMPRESS_NONE;
+    bool level_set = false;
+    grpc_compression_level level = GRPC_COMPRESS_LEVEL_NONE;
+    size_t min_message_size = 0;
+  };
+
+  // Returns the rule of |method|, or null if it has none.
+  const Rule* FindRule(const char* method) const;
+  static void SetCompression(const Rule& rule,
+                             grpc::ServerContextBase* context);
+
+  // std::less<> so that rules are found by the method names of the handlers
+  // without copying them into strings.
+  std::map<std::string, Rule, std::less<>> rules_;
+};
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_COMPRESSION_POLICY_H_
@@ -0,0 +1,460 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/echo_async_service.h"
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+#include "net/grpc/gateway/examples/echo/echo_service_impl.h"
+
+using grpc::Alarm;
+using grpc::CompletionQueue;
+using grpc::ServerAsyncReader;
+using grpc::ServerAsyncReaderWriter;
+using grpc::ServerAsyncResponseWriter;
+using grpc::ServerAsyncWriter;
+using grpc::ServerCompletionQueue;
+using grpc::ServerContext;
+using grpc::Status;
+using grpc::gateway::testing::ClientStreamingEchoRequest;
+using grpc::gateway::testing::ClientStreamingEchoResponse;
+using grpc::gateway::testing::EchoRequest;
+using grpc::gateway::testing::EchoResponse;
+using grpc::gateway::testing::EchoService;
+using grpc::gateway::testing::Empty;
+using grpc::gateway::testing::ServerStreamingEchoRequest;
+using grpc::gateway::testing::ServerStreamingEchoResponse;
+
+namespace {
+
+// What the calls accepted on a completion queue share.
+struct Queue {
+  EchoService::AsyncService* service;
+  ServerCompletionQueue* cq;
+  int slow_call_percent;
+  int slow_call_delay_ms;
+};
+
+std::chrono::system_clock::time_point InMilliseconds(int ms) {
+  return std::chrono::system_clock::now() + std::chrono::milliseconds(ms);
+}
+
+// A call, and the tag of the operations it starts on its completion queue.
+class Call {
+ public:
+  virtual ~Call() {}
+
+  // Advances the call once its pending operation completes, |ok| telling
+  // whether it succeeded. Deletes the call once it is over.
+  virtual void Proceed(bool ok) = 0;
+};
+
+// A call of Echo, EchoAbort or NoOp.
+template <typename Request, typename Response>
+class UnaryCall final : public Call {
+ public:
+  using RequestMethod = void (EchoService::AsyncService::*)(
+      ServerContext*, Request*, ServerAsyncResponseWriter<Response>*,
+      CompletionQueue*, ServerCompletionQueue*, void*);
+  using Handler = Status (*)(const Request&, Response*);
+
+  // Waits for a request of |request_method|, to be answered by |handler|,
+  // possibly delayed like a slow call if |may_be_slow|.
+  UnaryCall(const Queue* queue, RequestMethod request_method, Handler handler,
+            bool may_be_slow)
+      : queue_(queue),
+        request_method_(request_method),
+        handler_(handler),
+        may_be_slow_(may_be_slow),
+        responder_(&context_) {
+    (queue_->service->*request_method_)(&context_, &request_, &responder_,
+                                        queue_->cq, queue_->cq, this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequested:
+        if (!ok) {
+          delete this;
+          return;
+        }
+        new UnaryCall(queue_, request_method_, handler_, may_be_slow_);
+        EchoServiceImpl::CopyClientMetadataToResponse(&context_);
+        status_ = handler_(request_, &response_);
+        if (may_be_slow_ &&
+            EchoServiceImpl::IsSlowCall(queue_->slow_call_percent)) {
+          state_ = State::kDelayed;
+          alarm_.Set(queue_->cq, InMilliseconds(queue_->slow_call_delay_ms),
+                     this);
+          return;
+        }
+        Finish();
+        return;
+      case State::kDelayed:
+        Finish();
+        return;
+      case State::kFinished:
+        delete this;
+        return;
+    }
+  }
+
+ private:
+  enum class State { kRequested, kDelayed, kFinished };
+
+  void Finish() {
+    state_ = State::kFinished;
+    if (status_.ok()) {
+      responder_.Finish(response_, status_, this);
+    } else {
+      responder_.FinishWithError(status_, this);
+    }
+  }
+
+  const Queue* const queue_;
+  const RequestMethod request_method_;
+  const Handler handler_;
+  const bool may_be_slow_;
+  ServerContext context_;
+  Request request_;
+  Response response_;
+  ServerAsyncResponseWriter<Response> responder_;
+  Alarm alarm_;
+  Status status_;
+  State state_ = State::kRequested;
+};
+
+Status HandleEcho(const EchoRequest& request, EchoResponse* response) {
+  response->set_message(request.message());
+  return Status::OK;
+}
+
+Status HandleEchoAbort(const EchoRequest& request, EchoResponse* response) {
+  response->set_message(request.message());
+  return Status(grpc::StatusCode::ABORTED, "Aborted from server side.");
+}
+
+Status HandleNoOp(const Empty& request, Empty* response) {
+  return Status::OK;
+}
+
+// A call of ServerStreamingEcho, or ServerStreamingEchoAbort if |abort|.
+class ServerStreamingCall final : public Call {
+ public:
+  ServerStreamingCall(const Queue* queue, bool abort)
+      : queue_(queue), abort_(abort), writer_(&context_) {
+    auto request_method =
+        abort_ ? &EchoService::AsyncService::RequestServerStreamingEchoAbort
+               : &EchoService::AsyncService::RequestServerStreamingEcho;
+    (queue_->service->*request_method)(&context_, &request_, &writer_,
+                                       queue_->cq, queue_->cq, this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequested:
+        if (!ok) {
+          delete this;
+          return;
+        }
+        new ServerStreamingCall(queue_, abort_);
+        EchoServiceImpl::CopyClientMetadataToResponse(&context_);
+        response_.set_message(request_.message());
+        if (abort_) {
+          state_ = State::kAborting;
+          writer_.Write(response_, this);
+          return;
+        }
+        WaitForNextMessage();
+        return;
+      case State::kWaiting:
+        state_ = State::kWriting;
+        writer_.Write(response_, this);
+        return;
+      case State::kWriting:
+        if (!ok) {
+          Finish(Status::CANCELLED);
+          return;
+        }
+        message_count_++;
+        WaitForNextMessage();
+        return;
+      case State::kAborting:
+        Finish(Status(grpc::StatusCode::ABORTED, "Aborted from server side."));
+        return;
+      case State::kFinished:
+        delete this;
+        return;
+    }
+  }
+
+ private:
+  enum class State { kRequested, kWaiting, kWriting, kAborting, kFinished };
+
+  // Writes the next message after the requested interval, or finishes the
+  // call once they are all written.
+  void WaitForNextMessage() {
+    if (message_count_ >= request_.message_count()) {
+      Finish(Status::OK);
+      return;
+    }
+    state_ = State::kWaiting;
+    alarm_.Set(queue_->cq, InMilliseconds(request_.message_interval()), this);
+  }
+
+  void Finish(const Status& status) {
+    state_ = State::kFinished;
+    writer_.Finish(status, this);
+  }
+
+  const Queue* const queue_;
+  const bool abort_;
+  ServerContext context_;
+  ServerStreamingEchoRequest request_;
+  ServerStreamingEchoResponse response_;
+  ServerAsyncWriter<ServerStreamingEchoResponse> writer_;
+  Alarm alarm_;
+  int message_count_ = 0;
+  State state_ = State::kRequested;
+};
+
+// A call of ClientStreamingEcho.
+class ClientStreamingCall final : public Call {
+ public:
+  explicit ClientStreamingCall(const Queue* queue)
+      : queue_(queue), reader_(&context_) {
+    queue_->service->RequestClientStreamingEcho(&context_, &reader_,
+                                                queue_->cq, queue_->cq, this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequested:
+        if (!ok) {
+          delete this;
+          return;
+        }
+        new ClientStreamingCall(queue_);
+        EchoServiceImpl::CopyClientMetadataToResponse(&context_);
+        state_ = State::kReading;
+        reader_.Read(&request_, this);
+        return;
+      case State::kReading:
+        // An empty message ends the stream early, see echo.proto.
+        if (ok && !request_.message().empty()) {
+          response_.set_message_count(response_.message_count() + 1);
+          reader_.Read(&request_, this);
+          return;
+        }
+        state_ = State::kFinished;
+        reader_.Finish(response_, Status::OK, this);
+        return;
+      case State::kFinished:
+        delete this;
+        return;
+    }
+  }
+
+ private:
+  enum class State { kRequested, kReading, kFinished };
+
+  const Queue* const queue_;
+  ServerContext context_;
+  ClientStreamingEchoRequest request_;
+  ClientStreamingEchoResponse response_;
+  ServerAsyncReader<ClientStreamingEchoResponse, ClientStreamingEchoRequest>
+      reader_;
+  State state_ = State::kRequested;
+};
+
+// A call of FullDuplexEcho, which answers each request as it is read, or
+// HalfDuplexEcho if |half_duplex|, which answers them once they are all read.
+class DuplexCall final : public Call {
+ public:
+  DuplexCall(const Queue* queue, bool half_duplex)
+      : queue_(queue), half_duplex_(half_duplex), stream_(&context_) {
+    auto request_method =
+        half_duplex_ ? &EchoService::AsyncService::RequestHalfDuplexEcho
+                     : &EchoService::AsyncService::RequestFullDuplexEcho;
+    (queue_->service->*request_method)(&context_, &stream_, queue_->cq,
+                                       queue_->cq, this);
+  }
+
+  void Proceed(bool ok) override {
+    switch (state_) {
+      case State::kRequested:
+        if (!ok) {
+          delete this;
+          return;
+        }
+        new DuplexCall(queue_, half_duplex_);
+        EchoServiceImpl::CopyClientMetadataToResponse(&context_);
+        Read();
+        return;
+      case State::kReading:
+        if (!ok) {
+          // The client is done sending.
+          if (half_duplex_) {
+            WriteNext();
+          } else {
+            Finish(Status::OK);
+          }
+          return;
+        }
+        if (half_duplex_) {
+          requests_.push_back(request_);
+          Read();
+        } else {
+          Write(request_);
+        }
+        return;
+      case State::kWriting:
+        if (!ok) {
+          Finish(Status::CANCELLED);
+          return;
+        }
+        if (half_duplex_) {
+          WriteNext();
+        } else {
+          Read();
+        }
+        return;
+      case State::kFinished:
+        delete this;
+        return;
+    }
+  }
+
+ private:
+  enum class State { kRequested, kReading, kWriting, kFinished };
+
+  void Read() {
+    state_ = State::kReading;
+    stream_.Read(&request_, this);
+  }
+
+  // Writes the next buffered request, or finishes the call if there is none
+  // left.
+  void WriteNext() {
+    if (message_count_ >= static_cast<int>(requests_.size())) {
+      Finish(Status::OK);
+      return;
+    }
+    Write(requests_[message_count_]);
+  }
+
+  void Write(const EchoRequest& request) {
+    EchoResponse response;
+    response.set_message(request.message());
+    response.set_message_count(++message_count_);
+    state_ = State::kWriting;
+    stream_.Write(response, this);
+  }
+
+  void Finish(const Status& status) {
+    state_ = State::kFinished;
+    stream_.Finish(status, this);
+  }
+
+  const Queue* const queue_;
+  const bool half_duplex_;
+  ServerContext context_;
+  ServerAsyncReaderWriter<EchoResponse, EchoRequest> stream_;
+  EchoRequest request_;
+  // The requests of HalfDuplexEcho, answered once they are all read.
+  std::vector<EchoRequest> requests_;
+  int message_count_ = 0;
+  State state_ = State::kRequested;
+};
+
+}  // namespace
+
+AsyncEchoService::AsyncEchoService(int slow_call_percent,
+                                   int slow_call_delay_ms)
+    : slow_call_percent_(slow_call_percent),
+      slow_call_delay_ms_(slow_call_delay_ms) {}
+
+AsyncEchoService::~AsyncEchoService() { Shutdown(); }
+
+void AsyncEchoService::Register(grpc::ServerBuilder* builder, int cq_count) {
+  builder->RegisterService(&service_);
+  for (int i = 0; i < cq_count; i++) {
+    cqs_.push_back(builder->AddCompletionQueue());
+  }
+}
+
+void AsyncEchoService::Start() {
+  int core_count = std::thread::hardware_concurrency();
+  for (size_t i = 0; i < cqs_.size(); i++) {
+    threads_.emplace_back(&AsyncEchoService::Poll, this, cqs_[i].get(),
+                          core_count > 0 ? i % core_count : -1);
+  }
+}
+
+void AsyncEchoService::Shutdown() {
+  for (auto& cq : cqs_) {
+    cq->Shutdown();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  cqs_.clear();
+}
+
+void AsyncEchoService::Poll(ServerCompletionQueue* cq, int core) {
+#ifdef __linux__
+  if (core >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+#endif
+  const Queue queue = {&service_, cq, slow_call_percent_,
+                       slow_call_delay_ms_};
+  new UnaryCall<EchoRequest, EchoResponse>(
+      &queue, &EchoService::AsyncService::RequestEcho, HandleEcho,
+      /* may_be_slow= */ true);
+  new UnaryCall<EchoRequest, EchoResponse>(
+      &queue, &EchoService::AsyncService::RequestEchoAbort, HandleEchoAbort,
+      /* may_be_slow= */ false);
+  new UnaryCall<Empty, Empty>(&queue, &EchoService::AsyncService::RequestNoOp,
+                              HandleNoOp, /* may_be_slow= */ false);
+  new ServerStreamingCall(&queue, /* abort= */ false);
+  new ServerStreamingCall(&queue, /* abort= */ true);
+  new ClientStreamingCall(&queue);
+  new DuplexCall(&queue, /* half_duplex= */ false);
+  new DuplexCall(&queue, /* half_duplex= */ true);
+
+  void* tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) {
+    static_cast<Call*>(tag)->Proceed(ok);
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_ASYNC_SERVICE_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_ASYNC_SERVICE_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <grpcpp/grpcpp.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+
+// Serves the echo service like EchoServiceImpl, with the async API instead of
+// blocking a thread for each call.
+//
+// Each completion queue is polled by its own thread, pinned to a core on
+// Linux. Every method has a state machine object per call, which is advanced
+// by the polling thread as the operations it starts complete, and each queue
+// always has a call of every method waiting for a request, so that a call
+// stays on the queue, and core, that accepted it.
+class AsyncEchoService {
+ public:
+  // |slow_call_percent| and |slow_call_delay_ms| are as in EchoServiceImpl,
+  // but the delays do not hold a thread.
+  AsyncEchoService(int slow_call_percent, int slow_call_delay_ms);
+  ~AsyncEchoService();
+
+  // Registers the service on |builder|, with |cq_count| completion queues.
+  void Register(grpc::ServerBuilder* builder, int cq_count);
+
+  // Starts polling the completion queues, once the server is started.
+  void Start();
+
+  // Stops polling the completion queues, once the server is shut down.
+  void Shutdown();
+
+ private:
+  // Accepts calls on |cq|, and advances them, until it is shut down.
+  void Poll(grpc::ServerCompletionQueue* cq, int core);
+
+  grpc::gateway::testing::EchoService::AsyncService service_;
+  const int slow_call_percent_;
+  const int slow_call_delay_ms_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+  std::vector<std::thread> threads_;
+};
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_ASYNC_SERVICE_H_
@@ -0,0 +1,274 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/echo_generic_service.h"
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "net/grpc/gateway/examples/echo/echo.pb.h"
+#include "net/grpc/gateway/examples/echo/echo_service_impl.h"
+#include "net/grpc/gateway/examples/echo/paced_write_reactor.h"
+
+using grpc::Alarm;
+using grpc::ByteBuffer;
+using grpc::GenericCallbackServerContext;
+using grpc::SerializationTraits;
+using grpc::ServerGenericBidiReactor;
+using grpc::Slice;
+using grpc::Status;
+using grpc::gateway::testing::ClientStreamingEchoResponse;
+using grpc::gateway::testing::ServerStreamingEchoRequest;
+using grpc::gateway::testing::ServerStreamingEchoResponse;
+
+namespace {
+
+const char kEchoServicePath[] = "/grpc.gateway.testing.EchoService/";
+
+// Returns |request|, a serialized EchoRequest, as a serialized EchoResponse
+// with |message_count|. Its slices are shared with |request|.
+ByteBuffer WithMessageCount(const ByteBuffer& request, int message_count) {
+  std::vector<Slice> slices;
+  request.Dump(&slices);
+  // The key of field 2, of wire type varint, then the varint.
+  uint8_t field[11] = {0x10};
+  size_t size = 1;
+  uint64_t value = static_cast<uint64_t>(static_cast<int64_t>(message_count));
+  while (value >= 0x80) {
+    field[size++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  field[size++] = static_cast<uint8_t>(value);
+  slices.emplace_back(field, size);
+  return ByteBuffer(slices.data(), slices.size());
+}
+
+// A call of Echo or NoOp, answered with its request after |delay_ms|, or of
+// EchoAbort if |status| is an error.
+class UnaryReactor final : public ServerGenericBidiReactor {
+ public:
+  UnaryReactor(const Status& status, int delay_ms)
+      : status_(status), delay_ms_(delay_ms) {
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      Finish(Status(grpc::StatusCode::INTERNAL, "Missing request message"));
+      return;
+    }
+    if (delay_ms_ > 0) {
+      alarm_.Set(std::chrono::system_clock::now() +
+                     std::chrono::milliseconds(delay_ms_),
+                 [this](bool ok) { Respond(); });
+      return;
+    }
+    Respond();
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  void Respond() {
+    if (status_.ok()) {
+      StartWriteAndFinish(&request_, grpc::WriteOptions(), status_);
+    } else {
+      Finish(status_);
+    }
+  }
+
+  const Status status_;
+  const int delay_ms_;
+  ByteBuffer request_;
+  Alarm alarm_;
+};
+
+// A call of ServerStreamingEcho, or ServerStreamingEchoAbort if |abort|.
+class ServerStreamingReactor final
+    : public PacedWriteReactor<ServerGenericBidiReactor, ByteBuffer> {
+ public:
+  explicit ServerStreamingReactor(bool abort) : abort_(abort) {
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    ServerStreamingEchoRequest request;
+    if (!ok ||
+        !SerializationTraits<ServerStreamingEchoRequest>::Deserialize(
+             &request_, &request)
+             .ok()) {
+      Finish(Status(grpc::StatusCode::INTERNAL, "Invalid request message"));
+      return;
+    }
+    ServerStreamingEchoResponse response;
+    response.set_message(request.message());
+    ByteBuffer serialized_response;
+    bool own_buffer;
+    SerializationTraits<ServerStreamingEchoResponse>::Serialize(
+        response, &serialized_response, &own_buffer);
+    if (abort_) {
+      abort_response_ = serialized_response;
+      StartWriteAndFinish(
+          &abort_response_, grpc::WriteOptions(),
+          Status(grpc::StatusCode::ABORTED, "Aborted from server side."));
+      return;
+    }
+    StartWrites(serialized_response, request.message_count(),
+                request.message_interval());
+  }
+
+ private:
+  const bool abort_;
+  ByteBuffer request_;
+  ByteBuffer abort_response_;
+};
+
+// A call of ClientStreamingEcho.
+class ClientStreamingReactor final : public ServerGenericBidiReactor {
+ public:
+  ClientStreamingReactor() { StartRead(&request_); }
+
+  void OnReadDone(bool ok) override {
+    // An empty message ends the stream early, see echo.proto. Its only field
+    // is then not serialized.
+    if (ok && request_.Length() > 0) {
+      message_count_++;
+      StartRead(&request_);
+      return;
+    }
+    ClientStreamingEchoResponse response;
+    response.set_message_count(message_count_);
+    bool own_buffer;
+    SerializationTraits<ClientStreamingEchoResponse>::Serialize(
+        response, &response_, &own_buffer);
+    StartWriteAndFinish(&response_, grpc::WriteOptions(), Status::OK);
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  ByteBuffer request_;
+  ByteBuffer response_;
+  int message_count_ = 0;
+};
+
+// A call of FullDuplexEcho, which answers each request as it is read, or
+// HalfDuplexEcho if |half_duplex|, which answers them once they are all read.
+class DuplexReactor final : public ServerGenericBidiReactor {
+ public:
+  explicit DuplexReactor(bool half_duplex) : half_duplex_(half_duplex) {
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      // The client is done sending.
+      if (half_duplex_) {
+        WriteNext();
+      } else {
+        Finish(Status::OK);
+      }
+      return;
+    }
+    if (half_duplex_) {
+      requests_.push_back(request_);
+      StartRead(&request_);
+    } else {
+      Write(request_);
+    }
+  }
+
+  void OnWriteDone(bool ok) override {
+    if (!ok) {
+      Finish(Status::CANCELLED);
+    } else if (half_duplex_) {
+      WriteNext();
+    } else {
+      StartRead(&request_);
+    }
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  // Writes the next buffered request, or finishes the call if there is none
+  // left.
+  void WriteNext() {
+    if (message_count_ >= static_cast<int>(requests_.size())) {
+      Finish(Status::OK);
+      return;
+    }
+    Write(requests_[message_count_]);
+  }
+
+  void Write(const ByteBuffer& request) {
+    response_ = WithMessageCount(request, ++message_count_);
+    StartWrite(&response_);
+  }
+
+  const bool half_duplex_;
+  ByteBuffer request_;
+  ByteBuffer response_;
+  // The requests of HalfDuplexEcho, answered once they are all read.
+  std::vector<ByteBuffer> requests_;
+  int message_count_ = 0;
+};
+
+}  // namespace
+
+GenericEchoService::GenericEchoService(int slow_call_percent,
+                                       int slow_call_delay_ms)
+    : slow_call_percent_(slow_call_percent),
+      slow_call_delay_ms_(slow_call_delay_ms) {}
+
+ServerGenericBidiReactor* GenericEchoService::CreateReactor(
+    GenericCallbackServerContext* context) {
+  const std::string& path = context->method();
+  if (path.compare(0, sizeof(kEchoServicePath) - 1, kEchoServicePath) != 0) {
+    return CallbackGenericService::CreateReactor(context);
+  }
+  std::string method = path.substr(sizeof(kEchoServicePath) - 1);
+  EchoServiceImpl::CopyClientMetadataToResponse(context);
+  if (method == "Echo") {
+    return new UnaryReactor(Status::OK,
+                            EchoServiceImpl::IsSlowCall(slow_call_percent_)
+                                ? slow_call_delay_ms_
+                                : 0);
+  } else if (method == "EchoAbort") {
+    return new UnaryReactor(
+        Status(grpc::StatusCode::ABORTED, "Aborted from server side."), 0);
+  } else if (method == "NoOp") {
+    return new UnaryReactor(Status::OK, 0);
+  } else if (method == "ServerStreamingEcho") {
+    return new ServerStreamingReactor(/* abort= */ false);
+  } else if (method == "ServerStreamingEchoAbort") {
+    return new ServerStreamingReactor(/* abort= */ true);
+  } else if (method == "ClientStreamingEcho") {
+    return new ClientStreamingReactor();
+  } else if (method == "FullDuplexEcho") {
+    return new DuplexReactor(/* half_duplex= */ false);
+  } else if (method == "HalfDuplexEcho") {
+    return new DuplexReactor(/* half_duplex= */ true);
+  }
+  return CallbackGenericService::CreateReactor(context);
+}
@@ -0,0 +1,48 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_GENERIC_SERVICE_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_GENERIC_SERVICE_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/grpcpp.h>
+
+// Serves the methods of the echo service, on their usual paths, from the
+// serialized requests and responses, like a relay would, instead of parsing
+// and serializing messages.
+//
+// EchoRequest and EchoResponse share their message field, so the request of
+// an Echo call is sent back as is: its slices are referenced by the response,
+// not copied. The responses of FullDuplexEcho and HalfDuplexEcho are their
+// request followed by the message_count field. Only the small requests of the
+// server streaming methods, and the responses of ClientStreamingEcho, are
+// parsed and serialized.
+class GenericEchoService final : public grpc::CallbackGenericService {
+ public:
+  // |slow_call_percent| and |slow_call_delay_ms| are as in EchoServiceImpl.
+  GenericEchoService(int slow_call_percent, int slow_call_delay_ms);
+
+  grpc::ServerGenericBidiReactor* CreateReactor(
+      grpc::GenericCallbackServerContext* context) override;
+
+ private:
+  const int slow_call_percent_;
+  const int slow_call_delay_ms_;
+};
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_GENERIC_SERVICE_H_
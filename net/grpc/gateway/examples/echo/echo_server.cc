@@ -18,26 +18,149 @@
 
 #include <grpcpp/grpcpp.h>
 #include <unistd.h>
+#include <algorithm>
+#include <iostream>
 #include <string>
+#include <thread>
 
+#include "net/grpc/gateway/examples/echo/batch_gateway.h"
+#include "net/grpc/gateway/examples/echo/compression_policy.h"
 #include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+#include "net/grpc/gateway/examples/echo/echo_async_service.h"
+#include "net/grpc/gateway/examples/echo/echo_generic_service.h"
 #include "net/grpc/gateway/examples/echo/echo_service_impl.h"
+#include "net/grpc/gateway/examples/echo/http_get_gateway.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
 
-void RunServer() {
+// How long HTTP caches may keep the responses to GET requests.
+const int kHttpGetMaxAgeSeconds = 60;
+
+const char kUsage[] =
+    "Usage: server [--http_get_port=PORT] [--batch_port=PORT]\n"
+    "              [--slow_call_percent=PERCENT] [--slow_call_delay_ms=MS]\n"
+    "              [--server_mode=sync|async|generic] [--cq_count=COUNT]\n"
+    "              [--compression=METHOD=COMPRESSION[:MIN_BYTES],...]\n";
+
+// Serves the echo service on port 9090, its NO_SIDE_EFFECTS methods to
+// gRPC-Web GET requests on |http_get_port|, and its unary methods to batches
+// of gRPC-Web calls on |batch_port|, unless they are 0. |slow_call_percent|
+// percent of the Echo calls are delayed by |slow_call_delay_ms|.
+//
+// The service is EchoServiceImpl if |server_mode| is "sync", compressing its
+// responses as |compression_policy| says; AsyncEchoService with |cq_count|
+// completion queues if it is "async"; and GenericEchoService if it is
+// "generic".
+void RunServer(int http_get_port, int batch_port, int slow_call_percent,
+               int slow_call_delay_ms, const std::string& server_mode,
+               int cq_count, const CompressionPolicy& compression_policy) {
   std::string server_address("0.0.0.0:9090");
-  EchoServiceImpl service;
+  EchoServiceImpl service(slow_call_percent, slow_call_delay_ms,
+                          compression_policy);
+  AsyncEchoService async_service(slow_call_percent, slow_call_delay_ms);
+  GenericEchoService generic_service(slow_call_percent, slow_call_delay_ms);
   ServerBuilder builder;
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
-  builder.RegisterService(&service);
+  if (server_mode == "async") {
+    async_service.Register(&builder, cq_count);
+  } else if (server_mode == "generic") {
+    builder.RegisterCallbackGenericService(&generic_service);
+  } else {
+    builder.RegisterService(&service);
+  }
   std::unique_ptr<Server> server(builder.BuildAndStart());
+  async_service.Start();
+  std::unique_ptr<HttpGetGateway> gateway;
+  if (http_get_port != 0) {
+    gateway.reset(new HttpGetGateway(
+        server->InProcessChannel(grpc::ChannelArguments()),
+        kHttpGetMaxAgeSeconds));
+    std::thread(&HttpGetGateway::Serve, gateway.get(), http_get_port)
+        .detach();
+  }
+  std::unique_ptr<BatchGateway> batch_gateway;
+  if (batch_port != 0) {
+    batch_gateway.reset(
+        new BatchGateway(server->InProcessChannel(grpc::ChannelArguments())));
+    std::thread(&BatchGateway::Serve, batch_gateway.get(), batch_port)
+        .detach();
+  }
   server->Wait();
+  async_service.Shutdown();
 }
 
 int main(int argc, char** argv) {
-  RunServer();
+  const std::string http_get_port_flag = "--http_get_port=";
+  const std::string batch_port_flag = "--batch_port=";
+  const std::string slow_call_percent_flag = "--slow_call_percent=";
+  const std::string slow_call_delay_ms_flag = "--slow_call_delay_ms=";
+  const std::string server_mode_flag = "--server_mode=";
+  const std::string cq_count_flag = "--cq_count=";
+  const std::string compression_flag = "--compression=";
+  int http_get_port = 0;
+  int batch_port = 0;
+  int slow_call_percent = 0;
+  int slow_call_delay_ms = 1000;
+  std::string server_mode = "sync";
+  int cq_count = 0;
+  CompressionPolicy compression_policy;
+  bool compression_set = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, http_get_port_flag.size(), http_get_port_flag) == 0) {
+      http_get_port = std::stoi(arg.substr(http_get_port_flag.size()));
+    } else if (arg.compare(0, batch_port_flag.size(), batch_port_flag) == 0) {
+      batch_port = std::stoi(arg.substr(batch_port_flag.size()));
+    } else if (arg.compare(0, slow_call_percent_flag.size(),
+                           slow_call_percent_flag) == 0) {
+      slow_call_percent =
+          std::stoi(arg.substr(slow_call_percent_flag.size()));
+    } else if (arg.compare(0, slow_call_delay_ms_flag.size(),
+                           slow_call_delay_ms_flag) == 0) {
+      slow_call_delay_ms =
+          std::stoi(arg.substr(slow_call_delay_ms_flag.size()));
+    } else if (arg.compare(0, server_mode_flag.size(), server_mode_flag) ==
+               0) {
+      server_mode = arg.substr(server_mode_flag.size());
+    } else if (arg.compare(0, cq_count_flag.size(), cq_count_flag) == 0) {
+      cq_count = std::stoi(arg.substr(cq_count_flag.size()));
+    } else if (arg.compare(0, compression_flag.size(), compression_flag) ==
+               0) {
+      std::string error;
+      if (!compression_policy.Parse(arg.substr(compression_flag.size()),
+                                    &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+      }
+      compression_set = true;
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl << kUsage;
+      return 1;
+    }
+  }
+  if (server_mode != "sync" && server_mode != "async" &&
+      server_mode != "generic") {
+    std::cerr << "Unknown server mode: " << server_mode << std::endl
+              << kUsage;
+    return 1;
+  }
+  if (cq_count != 0 && server_mode != "async") {
+    std::cerr << "--cq_count only applies to --server_mode=async"
+              << std::endl;
+    return 1;
+  }
+  if (compression_set && server_mode != "sync") {
+    std::cerr << "--compression only applies to --server_mode=sync"
+              << std::endl;
+    return 1;
+  }
+  if (cq_count <= 0) {
+    // One completion queue per core by default.
+    cq_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  RunServer(http_get_port, batch_port, slow_call_percent, slow_call_delay_ms,
+            server_mode, cq_count, compression_policy);
 
   return 0;
 }
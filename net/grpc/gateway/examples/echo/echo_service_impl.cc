@@ -20,13 +20,25 @@
 
 #include <grpcpp/grpcpp.h>
 #include <unistd.h>
+#include <chrono>
+#include <random>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+#include "net/grpc/gateway/examples/echo/paced_write_reactor.h"
 
+using grpc::CallbackServerContext;
 using grpc::ServerContext;
+using grpc::ServerContextBase;
+using grpc::ServerReader;
+using grpc::ServerReaderWriter;
+using grpc::ServerWriteReactor;
 using grpc::ServerWriter;
 using grpc::Status;
+using grpc::gateway::testing::ClientStreamingEchoRequest;
+using grpc::gateway::testing::ClientStreamingEchoResponse;
 using grpc::gateway::testing::EchoRequest;
 using grpc::gateway::testing::EchoResponse;
 using grpc::gateway::testing::EchoService;
@@ -34,11 +46,45 @@ using grpc::gateway::testing::Empty;
 using grpc::gateway::testing::ServerStreamingEchoRequest;
 using grpc::gateway::testing::ServerStreamingEchoResponse;
 
+namespace {
 
-EchoServiceImpl::EchoServiceImpl() {}
+// Writes the responses of a ServerStreamingEcho call.
+class ServerStreamingEchoReactor final
+    : public PacedWriteReactor<ServerWriteReactor<ServerStreamingEchoResponse>,
+                               ServerStreamingEchoResponse> {
+ public:
+  ServerStreamingEchoReactor(const ServerStreamingEchoRequest* request,
+                             const CompressionPolicy& compression_policy) {
+    ServerStreamingEchoResponse response;
+    response.set_message(request->message());
+    StartWrites(response, request->message_count(),
+                request->message_interval(),
+                compression_policy.GetWriteOptions("ServerStreamingEcho",
+                                                   response.ByteSizeLong()));
+  }
+};
+
+}  // namespace
+
+EchoServiceImpl::EchoServiceImpl(int slow_call_percent,
+                                 int slow_call_delay_ms,
+                                 const CompressionPolicy& compression_policy)
+    : slow_call_percent_(slow_call_percent),
+      slow_call_delay_ms_(slow_call_delay_ms),
+      compression_policy_(compression_policy) {}
 EchoServiceImpl::~EchoServiceImpl() {}
 
-void EchoServiceImpl::CopyClientMetadataToResponse(ServerContext* context) {
+bool EchoServiceImpl::IsSlowCall(int slow_call_percent) {
+  if (slow_call_percent <= 0) {
+    return false;
+  }
+  thread_local std::mt19937 generator{std::random_device{}()};
+  return std::uniform_int_distribution<int>(0, 99)(generator) <
+         slow_call_percent;
+}
+
+void EchoServiceImpl::CopyClientMetadataToResponse(
+    ServerContextBase* context) {
   for (auto& client_metadata : context->client_metadata()) {
     context->AddInitialMetadata(std::string(client_metadata.first.data(),
                                             client_metadata.first.length()),
@@ -52,10 +98,20 @@ void EchoServiceImpl::CopyClientMetadataToResponse(ServerContext* context) {
   }
 }
 
+void EchoServiceImpl::MaybeDelayCall() {
+  if (IsSlowCall(slow_call_percent_)) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(slow_call_delay_ms_));
+  }
+}
+
 Status EchoServiceImpl::Echo(ServerContext* context, const EchoRequest* request,
                              EchoResponse* response) {
   CopyClientMetadataToResponse(context);
+  MaybeDelayCall();
   response->set_message(request->message());
+  compression_policy_.SetResponseCompression("Echo", response->ByteSizeLong(),
+                                             context);
   return Status::OK;
 }
 
@@ -74,29 +130,80 @@ Status EchoServiceImpl::NoOp(ServerContext* context, const Empty* request,
   return Status::OK;
 }
 
-Status EchoServiceImpl::ServerStreamingEcho(
-    ServerContext* context, const ServerStreamingEchoRequest* request,
-    ServerWriter<ServerStreamingEchoResponse>* writer) {
+ServerWriteReactor<ServerStreamingEchoResponse>*
+EchoServiceImpl::ServerStreamingEcho(CallbackServerContext* context,
+                                     const ServerStreamingEchoRequest* request) {
   CopyClientMetadataToResponse(context);
-  for (int i = 0; i < request->message_count(); i++) {
-    if (context->IsCancelled()) {
-      return Status::CANCELLED;
-    }
-    ServerStreamingEchoResponse response;
-    response.set_message(request->message());
-    usleep(request->message_interval() * 1000);
-    writer->Write(response);
-  }
-  return Status::OK;
+  compression_policy_.SetCallCompression("ServerStreamingEcho", context);
+  return new ServerStreamingEchoReactor(request, compression_policy_);
 }
 
 Status EchoServiceImpl::ServerStreamingEchoAbort(
     ServerContext* context, const ServerStreamingEchoRequest* request,
     ServerWriter<ServerStreamingEchoResponse>* writer) {
   CopyClientMetadataToResponse(context);
+  compression_policy_.SetCallCompression("ServerStreamingEchoAbort", context);
   ServerStreamingEchoResponse response;
   response.set_message(request->message());
-  writer->Write(response);
+  writer->Write(response,
+                compression_policy_.GetWriteOptions(
+                    "ServerStreamingEchoAbort", response.ByteSizeLong()));
   return Status(grpc::StatusCode::ABORTED,
                 "Aborted from server side.");
 }
+
+Status EchoServiceImpl::ClientStreamingEcho(
+    ServerContext* context, ServerReader<ClientStreamingEchoRequest>* reader,
+    ClientStreamingEchoResponse* response) {
+  CopyClientMetadataToResponse(context);
+  int message_count = 0;
+  ClientStreamingEchoRequest request;
+  // An empty message ends the stream early, see echo.proto.
+  while (reader->Read(&request) && !request.message().empty()) {
+    message_count++;
+  }
+  response->set_message_count(message_count);
+  compression_policy_.SetResponseCompression(
+      "ClientStreamingEcho", response->ByteSizeLong(), context);
+  return Status::OK;
+}
+
+Status EchoServiceImpl::FullDuplexEcho(
+    ServerContext* context,
+    ServerReaderWriter<EchoResponse, EchoRequest>* stream) {
+  CopyClientMetadataToResponse(context);
+  compression_policy_.SetCallCompression("FullDuplexEcho", context);
+  int message_count = 0;
+  EchoRequest request;
+  while (stream->Read(&request)) {
+    EchoResponse response;
+    response.set_message(request.message());
+    response.set_message_count(++message_count);
+    stream->Write(response,
+                  compression_policy_.GetWriteOptions(
+                      "FullDuplexEcho", response.ByteSizeLong()));
+  }
+  return Status::OK;
+}
+
+Status EchoServiceImpl::HalfDuplexEcho(
+    ServerContext* context,
+    ServerReaderWriter<EchoResponse, EchoRequest>* stream) {
+  CopyClientMetadataToResponse(context);
+  compression_policy_.SetCallCompression("HalfDuplexEcho", context);
+  std::vector<EchoRequest> requests;
+  EchoRequest request;
+  while (stream->Read(&request)) {
+    requests.push_back(request);
+  }
+  int message_count = 0;
+  for (const EchoRequest& buffered_request : requests) {
+    EchoResponse response;
+    response.set_message(buffered_request.message());
+    response.set_message_count(++message_count);
+    stream->Write(response,
+                  compression_policy_.GetWriteOptions(
+                      "HalfDuplexEcho", response.ByteSizeLong()));
+  }
+  return Status::OK;
+}
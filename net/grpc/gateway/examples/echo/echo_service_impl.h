@@ -23,15 +23,28 @@
 #include <unistd.h>
 #include <string>
 
+#include "net/grpc/gateway/examples/echo/compression_policy.h"
 #include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
 
-class EchoServiceImpl final :
-    public grpc::gateway::testing::EchoService::Service {
+// ServerStreamingEcho uses the callback API, so that open streams do not
+// hold a thread of the server while they wait between messages.
+class EchoServiceImpl final
+    : public grpc::gateway::testing::EchoService::
+          WithCallbackMethod_ServerStreamingEcho<
+              grpc::gateway::testing::EchoService::Service> {
  public:
-  EchoServiceImpl();
+  // Delays |slow_call_percent| percent of the Echo calls, picked at random,
+  // by |slow_call_delay_ms|, like a slow replica would, and compresses the
+  // responses as |compression_policy| says.
+  explicit EchoServiceImpl(
+      int slow_call_percent = 0, int slow_call_delay_ms = 0,
+      const CompressionPolicy& compression_policy = CompressionPolicy());
   ~EchoServiceImpl() override;
 
-  void CopyClientMetadataToResponse(grpc::ServerContext* context);
+  // Also used by AsyncEchoService, so that both servers answer alike.
+  static void CopyClientMetadataToResponse(grpc::ServerContextBase* context);
+  static bool IsSlowCall(int slow_call_percent);
+
   grpc::Status Echo(
       grpc::ServerContext* context,
       const grpc::gateway::testing::EchoRequest* request,
@@ -44,16 +57,37 @@ class EchoServiceImpl final :
       grpc::ServerContext* context,
       const grpc::gateway::testing::Empty* request,
       grpc::gateway::testing::Empty* response) override;
-  grpc::Status ServerStreamingEcho(
-      grpc::ServerContext* context,
-      const grpc::gateway::testing::ServerStreamingEchoRequest* request,
-      grpc::ServerWriter<
-      grpc::gateway::testing::ServerStreamingEchoResponse>* writer) override;
+  grpc::ServerWriteReactor<
+      grpc::gateway::testing::ServerStreamingEchoResponse>*
+  ServerStreamingEcho(
+      grpc::CallbackServerContext* context,
+      const grpc::gateway::testing::ServerStreamingEchoRequest* request)
+      override;
   grpc::Status ServerStreamingEchoAbort(
       grpc::ServerContext* context,
       const grpc::gateway::testing::ServerStreamingEchoRequest* request,
       grpc::ServerWriter<
       grpc::gateway::testing::ServerStreamingEchoResponse>* writer) override;
+  grpc::Status ClientStreamingEcho(
+      grpc::ServerContext* context,
+      grpc::ServerReader<
+      grpc::gateway::testing::ClientStreamingEchoRequest>* reader,
+      grpc::gateway::testing::ClientStreamingEchoResponse* response) override;
+  grpc::Status FullDuplexEcho(
+      grpc::ServerContext* context,
+      grpc::ServerReaderWriter<grpc::gateway::testing::EchoResponse,
+      grpc::gateway::testing::EchoRequest>* stream) override;
+  grpc::Status HalfDuplexEcho(
+      grpc::ServerContext* context,
+      grpc::ServerReaderWriter<grpc::gateway::testing::EchoResponse,
+      grpc::gateway::testing::EchoRequest>* stream) override;
+
+ private:
+  void MaybeDelayCall();
+
+  const int slow_call_percent_;
+  const int slow_call_delay_ms_;
+  const CompressionPolicy compression_policy_;
 };
 
 #endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_ECHO_SERVICE_IMPL_H_
@@ -0,0 +1,179 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/http_get_gateway.h"
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <future>
+#include <set>
+#include <string>
+
+#include "net/grpc/gateway/examples/echo/http_util.h"
+
+using google::protobuf::DescriptorPool;
+using google::protobuf::MethodDescriptor;
+using google::protobuf::MethodOptions;
+using grpc::ByteBuffer;
+using grpc::ClientContext;
+using grpc::Slice;
+using grpc::Status;
+using grpc::StatusCode;
+
+namespace {
+
+// The query params holding the request, and the request headers sent by
+// clients with the suppressCorsPreflight option.
+const char kRequestParam[] = "$req";
+const char kHttpHeadersParam[] = "$httpHeaders";
+
+}  // namespace
+
+HttpGetGateway::HttpGetGateway(std::shared_ptr<grpc::Channel> channel,
+                               int max_age_seconds)
+    : stub_(channel), max_age_seconds_(max_age_seconds) {}
+
+void HttpGetGateway::Serve(int port) {
+  ServeHttp(port, [this](const HttpRequest& request) {
+    return Handle(request);
+  });
+}
+
+std::string HttpGetGateway::Handle(const HttpRequest& request) {
+  if (request.method == "OPTIONS") {
+    // A CORS preflight, sent for requests with custom headers.
+    return HttpResponse(
+        "204 No Content",
+        "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: *\r\n"
+        "Access-Control-Max-Age: 1728000\r\n",
+        "");
+  }
+  if (request.method != "GET") {
+    return HttpResponse("405 Method Not Allowed", "Allow: GET, OPTIONS\r\n",
+                        "");
+  }
+  size_t question_mark = request.target.find('?');
+  return Call(request.target.substr(0, question_mark),
+              question_mark == std::string::npos
+                  ? ""
+                  : request.target.substr(question_mark + 1),
+              request.headers);
+}
+
+std::string HttpGetGateway::Call(
+    const std::string& path, const std::string& query,
+    const std::multimap<std::string, std::string>& request_headers) {
+  std::multimap<std::string, std::string> headers = request_headers;
+  std::string http_headers;
+  if (GetQueryParam(query, kHttpHeadersParam, &http_headers)) {
+    ParseHeaders(http_headers, &headers);
+  }
+  auto accept = headers.find("accept");
+  bool text = accept != headers.end() &&
+              accept->second.find("application/grpc-web-text") !=
+                  std::string::npos;
+  std::string response_headers =
+      std::string("Content-Type: ") +
+      (text ? "application/grpc-web-text" : "application/grpc-web+proto") +
+      "\r\nVary: Accept\r\n";
+
+  std::string full_name = path.empty() ? "" : path.substr(1);
+  std::replace(full_name.begin(), full_name.end(), '/', '.');
+  const MethodDescriptor* method =
+      DescriptorPool::generated_pool()->FindMethodByName(full_name);
+  std::string encoded_request;
+  std::string request;
+  Status status;
+  if (method == nullptr) {
+    status = Status(StatusCode::UNIMPLEMENTED, "Unknown method " + path);
+  } else if (method->client_streaming() || method->server_streaming() ||
+             method->options().idempotency_level() !=
+                 MethodOptions::NO_SIDE_EFFECTS) {
+    status = Status(StatusCode::UNIMPLEMENTED,
+                    "GET is only supported for unary methods with "
+                    "idempotency_level = NO_SIDE_EFFECTS");
+  } else if (!GetQueryParam(query, kRequestParam, &encoded_request) ||
+             !Base64Decode(encoded_request, &request)) {
+    status = Status(StatusCode::INVALID_ARGUMENT,
+                    "Missing or malformed request param");
+  }
+  if (!status.ok()) {
+    // A trailers-only response, which must not be cached.
+    return HttpResponse(
+        "200 OK",
+        response_headers + "Cache-Control: no-store\r\n" +
+            "Access-Control-Expose-Headers: grpc-status, grpc-message\r\n" +
+            "grpc-status: " + std::to_string(status.error_code()) + "\r\n" +
+            "grpc-message: " + PercentEncode(status.error_message()) + "\r\n",
+        "");
+  }
+
+  ClientContext context;
+  std::set<std::string> request_metadata_names;
+  if (!SetCallMetadata(headers, &context, &request_metadata_names)) {
+    return HttpResponse("400 Bad Request", "Cache-Control: no-store\r\n",
+                        "Invalid call metadata");
+  }
+
+  Slice request_slice(request);
+  ByteBuffer request_buffer(&request_slice, 1);
+  ByteBuffer response_buffer;
+  std::promise<Status> done;
+  stub_.UnaryCall(&context, path, grpc::StubOptions(), &request_buffer,
+                  &response_buffer,
+                  [&done](Status status) { done.set_value(status); });
+  status = done.get_future().get();
+
+  std::set<std::string> metadata_names = {"grpc-status", "grpc-message"};
+  std::string trailers =
+      "grpc-status:" + std::to_string(status.error_code()) + "\r\n" +
+      "grpc-message:" + PercentEncode(status.error_message()) + "\r\n";
+  AppendMetadata(context.GetServerTrailingMetadata(), ":", &trailers,
+                 &metadata_names);
+  AppendMetadata(context.GetServerInitialMetadata(), ": ", &response_headers,
+                 &metadata_names);
+  std::string body;
+  if (status.ok()) {
+    AppendFrame(0x00, ToString(response_buffer), &body);
+    // Caches may keep the response, keyed by the URL holding the request.
+    // The response may also depend on the request metadata, e.g. an
+    // authorization header, which the echo service even copies into it, so
+    // only the client's own cache may keep the response of a call with
+    // metadata.
+    response_headers +=
+        std::string("Cache-Control: ") +
+        (request_metadata_names.empty() ? "public" : "private") +
+        ", max-age=" + std::to_string(max_age_seconds_) + "\r\n";
+  } else {
+    response_headers += "Cache-Control: no-store\r\n";
+  }
+  AppendFrame(0x80, trailers, &body);
+
+  std::string expose_headers;
+  for (const std::string& name : metadata_names) {
+    expose_headers += (expose_headers.empty() ? "" : ", ") + name;
+  }
+  response_headers += "Access-Control-Expose-Headers: " + expose_headers +
+                      "\r\n";
+  return HttpResponse("200 OK", response_headers,
+                      text ? Base64Encode(body) : body);
+}
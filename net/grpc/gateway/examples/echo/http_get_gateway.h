@@ -0,0 +1,61 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_HTTP_GET_GATEWAY_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_HTTP_GET_GATEWAY_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "net/grpc/gateway/examples/echo/http_util.h"
+
+// Serves the gRPC-Web GET requests sent by clients created with the
+// useHttpGet option: unary calls to methods with
+// idempotency_level = NO_SIDE_EFFECTS, holding the serialized request in the
+// web-safe base64 query param $req=. Each call is forwarded to |channel|, and
+// answered with an application/grpc-web(-text) response that HTTP caches may
+// keep for |max_age_seconds| if it succeeded.
+//
+// This is a minimal HTTP/1.1 server for trying the transport locally. It
+// closes the connection after each response, and does not support TLS.
+class HttpGetGateway {
+ public:
+  HttpGetGateway(std::shared_ptr<grpc::Channel> channel, int max_age_seconds);
+
+  // Accepts connections on |port|, each in its own thread. Only returns if
+  // it cannot listen on |port|.
+  void Serve(int port);
+
+ private:
+  // Returns the HTTP response to |request|.
+  std::string Handle(const HttpRequest& request);
+
+  // Calls |path|, e.g. /grpc.gateway.testing.EchoService/Echo, with the
+  // request in |query| and the metadata in |headers|, and returns the HTTP
+  // response.
+  std::string Call(const std::string& path, const std::string& query,
+                   const std::multimap<std::string, std::string>& headers);
+
+  grpc::GenericStub stub_;
+  const int max_age_seconds_;
+};
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_HTTP_GET_GATEWAY_H_
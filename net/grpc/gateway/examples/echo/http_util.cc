@@ -0,0 +1,417 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/http_util.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The largest request line and headers, and the largest body, accepted.
+const size_t kMaxRequestHeadSize = 64 * 1024;
+const size_t kMaxRequestBodySize = 16 * 1024 * 1024;
+
+const char kBase64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// HTTP request headers that are not forwarded as call metadata, besides
+// the Sec- headers of browsers.
+const std::set<std::string>& IgnoredHeaders() {
+  static const std::set<std::string>* headers = new std::set<std::string>{
+      "accept",        "accept-encoding", "accept-language",
+      "cache-control", "connection",      "content-length",
+      "content-type",  "cookie",          "grpc-timeout",
+      "host",          "if-none-match",   "if-modified-since",
+      "origin",        "pragma",          "referer",
+      "user-agent",    "x-grpc-web",      "x-user-agent",
+  };
+  return *headers;
+}
+
+std::string ToLower(std::string text) {
+  for (char& c : text) {
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+  return text;
+}
+
+std::string Trim(const std::string& text) {
+  size_t begin = text.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+std::string PercentDecode(const std::string& text) {
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '%' && i + 2 < text.size() && isxdigit(text[i + 1]) &&
+        isxdigit(text[i + 2])) {
+      decoded.push_back(
+          static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16)));
+      i += 2;
+    } else if (text[i] == '+') {
+      decoded.push_back(' ');
+    } else {
+      decoded.push_back(text[i]);
+    }
+  }
+  return decoded;
+}
+
+// Returns whether |key| and |value| may be sent as call metadata, on which
+// gRPC aborts otherwise: keys are made of [0-9a-z_.-], and values of
+// printable ASCII unless the key ends with -bin.
+bool IsValidMetadata(const std::string& key, const std::string& value) {
+  if (key.empty() || key.find_first_not_of("0123456789"
+                                           "abcdefghijklmnopqrstuvwxyz"
+                                           "_.-") != std::string::npos) {
+    return false;
+  }
+  if (EndsWith(key, "-bin")) {
+    return true;
+  }
+  for (char c : value) {
+    if (c < 0x20 || c > 0x7E) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the deadline of a grpc-timeout header value, e.g. "1500m", or
+// false if it is malformed.
+bool ParseTimeout(const std::string& timeout,
+                  std::chrono::system_clock::time_point* deadline) {
+  if (timeout.size() < 2 ||
+      timeout.find_first_not_of("0123456789") != timeout.size() - 1) {
+    return false;
+  }
+  int64_t value = std::stoll(timeout.substr(0, timeout.size() - 1));
+  std::chrono::nanoseconds duration;
+  switch (timeout.back()) {
+    case 'H': duration = std::chrono::hours(value); break;
+    case 'M': duration = std::chrono::minutes(value); break;
+    case 'S': duration = std::chrono::seconds(value); break;
+    case 'm': duration = std::chrono::milliseconds(value); break;
+    case 'u': duration = std::chrono::microseconds(value); break;
+    case 'n': duration = std::chrono::nanoseconds(value); break;
+    default: return false;
+  }
+  *deadline = std::chrono::system_clock::now() +
+              std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                  duration);
+  return true;
+}
+
+bool ReadRequest(int fd, HttpRequest* request) {
+  std::string data;
+  char buffer[4096];
+  size_t head_end;
+  while ((head_end = data.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t size;
+    if (data.size() > kMaxRequestHeadSize ||
+        (size = recv(fd, buffer, sizeof(buffer), 0)) <= 0) {
+      return false;
+    }
+    data.append(buffer, size);
+  }
+
+  size_t line_end = data.find("\r\n");
+  std::string request_line = data.substr(0, line_end);
+  ParseHeaders(data.substr(line_end + 2, head_end - line_end - 2),
+               &request->headers);
+  size_t space = request_line.find(' ');
+  request->method = request_line.substr(0, space);
+  request->target = space == std::string::npos
+      ? ""
+      : request_line.substr(space + 1, request_line.rfind(' ') - space - 1);
+
+  size_t body_size = 0;
+  auto content_length = request->headers.find("content-length");
+  if (content_length != request->headers.end()) {
+    if (content_length->second.empty() ||
+        content_length->second.find_first_not_of("0123456789") !=
+            std::string::npos ||
+        content_length->second.size() > 9 ||
+        (body_size = std::stoul(content_length->second)) >
+            kMaxRequestBodySize) {
+      return false;
+    }
+  }
+  request->body = data.substr(head_end + 4);
+  while (request->body.size() < body_size) {
+    ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+    if (size <= 0) {
+      return false;
+    }
+    request->body.append(buffer, size);
+  }
+  request->body.resize(body_size);
+  return true;
+}
+
+void HandleConnection(
+    int fd, std::function<std::string(const HttpRequest&)> handler) {
+  HttpRequest request;
+  if (!ReadRequest(fd, &request)) {
+    close(fd);
+    return;
+  }
+  std::string response = handler(request);
+
+  const char* data = response.data();
+  size_t remaining = response.size();
+  while (remaining > 0) {
+    ssize_t sent = send(fd, data, remaining, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      break;
+    }
+    data += sent;
+    remaining -= sent;
+  }
+  close(fd);
+}
+
+}  // namespace
+
+void ServeHttp(int port,
+               const std::function<std::string(const HttpRequest&)>& handler) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    std::cerr << "Cannot listen on port " << port << std::endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return;
+  }
+  while (true) {
+    int connection = accept(fd, nullptr, nullptr);
+    if (connection >= 0) {
+      std::thread(HandleConnection, connection, handler).detach();
+    }
+  }
+}
+
+std::string HttpResponse(const std::string& status, const std::string& headers,
+                         const std::string& body) {
+  return "HTTP/1.1 " + status + "\r\n" + headers +
+         "Access-Control-Allow-Origin: *\r\n"
+         "Connection: close\r\n"
+         "Content-Length: " + std::to_string(body.size()) + "\r\n"
+         "\r\n" + body;
+}
+
+bool EndsWith(const std::string& text, const std::string& suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string Base64Encode(const std::string& bytes) {
+  std::string text;
+  size_t i = 0;
+  for (; i + 2 < bytes.size(); i += 3) {
+    uint32_t n = static_cast<uint8_t>(bytes[i]) << 16 |
+                 static_cast<uint8_t>(bytes[i + 1]) << 8 |
+                 static_cast<uint8_t>(bytes[i + 2]);
+    text.push_back(kBase64Chars[n >> 18]);
+    text.push_back(kBase64Chars[n >> 12 & 63]);
+    text.push_back(kBase64Chars[n >> 6 & 63]);
+    text.push_back(kBase64Chars[n & 63]);
+  }
+  if (i < bytes.size()) {
+    uint32_t n = static_cast<uint8_t>(bytes[i]) << 16;
+    if (i + 1 < bytes.size()) {
+      n |= static_cast<uint8_t>(bytes[i + 1]) << 8;
+    }
+    text.push_back(kBase64Chars[n >> 18]);
+    text.push_back(kBase64Chars[n >> 12 & 63]);
+    text.push_back(i + 1 < bytes.size() ? kBase64Chars[n >> 6 & 63] : '=');
+    text.push_back('=');
+  }
+  return text;
+}
+
+bool Base64Decode(const std::string& text, std::string* bytes) {
+  bytes->clear();
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (char c : text) {
+    int value;
+    if (c >= 'A' && c <= 'Z') {
+      value = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      value = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      value = c - '0' + 52;
+    } else if (c == '+' || c == '-') {
+      value = 62;
+    } else if (c == '/' || c == '_') {
+      value = 63;
+    } else if (c == '=') {
+      break;
+    } else {
+      return false;
+    }
+    buffer = buffer << 6 | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      bytes->push_back(static_cast<char>(buffer >> bits & 0xFF));
+    }
+  }
+  return true;
+}
+
+std::string PercentEncode(const std::string& text) {
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string encoded;
+  for (char c : text) {
+    uint8_t byte = static_cast<uint8_t>(c);
+    if (byte < 0x20 || byte > 0x7E || c == '%') {
+      encoded.push_back('%');
+      encoded.push_back(kHex[byte >> 4]);
+      encoded.push_back(kHex[byte & 15]);
+    } else {
+      encoded.push_back(c);
+    }
+  }
+  return encoded;
+}
+
+bool GetQueryParam(const std::string& query, const std::string& name,
+                   std::string* value) {
+  size_t begin = 0;
+  while (begin <= query.size()) {
+    size_t end = query.find('&', begin);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    std::string param = query.substr(begin, end - begin);
+    size_t equals = param.find('=');
+    if (PercentDecode(param.substr(0, equals)) == name) {
+      *value = equals == std::string::npos
+                   ? ""
+                   : PercentDecode(param.substr(equals + 1));
+      return true;
+    }
+    begin = end + 1;
+  }
+  return false;
+}
+
+void ParseHeaders(const std::string& lines,
+                  std::multimap<std::string, std::string>* headers) {
+  size_t begin = 0;
+  while (begin < lines.size()) {
+    size_t end = lines.find("\r\n", begin);
+    if (end == std::string::npos) {
+      end = lines.size();
+    }
+    std::string line = lines.substr(begin, end - begin);
+    // Pseudo-headers, e.g. ":path", start with a colon.
+    size_t colon = line.find(':', 1);
+    if (colon != std::string::npos) {
+      headers->emplace(ToLower(Trim(line.substr(0, colon))),
+                       Trim(line.substr(colon + 1)));
+    }
+    begin = end + 2;
+  }
+}
+
+bool SetCallMetadata(const std::multimap<std::string, std::string>& headers,
+                     grpc::ClientContext* context,
+                     std::set<std::string>* names) {
+  for (const auto& header : headers) {
+    if (IgnoredHeaders().count(header.first) > 0 ||
+        header.first.compare(0, 4, "sec-") == 0 ||
+        header.first.compare(0, 1, ":") == 0) {
+      continue;
+    }
+    std::string value = header.second;
+    if (EndsWith(header.first, "-bin") &&
+        !Base64Decode(header.second, &value)) {
+      continue;
+    }
+    if (!IsValidMetadata(header.first, value)) {
+      return false;
+    }
+    context->AddMetadata(header.first, value);
+    if (names != nullptr) {
+      names->insert(header.first);
+    }
+  }
+  auto timeout = headers.find("grpc-timeout");
+  std::chrono::system_clock::time_point deadline;
+  if (timeout != headers.end() && ParseTimeout(timeout->second, &deadline)) {
+    context->set_deadline(deadline);
+  }
+  return true;
+}
+
+void AppendMetadata(
+    const std::multimap<grpc::string_ref, grpc::string_ref>& metadata,
+    const std::string& separator, std::string* lines,
+    std::set<std::string>* names) {
+  for (const auto& entry : metadata) {
+    std::string name(entry.first.data(), entry.first.size());
+    std::string value(entry.second.data(), entry.second.size());
+    if (EndsWith(name, "-bin")) {
+      value = Base64Encode(value);
+    }
+    *lines += name + separator + value + "\r\n";
+    if (names != nullptr) {
+      names->insert(name);
+    }
+  }
+}
+
+void AppendFrame(uint8_t flags, const std::string& data, std::string* body) {
+  body->push_back(static_cast<char>(flags));
+  uint32_t size = static_cast<uint32_t>(data.size());
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    body->push_back(static_cast<char>(size >> shift & 0xFF));
+  }
+  body->append(data);
+}
+
+std::string ToString(const grpc::ByteBuffer& buffer) {
+  std::vector<grpc::Slice> slices;
+  buffer.Dump(&slices);
+  std::string bytes;
+  for (const grpc::Slice& slice : slices) {
+    bytes.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+  }
+  return bytes;
+}
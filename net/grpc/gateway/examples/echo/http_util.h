@@ -0,0 +1,94 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_HTTP_UTIL_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_HTTP_UTIL_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Helpers of the minimal HTTP/1.1 servers forwarding gRPC-Web requests that
+// Envoy does not handle, see HttpGetGateway and BatchGateway.
+
+#include <grpcpp/grpcpp.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+struct HttpRequest {
+  std::string method;
+  // The path and query, e.g. /grpc.gateway.testing.EchoService/Echo?$req=
+  std::string target;
+  // The headers, with lower case names.
+  std::multimap<std::string, std::string> headers;
+  std::string body;
+};
+
+// Accepts connections on |port|, each in its own thread, and answers the
+// request received on each with the HTTP response returned by |handler|,
+// before closing it. Only returns if it cannot listen on |port|.
+void ServeHttp(int port,
+               const std::function<std::string(const HttpRequest&)>& handler);
+
+// Returns an HTTP response with |status|, e.g. "200 OK", the "name: value\r\n"
+// lines in |headers|, and |body|.
+std::string HttpResponse(const std::string& status, const std::string& headers,
+                         const std::string& body);
+
+bool EndsWith(const std::string& text, const std::string& suffix);
+
+std::string Base64Encode(const std::string& bytes);
+
+// Decodes standard or web-safe base64, with or without padding.
+bool Base64Decode(const std::string& text, std::string* bytes);
+
+// Percent-encodes a grpc-message, as the gRPC protocol requires.
+std::string PercentEncode(const std::string& text);
+
+// Returns the decoded value of the query param |name|, or false if |query|
+// does not have it.
+bool GetQueryParam(const std::string& query, const std::string& name,
+                   std::string* value);
+
+// Adds the "name: value" lines in |lines| to |headers|, with lower case
+// names. Pseudo-header names, e.g. ":path", keep their colon.
+void ParseHeaders(const std::string& lines,
+                  std::multimap<std::string, std::string>* headers);
+
+// Adds the call metadata in the request |headers| to |context|, with
+// base64-decoded -bin values, and sets its deadline from grpc-timeout.
+// Adds the names of the metadata to |names| unless it is null. Returns false,
+// with |context| partly set, if a header has a name or value which is not
+// valid metadata, e.g. a non-ASCII value.
+bool SetCallMetadata(const std::multimap<std::string, std::string>& headers,
+                     grpc::ClientContext* context,
+                     std::set<std::string>* names);
+
+// Adds |metadata| to |lines| as "name<separator>value" lines, with binary
+// values in base64, and adds the names to |names| unless it is null.
+void AppendMetadata(
+    const std::multimap<grpc::string_ref, grpc::string_ref>& metadata,
+    const std::string& separator, std::string* lines,
+    std::set<std::string>* names);
+
+// Appends a gRPC-Web frame to |body|.
+void AppendFrame(uint8_t flags, const std::string& data, std::string* body);
+
+// Returns the bytes held by |buffer|.
+std::string ToString(const grpc::ByteBuffer& buffer);
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_HTTP_UTIL_H_
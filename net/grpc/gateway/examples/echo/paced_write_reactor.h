@@ -0,0 +1,121 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_PACED_WRITE_REACTOR_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_PACED_WRITE_REACTOR_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <mutex>
+
+// A callback-API reactor writing the same response a number of times, as
+// ServerStreamingEcho does. The interval between the writes is waited for
+// with an alarm rather than by holding a thread, and the call finishes as
+// soon as it is cancelled.
+//
+// |Reactor| is the reactor class of the method, e.g.
+// grpc::ServerWriteReactor<Response>, and |Response| the type of its
+// responses. Deletes itself once the call is done.
+template <typename Reactor, typename Response>
+class PacedWriteReactor : public Reactor {
+ public:
+  void OnWriteDone(bool ok) override {
+    if (!ok) {
+      this->Finish(grpc::Status::CANCELLED);
+      return;
+    }
+    messages_written_++;
+    WaitForNextMessage();
+  }
+
+  void OnCancel() override {
+    std::lock_guard<std::mutex> lock(mu_);
+    cancelled_ = true;
+    if (waiting_) {
+      alarm_.Cancel();
+    }
+  }
+
+  void OnDone() override { delete this; }
+
+ protected:
+  // Writes |response| |message_count| times with |options|,
+  // |message_interval_ms| apart and starting after one interval, then
+  // finishes the call.
+  void StartWrites(const Response& response, int message_count,
+                   int message_interval_ms,
+                   grpc::WriteOptions options = grpc::WriteOptions()) {
+    response_ = response;
+    options_ = options;
+    message_count_ = message_count;
+    message_interval_ms_ = message_interval_ms;
+    WaitForNextMessage();
+  }
+
+ private:
+  // Writes the next response once the interval has passed, or finishes the
+  // call once they are all written.
+  void WaitForNextMessage() {
+    if (messages_written_ >= message_count_) {
+      this->Finish(grpc::Status::OK);
+      return;
+    }
+    if (message_interval_ms_ <= 0) {
+      this->StartWrite(&response_, options_);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (!cancelled_) {
+        waiting_ = true;
+        alarm_.Set(std::chrono::system_clock::now() +
+                       std::chrono::milliseconds(message_interval_ms_),
+                   [this](bool ok) { OnAlarm(ok); });
+        return;
+      }
+    }
+    this->Finish(grpc::Status::CANCELLED);
+  }
+
+  // |ok| is false if the alarm was cancelled with the call.
+  void OnAlarm(bool ok) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      waiting_ = false;
+    }
+    if (!ok) {
+      this->Finish(grpc::Status::CANCELLED);
+      return;
+    }
+    this->StartWrite(&response_, options_);
+  }
+
+  Response response_;
+  grpc::WriteOptions options_;
+  int message_count_ = 0;
+  int message_interval_ms_ = 0;
+  int messages_written_ = 0;
+  grpc::Alarm alarm_;
+  // Guards the alarm against OnCancel(), which may run at any time.
+  std::mutex mu_;
+  bool waiting_ = false;
+  bool cancelled_ = false;
+};
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_PACED_WRITE_REACTOR_H_
@@ -0,0 +1,117 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Makes Echo calls to the echo server with messages of each size, and reports
+// the calls per second and, given the server's pid, the CPU time the server
+// spent per call, e.g. to compare --server_mode=sync and generic:
+//
+//   payload_benchmark --server_pid=$(pidof server)
+//
+// Exits with 1 if a call fails.
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+#include "net/grpc/gateway/examples/echo/proc_stats.h"
+
+using grpc::gateway::testing::EchoRequest;
+using grpc::gateway::testing::EchoResponse;
+using grpc::gateway::testing::EchoService;
+
+int main(int argc, char** argv) {
+  const std::string server_flag = "--server=";
+  const std::string server_pid_flag = "--server_pid=";
+  const std::string sizes_flag = "--sizes=";
+  const std::string concurrency_flag = "--concurrency=";
+  const std::string seconds_flag = "--seconds=";
+  std::string server = "localhost:9090";
+  int server_pid = 0;
+  // 1 KB, 64 KB and 4 MB, under the default 4 MiB limit of gRPC messages.
+  std::string sizes = "1000,64000,4000000";
+  int concurrency = 4;
+  int seconds = 5;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, server_flag.size(), server_flag) == 0) {
+      server = arg.substr(server_flag.size());
+    } else if (arg.compare(0, server_pid_flag.size(), server_pid_flag) == 0) {
+      server_pid = std::stoi(arg.substr(server_pid_flag.size()));
+    } else if (arg.compare(0, sizes_flag.size(), sizes_flag) == 0) {
+      sizes = arg.substr(sizes_flag.size());
+    } else if (arg.compare(0, concurrency_flag.size(), concurrency_flag) ==
+               0) {
+      concurrency = std::stoi(arg.substr(concurrency_flag.size()));
+    } else if (arg.compare(0, seconds_flag.size(), seconds_flag) == 0) {
+      seconds = std::stoi(arg.substr(seconds_flag.size()));
+    }
+  }
+
+  std::shared_ptr<grpc::Channel> channel =
+      grpc::CreateChannel(server, grpc::InsecureChannelCredentials());
+  std::unique_ptr<EchoService::Stub> stub(EchoService::NewStub(channel));
+  std::istringstream size_list(sizes);
+  std::string size;
+  bool failed = false;
+  while (std::getline(size_list, size, ',')) {
+    EchoRequest request;
+    request.set_message(std::string(std::stoi(size), 'x'));
+    std::atomic<int> call_count(0);
+    std::atomic<int> error_count(0);
+    double cpu_start = server_pid != 0 ? ProcessCpuSeconds(server_pid) : 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < concurrency; i++) {
+      threads.emplace_back([&]() {
+        while (std::chrono::steady_clock::now() < end) {
+          grpc::ClientContext context;
+          EchoResponse response;
+          grpc::Status status = stub->Echo(&context, request, &response);
+          if (!status.ok() || response.message() != request.message()) {
+            error_count++;
+          }
+          call_count++;
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << size << " bytes: " << call_count / elapsed.count()
+              << " calls/s";
+    if (server_pid != 0) {
+      std::cout << ", "
+                << (ProcessCpuSeconds(server_pid) - cpu_start) * 1e6 /
+                       call_count
+                << " us of server CPU per call";
+    }
+    std::cout << ", " << error_count << " failed" << std::endl;
+    failed = failed || error_count > 0;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "net/grpc/gateway/examples/echo/proc_stats.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+double ProcessCpuSeconds(int pid) {
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  std::getline(stat, line);
+  size_t command_end = line.rfind(')');
+  if (command_end == std::string::npos || command_end + 2 > line.size()) {
+    return 0;
+  }
+  // The fields after the command, which may hold spaces, start with the
+  // state. utime and stime are the 12th and 13th of them.
+  std::istringstream fields(line.substr(command_end + 2));
+  std::string field;
+  double ticks = 0;
+  for (int i = 1; i <= 13 && fields >> field; i++) {
+    if (i >= 12) {
+      ticks += std::stod(field);
+    }
+  }
+  return ticks / sysconf(_SC_CLK_TCK);
+}
+
+std::string ProcessStatusField(int pid, const std::string& field) {
+  std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size() + 1, field + ":") == 0) {
+      size_t value = line.find_first_not_of(" \t", field.size() + 1);
+      return value == std::string::npos ? "" : line.substr(value);
+    }
+  }
+  return "";
+}
@@ -0,0 +1,35 @@
+#ifndef NET_GRPC_GATEWAY_EXAMPLES_ECHO_PROC_STATS_H_
+#define NET_GRPC_GATEWAY_EXAMPLES_ECHO_PROC_STATS_H_
+
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Readers of /proc, used by the benchmarks and load tools to report the
+// resource usage of the echo server process.
+
+#include <string>
+
+// Returns the CPU time used by the process |pid| so far, in seconds, from
+// /proc/<pid>/stat, or 0 if it cannot be read.
+double ProcessCpuSeconds(int pid);
+
+// Returns the value of |field| in /proc/<pid>/status, e.g. "51200 kB" for
+// "VmRSS", or "" if it cannot be read.
+std::string ProcessStatusField(int pid, const std::string& field);
+
+#endif  // NET_GRPC_GATEWAY_EXAMPLES_ECHO_PROC_STATS_H_
@@ -0,0 +1,167 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Opens many concurrent ServerStreamingEcho calls to the echo server, and
+// reports the memory and thread count of the server process once they are
+// all open, e.g. to check that open streams do not each hold a thread:
+//
+//   stream_load --server_pid=$(pidof server) --streams=10000
+//
+// Exits with 1 if a call fails.
+
+#include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net/grpc/gateway/examples/echo/echo.grpc.pb.h"
+#include "net/grpc/gateway/examples/echo/proc_stats.h"
+
+using grpc::gateway::testing::EchoService;
+using grpc::gateway::testing::ServerStreamingEchoRequest;
+using grpc::gateway::testing::ServerStreamingEchoResponse;
+
+namespace {
+
+// A ServerStreamingEcho call, and the tag of its operations.
+struct Stream {
+  enum class State { kStarting, kReading, kFinishing };
+
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientAsyncReader<ServerStreamingEchoResponse>>
+      reader;
+  ServerStreamingEchoResponse response;
+  grpc::Status status;
+  State state = State::kStarting;
+  int message_count = 0;
+};
+
+// Prints the resident memory and thread count of the process |pid|, unless
+// it is 0.
+void PrintServerUsage(int pid, const std::string& when) {
+  if (pid == 0) {
+    return;
+  }
+  std::cout << "Server " << when
+            << ": VmRSS: " << ProcessStatusField(pid, "VmRSS")
+            << " Threads: " << ProcessStatusField(pid, "Threads") << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string server_flag = "--server=";
+  const std::string server_pid_flag = "--server_pid=";
+  const std::string streams_flag = "--streams=";
+  const std::string message_count_flag = "--message_count=";
+  const std::string message_interval_ms_flag = "--message_interval_ms=";
+  std::string server = "localhost:9090";
+  int server_pid = 0;
+  int stream_count = 10000;
+  int message_count = 3;
+  int message_interval_ms = 1000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, server_flag.size(), server_flag) == 0) {
+      server = arg.substr(server_flag.size());
+    } else if (arg.compare(0, server_pid_flag.size(), server_pid_flag) == 0) {
+      server_pid = std::stoi(arg.substr(server_pid_flag.size()));
+    } else if (arg.compare(0, streams_flag.size(), streams_flag) == 0) {
+      stream_count = std::stoi(arg.substr(streams_flag.size()));
+    } else if (arg.compare(0, message_count_flag.size(),
+                           message_count_flag) == 0) {
+      message_count = std::stoi(arg.substr(message_count_flag.size()));
+    } else if (arg.compare(0, message_interval_ms_flag.size(),
+                           message_interval_ms_flag) == 0) {
+      message_interval_ms =
+          std::stoi(arg.substr(message_interval_ms_flag.size()));
+    }
+  }
+  if (stream_count <= 0 || message_count <= 0) {
+    std::cerr << "--streams and --message_count must be positive"
+              << std::endl;
+    return 1;
+  }
+
+  PrintServerUsage(server_pid, "before");
+  auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<EchoService::Stub> stub(EchoService::NewStub(
+      grpc::CreateChannel(server, grpc::InsecureChannelCredentials())));
+  grpc::CompletionQueue cq;
+  ServerStreamingEchoRequest request;
+  request.set_message("stream");
+  request.set_message_count(message_count);
+  request.set_message_interval(message_interval_ms);
+  std::vector<std::unique_ptr<Stream>> streams;
+  for (int i = 0; i < stream_count; i++) {
+    streams.emplace_back(new Stream());
+    Stream* stream = streams.back().get();
+    stream->reader = stub->AsyncServerStreamingEcho(&stream->context, request,
+                                                    &cq, stream);
+  }
+
+  // Streams which received their first message, and ended.
+  int open_count = 0;
+  int done_count = 0;
+  int error_count = 0;
+  void* tag;
+  bool ok;
+  while (done_count < stream_count && cq.Next(&tag, &ok)) {
+    Stream* stream = static_cast<Stream*>(tag);
+    if (!ok && stream->state != Stream::State::kFinishing) {
+      stream->state = Stream::State::kFinishing;
+      stream->reader->Finish(&stream->status, stream);
+      continue;
+    }
+    switch (stream->state) {
+      case Stream::State::kStarting:
+        stream->state = Stream::State::kReading;
+        stream->reader->Read(&stream->response, stream);
+        break;
+      case Stream::State::kReading:
+        if (++stream->message_count == 1 && ++open_count == stream_count) {
+          std::chrono::duration<double> elapsed =
+              std::chrono::steady_clock::now() - start;
+          std::cout << stream_count << " streams open after "
+                    << elapsed.count() << "s" << std::endl;
+          PrintServerUsage(server_pid, "with all streams open");
+        }
+        stream->reader->Read(&stream->response, stream);
+        break;
+      case Stream::State::kFinishing:
+        done_count++;
+        if (!stream->status.ok() ||
+            stream->message_count != message_count) {
+          if (error_count++ == 0) {
+            std::cerr << "Stream failed: " << stream->status.error_message()
+                      << " after " << stream->message_count << " messages"
+                      << std::endl;
+          }
+        }
+        break;
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << done_count << " streams done after " << elapsed.count()
+            << "s, " << error_count << " failed" << std::endl;
+  PrintServerUsage(server_pid, "after");
+  return error_count == 0 ? 0 : 1;
+}
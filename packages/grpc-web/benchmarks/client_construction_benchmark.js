@@ -0,0 +1,119 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * @fileoverview Measures the cost of constructing the TypeScript client
+ * generated for test/protos/echo.proto: the time per `new EchoServiceClient()`
+ * and the heap retained by each client.
+ *
+ * Usage (under ./packages/grpc-web, after `npm run build`):
+ *
+ *   node --expose-gc benchmarks/client_construction_benchmark.js \
+ *     [--plugin=path/to/protoc-gen-grpc-web] [--clients=N]
+ *
+ * Pass --plugin to compare two builds of the generator.
+ */
+
+const execSync = require('child_process').execSync;
+const fs = require('fs');
+const path = require('path');
+const {performance} = require('perf_hooks');
+const removeDirectory = require('../test/common.js').removeDirectory;
+const ts = require('typescript');
+
+const outputDir = path.resolve(__dirname, './generated');
+
+function flag(name, defaultValue) {
+  const prefix = `--${name}=`;
+  const arg = process.argv.find(arg => arg.startsWith(prefix));
+  return arg ? arg.substring(prefix.length) : defaultValue;
+}
+
+// Generates and transpiles the client, and returns its module.
+function loadClientModule(plugin) {
+  removeDirectory(outputDir);
+  fs.mkdirSync(outputDir);
+  const pluginFlag = plugin ? `--plugin=protoc-gen-grpc-web=${plugin} ` : '';
+  execSync(
+      `protoc -I=./test/protos echo.proto ${pluginFlag}` +
+      `--js_out=import_style=commonjs:${outputDir} ` +
+      `--grpc-web_out=import_style=typescript,mode=grpcwebtext:${outputDir}`,
+      {cwd: path.resolve(__dirname, '..')});
+
+  const tsPath = path.join(outputDir, 'EchoServiceClientPb.ts');
+  const jsPath = path.join(outputDir, 'EchoServiceClientPb.js');
+  const js = ts.transpileModule(fs.readFileSync(tsPath, 'utf8'), {
+    compilerOptions: {
+      module: ts.ModuleKind.CommonJS,
+      target: ts.ScriptTarget.ES2017,
+    },
+  }).outputText;
+  // Use this package rather than whichever grpc-web is installed.
+  fs.writeFileSync(
+      jsPath,
+      js.replace(/require\("grpc-web"\)/g,
+                 `require(${JSON.stringify(path.resolve(__dirname, '..'))})`));
+  return require(jsPath);
+}
+
+function collectGarbage() {
+  global.gc();
+  global.gc();
+}
+
+function main() {
+  if (typeof global.gc !== 'function') {
+    throw new Error('run with node --expose-gc');
+  }
+  const clientCount = parseInt(flag('clients', '100000'), 10);
+  const {EchoServiceClient} = loadClientModule(flag('plugin', ''));
+
+  try {
+    // Warm up, so that the timed loop runs optimized code.
+    for (let i = 0; i < 10000; i++) {
+      new EchoServiceClient('http://localhost:8080');
+    }
+
+    const start = performance.now();
+    for (let i = 0; i < clientCount; i++) {
+      new EchoServiceClient('http://localhost:8080');
+    }
+    const nanosPerClient =
+        (performance.now() - start) * 1e6 / clientCount;
+
+    const clients = new Array(clientCount);
+    collectGarbage();
+    const heapBefore = process.memoryUsage().heapUsed;
+    for (let i = 0; i < clientCount; i++) {
+      clients[i] = new EchoServiceClient('http://localhost:8080');
+    }
+    collectGarbage();
+    const bytesPerClient =
+        (process.memoryUsage().heapUsed - heapBefore) / clientCount;
+
+    console.log(`clients:                    ${clientCount}`);
+    console.log(`construction time / client: ${nanosPerClient.toFixed(0)} ns`);
+    console.log(`retained heap / client:     ${bytesPerClient.toFixed(0)} B`);
+    // Keep the clients alive until after the second measurement.
+    return clients.length;
+  } finally {
+    removeDirectory(outputDir);
+  }
+}
+
+main();
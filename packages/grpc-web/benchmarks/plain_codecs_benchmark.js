@@ -0,0 +1,148 @@
+/**
+ *
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * @fileoverview Measures the decode throughput of the response deserializer
+ * of the CommonJS client generated for benchmarks/protos/metrics.proto, with
+ * jspb messages (the default) and with plain_codecs=True. Both decode the
+ * same bytes.
+ *
+ * Usage (under ./packages/grpc-web, after `npm run build`):
+ *
+ *   node benchmarks/plain_codecs_benchmark.js \
+ *     [--plugin=path/to/protoc-gen-grpc-web] [--samples=N] [--messages=N]
+ *
+ * --samples is the number of samples in each response, --messages the
+ * number of responses decoded per run.
+ */
+
+const execSync = require('child_process').execSync;
+const fs = require('fs');
+const path = require('path');
+const {performance} = require('perf_hooks');
+const removeDirectory = require('../test/common.js').removeDirectory;
+
+const outputDir = path.resolve(__dirname, './generated');
+
+function flag(name, defaultValue) {
+  const prefix = `--${name}=`;
+  const arg = process.argv.find(arg => arg.startsWith(prefix));
+  return arg ? arg.substring(prefix.length) : defaultValue;
+}
+
+// Generates the client into its own directory under |outputDir|, and returns
+// the arguments of the MethodDescriptor of StreamMetrics and the message
+// module.
+function loadClient(plugin, name, options) {
+  const dir = path.join(outputDir, name);
+  fs.mkdirSync(dir);
+  const pluginFlag = plugin ? `--plugin=protoc-gen-grpc-web=${plugin} ` : '';
+  execSync(
+      `protoc -I=./benchmarks/protos metrics.proto ${pluginFlag}` +
+      `--js_out=import_style=commonjs:${dir} ` +
+      `--grpc-web_out=import_style=commonjs,mode=grpcweb${options}:${dir}`,
+      {cwd: path.resolve(__dirname, '..')});
+
+  // Records every MethodDescriptor the client creates, so that its
+  // deserializer can be called directly.
+  fs.writeFileSync(
+      path.join(dir, 'recording_grpc_web.js'),
+      `const grpcWeb = require(${
+          JSON.stringify(path.resolve(__dirname, '..'))});\n` +
+      'const descriptors = [];\n' +
+      'module.exports = Object.assign({}, grpcWeb, {\n' +
+      '  descriptors,\n' +
+      '  MethodDescriptor: function(...args) { descriptors.push(args); },\n' +
+      '});\n');
+  const jsPath = path.join(dir, 'metrics_grpc_web_pb.js');
+  fs.writeFileSync(
+      jsPath,
+      fs.readFileSync(jsPath, 'utf8')
+          .replace(/require\('grpc-web'\)/g,
+                   'require(\'./recording_grpc_web.js\')'));
+  require(jsPath);
+  const [descriptor] = require(path.join(dir, 'recording_grpc_web.js'))
+      .descriptors.filter(args => args[0].endsWith('/StreamMetrics'));
+  return {
+    deserialize: descriptor[5],
+    messages: require(path.join(dir, 'metrics_pb.js')),
+  };
+}
+
+// Returns an encoded MetricsResponse with |sampleCount| samples.
+function encodeResponse(messages, sampleCount) {
+  const response = new messages.MetricsResponse();
+  for (let i = 0; i < sampleCount; i++) {
+    const sample = response.addSamples();
+    sample.setSeries(`cpu.utilization.host-${i % 50}`);
+    sample.setTimestampMs(1700000000000 + i * 1000);
+    sample.setValue(Math.random() * 100);
+    sample.getLabelsMap()
+        .set('region', 'us-east1')
+        .set('zone', `us-east1-${'bcd'[i % 3]}`)
+        .set('job', 'frontend');
+    for (let j = 0; j < 8; j++) {
+      sample.addBuckets(j * 0.5);
+    }
+  }
+  return response.serializeBinary();
+}
+
+// Returns the decoded megabytes per second.
+function measure(deserialize, bytes, messageCount) {
+  // Warm up, so that the timed loop runs optimized code.
+  for (let i = 0; i < Math.min(messageCount, 1000); i++) {
+    deserialize(bytes);
+  }
+  let checksum = 0;
+  const start = performance.now();
+  for (let i = 0; i < messageCount; i++) {
+    checksum += deserialize(bytes) ? 1 : 0;
+  }
+  const seconds = (performance.now() - start) / 1000;
+  if (checksum !== messageCount) {
+    throw new Error('deserialize failed');
+  }
+  return bytes.length * messageCount / seconds / 1e6;
+}
+
+function main() {
+  const plugin = flag('plugin', '');
+  const sampleCount = parseInt(flag('samples', '100'), 10);
+  const messageCount = parseInt(flag('messages', '5000'), 10);
+
+  removeDirectory(outputDir);
+  fs.mkdirSync(outputDir);
+  try {
+    const jspb = loadClient(plugin, 'jspb', '');
+    const plain = loadClient(plugin, 'plain', ',plain_codecs=True');
+    const bytes = encodeResponse(jspb.messages, sampleCount);
+
+    const jspbRate = measure(jspb.deserialize, bytes, messageCount);
+    const plainRate = measure(plain.deserialize, bytes, messageCount);
+
+    console.log(`response size:     ${bytes.length} B`);
+    console.log(`jspb decode:       ${jspbRate.toFixed(1)} MB/s`);
+    console.log(`plain_codecs:      ${plainRate.toFixed(1)} MB/s`);
+    console.log(`speedup:           ${(plainRate / jspbRate).toFixed(2)}x`);
+  } finally {
+    removeDirectory(outputDir);
+  }
+}
+
+main();
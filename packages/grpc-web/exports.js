@@ -7,18 +7,26 @@
 goog.module('grpc.web.Exports');
 
 const CallOptions = goog.require('grpc.web.CallOptions');
+const DecodeWorker = goog.require('grpc.web.DecodeWorker');
 const MethodDescriptor = goog.require('grpc.web.MethodDescriptor');
 const GrpcWebClientBase = goog.require('grpc.web.GrpcWebClientBase');
+const IdempotencyLevel = goog.require('grpc.web.IdempotencyLevel');
 const RpcError = goog.require('grpc.web.RpcError');
 const StatusCode = goog.require('grpc.web.StatusCode');
 const MethodType = goog.require('grpc.web.MethodType');
+const WireReader = goog.require('grpc.web.WireReader');
+const WireWriter = goog.require('grpc.web.WireWriter');
 
 module['exports']['CallOptions'] = CallOptions;
+module['exports']['DecodeWorker'] = DecodeWorker;
 module['exports']['MethodDescriptor'] = MethodDescriptor;
 module['exports']['GrpcWebClientBase'] = GrpcWebClientBase;
+module['exports']['IdempotencyLevel'] = IdempotencyLevel;
 module['exports']['RpcError'] = RpcError;
 module['exports']['StatusCode'] = StatusCode;
 module['exports']['MethodType'] = MethodType;
+module['exports']['WireReader'] = WireReader;
+module['exports']['WireWriter'] = WireWriter;
 
 // Temporary hack to fix https://github.com/grpc/grpc-web/issues/1153, which is
 // caused by `goog.global` not pointing to the global scope when grpc-web is
@@ -10,6 +10,10 @@ module.ClientReadableStream.prototype.removeListener =
   function(eventType, callback) {};
 module.ClientReadableStream.prototype.cancel = function() {};
 
+module.ClientDuplexStream = function() {};
+module.ClientDuplexStream.prototype.write = function(request) {};
+module.ClientDuplexStream.prototype.end = function() {};
+
 module.GenericClient = function() {};
 module.GenericClient.prototype.unaryCall = function(request) {};
 module.GenericClient.prototype.call = function(requestMessage,
@@ -25,6 +25,19 @@ declare module "grpc-web" {
       metadata: Metadata,
       methodDescriptor: MethodDescriptor<REQ, RESP>
     ): ClientReadableStream<RESP>;
+
+    clientStreaming<REQ, RESP> (
+      method: string,
+      metadata: Metadata,
+      methodDescriptor: MethodDescriptor<REQ, RESP>,
+      callback?: (err: RpcError, response: RESP) => void
+    ): ClientDuplexStream<REQ, RESP>;
+
+    bidiStreaming<REQ, RESP> (
+      method: string,
+      metadata: Metadata,
+      methodDescriptor: MethodDescriptor<REQ, RESP>
+    ): ClientDuplexStream<REQ, RESP>;
   }
 
   export class ClientReadableStream<RESP> {
@@ -53,6 +66,11 @@ declare module "grpc-web" {
     cancel (): void;
   }
 
+  export class ClientDuplexStream<REQ, RESP> extends ClientReadableStream<RESP> {
+    write (request: REQ): ClientDuplexStream<REQ, RESP>;
+    end (): ClientDuplexStream<REQ, RESP>;
+  }
+
   export interface StreamInterceptor<REQ, RESP> {
     intercept(request: Request<REQ, RESP>,
               invoker: (request: Request<REQ, RESP>) =>
@@ -77,7 +95,9 @@ declare module "grpc-web" {
                 requestType: new (...args: unknown[]) => REQ,
                 responseType: new (...args: unknown[]) => RESP,
                 requestSerializeFn: any,
-                responseDeserializeFn: any);
+                responseDeserializeFn: any,
+                responseDeserializeIntoFn?: any,
+                idempotencyLevel?: string);
     getName(): string;
   }
 
@@ -98,12 +118,25 @@ declare module "grpc-web" {
     format?: string;
     suppressCorsPreflight?: boolean;
     withCredentials?: boolean;
+    useHttpGet?: boolean;
+    coalesceCalls?: boolean;
     unaryInterceptors?: UnaryInterceptor<unknown, unknown>[];
     streamInterceptors?: StreamInterceptor<unknown, unknown>[];
+    responsePoolSize?: number;
+    streamingUploads?: boolean;
+    batchUrl?: string;
+    batchWindowMs?: number;
+    hedgingDelayMs?: number;
+    decodeWorker?: { postMessage(message: unknown): void };
   }
 
   export class GrpcWebClientBase extends AbstractClientBase {
     constructor(options?: GrpcWebClientBaseOptions);
+    getCoalescableCallCount(): number;
+    getCoalescedCallCount(): number;
+    getBatchCount(): number;
+    getHedgeCount(): number;
+    getHedgeWinCount(): number;
   }
 
   export class RpcError extends Error {
@@ -138,8 +171,79 @@ declare module "grpc-web" {
     UNAUTHENTICATED,
   }
 
+  /** Decodes responses in a worker. Used by decode_worker files. */
+  export class DecodeWorker {
+    static serve(
+      decoders: { [method: string]: (bytes: Uint8Array) => object },
+      port?: { postMessage(message: unknown): void }): void;
+  }
+
+  /** Reads the protocol buffer wire format. Used by plain codecs. */
+  export class WireReader {
+    constructor(bytes: Uint8Array);
+    pos: number;
+    readonly len: number;
+    uint32(): number;
+    int32(): number;
+    sint32(): number;
+    bool(): boolean;
+    uint64(): number;
+    uint64String(): string;
+    int64(): number;
+    int64String(): string;
+    sint64(): number;
+    sint64String(): string;
+    fixed32(): number;
+    sfixed32(): number;
+    fixed64(): number;
+    fixed64String(): string;
+    sfixed64(): number;
+    sfixed64String(): string;
+    float(): number;
+    double(): number;
+    string(): string;
+    bytes(): Uint8Array;
+    limit(): number;
+    skip(tag: number): void;
+  }
+
+  /** Writes the protocol buffer wire format. Used by plain codecs. */
+  export class WireWriter {
+    constructor();
+    uint32(value: number): void;
+    int32(value: number): void;
+    sint32(value: number): void;
+    bool(value: boolean): void;
+    uint64(value: number): void;
+    uint64String(value: string): void;
+    int64(value: number): void;
+    int64String(value: string): void;
+    sint64(value: number): void;
+    sint64String(value: string): void;
+    fixed32(value: number): void;
+    sfixed32(value: number): void;
+    fixed64(value: number): void;
+    fixed64String(value: string): void;
+    sfixed64(value: number): void;
+    sfixed64String(value: string): void;
+    float(value: number): void;
+    double(value: number): void;
+    string(value: string): void;
+    bytes(value: Uint8Array | string): void;
+    fork(): number;
+    ldelim(start: number): void;
+    finish(): Uint8Array;
+  }
+
   export namespace MethodType {
     const UNARY: string;
     const SERVER_STREAMING: string;
+    const CLIENT_STREAMING: string;
+    const BIDI_STREAMING: string;
+  }
+
+  export namespace IdempotencyLevel {
+    const NO_SIDE_EFFECTS: string;
+    const IDEMPOTENT: string;
   }
 }
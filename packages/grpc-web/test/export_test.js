@@ -22,6 +22,13 @@ describe('grpc-web export test', function() {
     assert.equal(typeof rpcError.metadata, 'object');
   });
 
+  it('should have IdempotencyLevel exported', function() {
+    assert.deepEqual(grpc.web.IdempotencyLevel, {
+      NO_SIDE_EFFECTS: 'no_side_effects',
+      IDEMPOTENT: 'idempotent',
+    });
+  });
+
   it('should have StatusCode exported', function() {
     assert.deepEqual(grpc.web.StatusCode, {
       ABORTED: 10,
@@ -24,6 +24,7 @@ const path = require('path');
 const removeDirectory = require('./common.js').removeDirectory;
 const GENERATED_CODE_PATH = require('./common.js').GENERATED_CODE_PATH;
 const mockXmlHttpRequest = require('mock-xmlhttprequest');
+const {Worker} = require('worker_threads');
 
 var MockXMLHttpRequest;
 
@@ -460,6 +461,475 @@ describe('grpc-web generated code (commonjs+grpcwebtext)', function() {
 
 });
 
+describe('grpc-web generated code (lazy_method_descriptors)', function() {
+  const oldXMLHttpRequest = global.XMLHttpRequest;
+
+  const protoGenCodePath = path.resolve(__dirname, './echo_pb.js');
+  const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
+
+  const genCodeCmd =
+    'protoc -I=./test/protos echo.proto ' +
+    '--js_out=import_style=commonjs:./test ' +
+    '--grpc-web_out=import_style=commonjs,mode=grpcwebtext,' +
+    'lazy_method_descriptors=True:./test';
+
+  before(function() {
+    ['protoc', 'protoc-gen-grpc-web'].map(prog => {
+      if (!commandExists(prog)) {
+        assert.fail(`${prog} is not installed`);
+      }
+    });
+  });
+
+  beforeEach(function() {
+    if (fs.existsSync(protoGenCodePath)) {
+      fs.unlinkSync(protoGenCodePath);
+    }
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+    delete require.cache[genCodePath];
+    MockXMLHttpRequest = mockXmlHttpRequest.newMockXhr()
+    global.XMLHttpRequest = MockXMLHttpRequest;
+  });
+
+  afterEach(function() {
+    if (fs.existsSync(protoGenCodePath)) {
+      fs.unlinkSync(protoGenCodePath);
+    }
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+    delete require.cache[genCodePath];
+    global.XMLHttpRequest = oldXMLHttpRequest;
+  });
+
+  it('should not construct descriptors at load time', function() {
+    execSync(genCodeCmd);
+    const genCode = fs.readFileSync(genCodePath, 'utf8');
+    assert.equal(false,
+                 /^const methodDescriptor_\w+ = new/m.test(genCode));
+    assert.equal(true, /^let methodDescriptor_\w+_ = null;/m.test(genCode));
+  });
+
+  it('should send unary request', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    const {EchoRequest} = require(protoGenCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    var request = new EchoRequest();
+    request.setMessage('aaa');
+    MockXMLHttpRequest.onSend = function(xhr) {
+      assert.equal('POST', xhr.method);
+      // a single 'aaa' string, encoded
+      assert.equal('AAAAAAUKA2FhYQ==', xhr.body);
+      assert.equal('MyHostname/grpc.gateway.testing.EchoService/Echo',
+                   xhr.url);
+      done();
+    };
+    echoService.echo(request, {});
+  });
+});
+
+describe('grpc-web generated code (compact_method_tables)', function() {
+  const oldXMLHttpRequest = global.XMLHttpRequest;
+
+  const protoGenCodePath = path.resolve(__dirname, './echo_pb.js');
+  const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
+
+  const genCodeCmd =
+    'protoc -I=./test/protos echo.proto ' +
+    '--js_out=import_style=commonjs:./test ' +
+    '--grpc-web_out=import_style=commonjs,mode=grpcwebtext,' +
+    'compact_method_tables=True:./test';
+
+  before(function() {
+    ['protoc', 'protoc-gen-grpc-web'].map(prog => {
+      if (!commandExists(prog)) {
+        assert.fail(`${prog} is not installed`);
+      }
+    });
+  });
+
+  beforeEach(function() {
+    if (fs.existsSync(protoGenCodePath)) {
+      fs.unlinkSync(protoGenCodePath);
+    }
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+    delete require.cache[genCodePath];
+    MockXMLHttpRequest = mockXmlHttpRequest.newMockXhr()
+    global.XMLHttpRequest = MockXMLHttpRequest;
+  });
+
+  afterEach(function() {
+    if (fs.existsSync(protoGenCodePath)) {
+      fs.unlinkSync(protoGenCodePath);
+    }
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+    delete require.cache[genCodePath];
+    global.XMLHttpRequest = oldXMLHttpRequest;
+  });
+
+  it('should emit a method table instead of per-method code', function() {
+    execSync(genCodeCmd);
+    const genCode = fs.readFileSync(genCodePath, 'utf8');
+    assert.equal(false, /methodDescriptor_/.test(genCode));
+    assert.equal(true, /^addServiceMethods\(/m.test(genCode));
+  });
+
+  it('should send unary request', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    const {EchoRequest} = require(protoGenCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    var request = new EchoRequest();
+    request.setMessage('aaa');
+    MockXMLHttpRequest.onSend = function(xhr) {
+      assert.equal('POST', xhr.method);
+      // a single 'aaa' string, encoded
+      assert.equal('AAAAAAUKA2FhYQ==', xhr.body);
+      assert.equal('MyHostname/grpc.gateway.testing.EchoService/Echo',
+                   xhr.url);
+      done();
+    };
+    echoService.echo(request, {});
+  });
+
+  it('should send server streaming request', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    const {ServerStreamingEchoRequest} = require(protoGenCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    var request = new ServerStreamingEchoRequest();
+    request.setMessage('aaa');
+    request.setMessageCount(1);
+    MockXMLHttpRequest.onSend = function(xhr) {
+      assert.equal('MyHostname/grpc.gateway.testing.EchoService/' +
+                   'ServerStreamingEcho', xhr.url);
+      done();
+    };
+    echoService.serverStreamingEcho(request, {});
+  });
+});
+
+describe('grpc-web generated code (size_manifest)', function() {
+  const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
+  const manifestPath = path.resolve(__dirname, './echo_grpc_web_size.json');
+
+  const genCodeCmd =
+    'protoc -I=./test/protos echo.proto ' +
+    '--grpc-web_out=import_style=commonjs,mode=grpcwebtext,' +
+    'size_manifest=True:./test';
+
+  before(function() {
+    ['protoc', 'protoc-gen-grpc-web'].map(prog => {
+      if (!commandExists(prog)) {
+        assert.fail(`${prog} is not installed`);
+      }
+    });
+  });
+
+  beforeEach(function() {
+    [genCodePath, manifestPath].forEach(file => {
+      if (fs.existsSync(file)) {
+        fs.unlinkSync(file);
+      }
+    });
+  });
+
+  afterEach(function() {
+    [genCodePath, manifestPath].forEach(file => {
+      if (fs.existsSync(file)) {
+        fs.unlinkSync(file);
+      }
+    });
+  });
+
+  it('should split the client size by service and method', function() {
+    execSync(genCodeCmd);
+    const manifest = JSON.parse(fs.readFileSync(manifestPath, 'utf8'));
+    assert.equal('echo_grpc_web_pb.js', manifest.output);
+    assert.equal(fs.statSync(genCodePath).size, manifest.bytes);
+
+    assert.equal(1, manifest.services.length);
+    const service = manifest.services[0];
+    assert.equal('grpc.gateway.testing.EchoService', service.name);
+    assert.equal(manifest.bytes, manifest.shared_bytes + service.bytes);
+    const methodBytes =
+      service.methods.reduce((sum, method) => sum + method.bytes, 0);
+    assert.equal(service.bytes, service.shared_bytes + methodBytes);
+
+    const echo = service.methods.find(method => method.name === 'Echo');
+    assert.ok(echo.bytes > 0);
+    assert.equal('grpc.gateway.testing.EchoRequest', echo.request);
+    assert.equal('echo.proto', echo.request_proto);
+  });
+
+  it('should list the imports of the client', function() {
+    execSync(genCodeCmd);
+    const manifest = JSON.parse(fs.readFileSync(manifestPath, 'utf8'));
+    assert.deepEqual([
+      {module: 'grpc-web'},
+      {module: './echo_pb.js', proto: 'echo.proto'},
+    ], manifest.imports);
+    assert.deepEqual({'echo.proto': []}, manifest.proto_dependencies);
+  });
+});
+
+describe('grpc-web generated code (client_streaming)', function() {
+  const oldFetch = global.fetch;
+
+  const protoGenCodePath = path.resolve(__dirname, './echo_pb.js');
+  const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
+
+  const genCodeCmd =
+    'protoc -I=./test/protos echo.proto ' +
+    '--js_out=import_style=commonjs:./test ' +
+    '--grpc-web_out=import_style=commonjs,mode=grpcwebtext,' +
+    'client_streaming=True:./test';
+
+  // A grpc-web-text response holding an EchoResponse with message 'xyz',
+  // followed by an OK status.
+  const RESPONSE_BODY = 'AAAAAAUKA3h5eoAAAAAPZ3JwYy1zdGF0dXM6MA0K';
+
+  let fetches;
+
+  before(function() {
+    ['protoc', 'protoc-gen-grpc-web'].map(prog => {
+      if (!commandExists(prog)) {
+        assert.fail(`${prog} is not installed`);
+      }
+    });
+  });
+
+  beforeEach(function() {
+    [protoGenCodePath, genCodePath].forEach(file => {
+      if (fs.existsSync(file)) {
+        fs.unlinkSync(file);
+      }
+    });
+    delete require.cache[genCodePath];
+    fetches = [];
+    global.fetch = (url, init) => {
+      fetches.push({url, init});
+      return Promise.resolve(new Response(RESPONSE_BODY, {
+        headers: {'Content-Type': 'application/grpc-web-text'},
+      }));
+    };
+  });
+
+  afterEach(function() {
+    [protoGenCodePath, genCodePath].forEach(file => {
+      if (fs.existsSync(file)) {
+        fs.unlinkSync(file);
+      }
+    });
+    delete require.cache[genCodePath];
+    global.fetch = oldFetch;
+  });
+
+  it('should send client streaming requests when ended', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    const {EchoRequest} = require(protoGenCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    var stream = echoService.clientStreamingEcho({}, (err, response) => {
+      assert.equal(null, err);
+      assert.equal('xyz', response.getMessage());
+      assert.equal(1, fetches.length);
+      assert.equal('MyHostname/grpc.gateway.testing.EchoService/' +
+                   'ClientStreamingEcho', fetches[0].url);
+      // 'aaa' and 'bbb' requests, encoded
+      assert.equal('AAAAAAUKA2FhYQAAAAAFCgNiYmI=',
+                   Buffer.from(fetches[0].init.body).toString());
+      done();
+    });
+    stream.write(new EchoRequest().setMessage('aaa'));
+    stream.write(new EchoRequest().setMessage('bbb'));
+    assert.equal(0, fetches.length);
+    stream.end();
+  });
+
+  it('should receive bidi streaming responses', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServicePromiseClient} = require(genCodePath);
+    const {EchoRequest} = require(protoGenCodePath);
+    var echoService = new EchoServicePromiseClient('MyHostname', null, null);
+    var messages = [];
+    echoService.fullDuplexEcho({})
+      .on('data', (response) => {
+        messages.push(response.getMessage());
+      })
+      .on('end', () => {
+        assert.deepEqual(['xyz'], messages);
+        done();
+      })
+      .write(new EchoRequest().setMessage('aaa'))
+      .end();
+  });
+
+  it('should require a grpc-web mode', function() {
+    assert.throws(() => execSync(
+      'protoc -I=./test/protos echo.proto ' +
+      '--grpc-web_out=import_style=commonjs,mode=binary,' +
+      'client_streaming=True:./test', {stdio: 'pipe'}));
+  });
+});
+
+describe('grpc-web generated code (plain_codecs)', function() {
+  const oldXMLHttpRequest = global.XMLHttpRequest;
+
+  const protoGenCodePath = path.resolve(__dirname, './echo_pb.js');
+  const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
+  const workerCodePath = path.resolve(__dirname, './echo_grpc_web_worker.js');
+
+  const genCodeCmd =
+    'protoc -I=./test/protos echo.proto ' +
+    '--js_out=import_style=commonjs:./test ' +
+    '--grpc-web_out=import_style=commonjs,mode=grpcwebtext,' +
+    'plain_codecs=True:./test';
+
+  before(function() {
+    ['protoc', 'protoc-gen-grpc-web'].map(prog => {
+      if (!commandExists(prog)) {
+        assert.fail(`${prog} is not installed`);
+      }
+    });
+  });
+
+  beforeEach(function() {
+    if (fs.existsSync(protoGenCodePath)) {
+      fs.unlinkSync(protoGenCodePath);
+    }
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+    if (fs.existsSync(workerCodePath)) {
+      fs.unlinkSync(workerCodePath);
+    }
+    // Other tests load the client generated without plain_codecs.
+    delete require.cache[genCodePath];
+    MockXMLHttpRequest = mockXmlHttpRequest.newMockXhr()
+    global.XMLHttpRequest = MockXMLHttpRequest;
+  });
+
+  afterEach(function() {
+    if (fs.existsSync(protoGenCodePath)) {
+      fs.unlinkSync(protoGenCodePath);
+    }
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+    if (fs.existsSync(workerCodePath)) {
+      fs.unlinkSync(workerCodePath);
+    }
+    delete require.cache[genCodePath];
+    global.XMLHttpRequest = oldXMLHttpRequest;
+  });
+
+  it('should send unary request', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    MockXMLHttpRequest.onSend = function(xhr) {
+      // a single 'aaa' string, encoded
+      assert.equal('AAAAAAUKA2FhYQ==', xhr.body);
+      done();
+    };
+    echoService.echo({message: 'aaa'}, {});
+  });
+
+  it('should receive unary response', function(done) {
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    MockXMLHttpRequest.onSend = function(xhr) {
+      xhr.respond(200, {'Content-Type': 'application/grpc-web-text'},
+                  // a single data frame with 'aaa' message, encoded
+                  'AAAAAAUKA2FhYQ==');
+    };
+    echoService.echo({message: 'aaa'}, {}, function(err, response) {
+      assert.deepEqual({message: 'aaa', value: ''}, response);
+      done();
+    });
+  });
+
+  it('should receive streaming response', function(done) {
+    done = multiDone(done, 3);
+    execSync(genCodeCmd);
+    const {EchoServiceClient} = require(genCodePath);
+    var echoService = new EchoServiceClient('MyHostname', null, null);
+    MockXMLHttpRequest.onSend = function(xhr) {
+      xhr.respond(200, {'Content-Type': 'application/grpc-web-text'},
+                  // 3 'aaa' messages in 3 data frames, encoded
+                  'AAAAAAUKA2FhYQAAAAAFCgNhYWEAAAAABQoDYWFh');
+    };
+    var stream = echoService.serverStreamingEcho(
+        {message: 'aaa', messageCount: 3, messageInterval: 0}, {});
+    stream.on('data', function(response) {
+      assert.deepEqual({message: 'aaa'}, response);
+      done();
+    });
+  });
+
+  it('should reuse streamed responses', function(done) {
+    execSync(genCodeCmd.replace(
+        'plain_codecs=True', 'plain_codecs=True,reuse_response_messages=True'));
+    const {EchoServiceClient} = require(genCodePath);
+    var echoService =
+        new EchoServiceClient('MyHostname', null, {responsePoolSize: 1});
+    MockXMLHttpRequest.onSend = function(xhr) {
+      xhr.respond(200, {'Content-Type': 'application/grpc-web-text'},
+                  // 3 'aaa' messages in 3 data frames, encoded
+                  'AAAAAAUKA2FhYQAAAAAFCgNhYWEAAAAABQoDYWFh');
+    };
+    var responses = [];
+    var stream = echoService.serverStreamingEcho(
+        {message: 'aaa', messageCount: 3, messageInterval: 0}, {});
+    stream.on('data', function(response) {
+      assert.deepEqual({message: 'aaa'}, response);
+      responses.push(response);
+      if (responses.length == 3) {
+        assert.strictEqual(responses[0], responses[2]);
+        done();
+      }
+    });
+  });
+
+  it('should decode responses in a worker', function(done) {
+    execSync(genCodeCmd.replace(
+        'plain_codecs=True', 'plain_codecs=True,decode_worker=True'));
+    const {EchoServiceClient} = require(genCodePath);
+    const worker = new Worker(
+        'const {parentPort, workerData} = require("worker_threads");' +
+        'require("grpc-web").DecodeWorker.serve(' +
+        '    require(workerData), parentPort);',
+        {eval: true, workerData: workerCodePath});
+    var echoService =
+        new EchoServiceClient('MyHostname', null, {decodeWorker: worker});
+    MockXMLHttpRequest.onSend = function(xhr) {
+      xhr.respond(200, {'Content-Type': 'application/grpc-web-text'},
+                  // 3 'aaa' messages in 3 data frames, encoded
+                  'AAAAAAUKA2FhYQAAAAAFCgNhYWEAAAAABQoDYWFh');
+    };
+    var responses = [];
+    var stream = echoService.serverStreamingEcho(
+        {message: 'aaa', messageCount: 3, messageInterval: 0}, {});
+    stream.on('data', function(response) {
+      responses.push(response);
+    });
+    stream.on('end', function() {
+      assert.deepEqual(
+          [{message: 'aaa'}, {message: 'aaa'}, {message: 'aaa'}], responses);
+      worker.terminate().then(() => done());
+    });
+  });
+});
+
 describe('grpc-web generated code (closure+grpcwebtext)', function() {
   const oldXMLHttpRequest = global.XMLHttpRequest;
 
@@ -551,6 +1021,65 @@ describe('grpc-web generated code (closure+grpcwebtext)', function() {
   });
 });
 
+describe('grpc-web generated code (esm+grpcwebtext)', function() {
+  const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
+
+  const genCodeCmd =
+    'protoc -I=./test/protos echo.proto ' +
+    '--grpc-web_out=import_style=esm,mode=grpcwebtext:./test';
+
+  before(function() {
+    ['protoc', 'protoc-gen-grpc-web'].map(prog => {
+      if (!commandExists(prog)) {
+        assert.fail(`${prog} is not installed`);
+      }
+    });
+  });
+
+  beforeEach(function() {
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+  });
+
+  afterEach(function() {
+    if (fs.existsSync(genCodePath)) {
+      fs.unlinkSync(genCodePath);
+    }
+  });
+
+  it('should exist', function() {
+    execSync(genCodeCmd);
+    assert.equal(true, fs.existsSync(genCodePath));
+  });
+
+  it('should export one function and descriptor per method', function() {
+    execSync(genCodeCmd);
+    const code = fs.readFileSync(genCodePath, 'utf8');
+    assert.ok(code.includes('export function createEchoServiceClient('));
+    ['Echo', 'ServerStreamingEcho', 'EchoStatus'].forEach(method => {
+      const jsMethod = method[0].toLowerCase() + method.slice(1);
+      assert.ok(code.includes(
+          `export function EchoService_${jsMethod}(client, request,`));
+      assert.ok(code.includes(
+          `export const methodDescriptor_EchoService_${method} =\n` +
+          '  /*#__PURE__*/ new grpcWeb.MethodDescriptor('));
+    });
+  });
+
+  it('should not have module-scope side effects', function() {
+    execSync(genCodeCmd);
+    const code = fs.readFileSync(genCodePath, 'utf8');
+    assert.ok(!code.includes('.prototype.'));
+    assert.ok(!code.includes('module.exports'));
+    const descriptors = code.match(/new grpcWeb\.MethodDescriptor\(/g);
+    const pureDescriptors =
+        code.match(/\/\*#__PURE__\*\/ new grpcWeb\.MethodDescriptor\(/g);
+    assert.equal(descriptors.length, pureDescriptors.length);
+  });
+});
+
+
 describe('grpc-web generated code: callbacks tests', function() {
   const protoGenCodePath = path.resolve(__dirname, './echo_pb.js');
   const genCodePath = path.resolve(__dirname, './echo_grpc_web_pb.js');
@@ -61,6 +61,14 @@ source ./scripts/test-proxy.sh
 # Remove all docker containers
 docker-compose down
 
+# Bring up the C++ echo server with its HTTP gateways, and test them.
+docker-compose build echo-server
+docker run -d --rm --name echo-server-gateways -p 8081:8081 -p 8082:8082 \
+  grpcweb/echo-server ./server --http_get_port=8081 --batch_port=8082 && \
+  sleep 5;
+source ./scripts/test-gateways.sh
+docker stop echo-server-gateways
+
 
 ##########################################################
 # Step 3: Test all Dockerfile and Bazel targets can build!
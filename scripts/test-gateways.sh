@@ -0,0 +1,102 @@
+#!/bin/bash
+# Copyright 2018 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+set -ex
+
+# Run curl requests against the HTTP gateways of the C++ echo server, started
+# with --http_get_port=${HTTP_GET_PORT} --batch_port=${BATCH_PORT}.
+HTTP_GET_PORT=${HTTP_GET_PORT:-8081}
+BATCH_PORT=${BATCH_PORT:-8082}
+
+# An Echo request with "hello" as the message, in web-safe base64.
+get_url="http://localhost:${HTTP_GET_PORT}/grpc.gateway.testing.EchoService/Echo?\$req=CgVoZWxsbw"
+
+# A header which is not valid call metadata must be rejected, rather than
+# forwarded to gRPC, which would abort the server.
+code=$(curl -s -o /dev/null -w '%{http_code}' "$get_url" -H 'X-Bad: café')
+if [[ "$code" != "400" ]]; then
+  echo "Expected 400 for a non-ASCII header, got $code"
+  exit 1
+fi
+
+# The server must still be up.
+code=$(curl -s -o /dev/null -w '%{http_code}' "$get_url" -H 'X-Good: cafe')
+if [[ "$code" != "200" ]]; then
+  echo "Expected 200 for a valid GET request, got $code"
+  exit 1
+fi
+
+# Shared caches may keep the response to a request without metadata, but not
+# the response to a request with metadata, which may depend on it.
+headers=$(curl -s -D - -o /dev/null "$get_url")
+if ! echo "$headers" | grep -qi '^cache-control: public'; then
+  echo "Expected a public response without metadata"
+  exit 1
+fi
+headers=$(curl -s -D - -o /dev/null "$get_url" \
+  -H 'Authorization: Bearer secret')
+if ! echo "$headers" | grep -qi '^cache-control: private'; then
+  echo "Expected a private response with metadata"
+  exit 1
+fi
+
+# Writes a batch of $1 Echo calls with "hello" as the message, each with the
+# metadata line $2, as application/grpc-web-batch-text.
+function batch() {
+  python3 -c '
+import base64, struct, sys
+def frame(flags, data):
+  return bytes([flags]) + struct.pack(">I", len(data)) + data
+call = (frame(0x80, b":path: /grpc.gateway.testing.EchoService/Echo\r\n" +
+              sys.argv[2].encode() + b"\r\n") +
+        frame(0x00, b"\x0a\x05hello"))
+sys.stdout.write(base64.b64encode(call * int(sys.argv[1])).decode())
+' "$1" "$2"
+}
+batch_url="http://localhost:${BATCH_PORT}/batch"
+
+code=$(batch 100 'x-good: cafe' | curl -s -o /dev/null -w '%{http_code}' \
+  -H 'Content-Type: application/grpc-web-batch-text' --data-binary @- \
+  "$batch_url")
+if [[ "$code" != "200" ]]; then
+  echo "Expected 200 for a batch of 100 calls, got $code"
+  exit 1
+fi
+
+code=$(batch 101 'x-good: cafe' | curl -s -o /dev/null -w '%{http_code}' \
+  -H 'Content-Type: application/grpc-web-batch-text' --data-binary @- \
+  "$batch_url")
+if [[ "$code" != "400" ]]; then
+  echo "Expected 400 for a batch of 101 calls, got $code"
+  exit 1
+fi
+
+code=$(batch 2 'x-bad: café' | curl -s -o /dev/null -w '%{http_code}' \
+  -H 'Content-Type: application/grpc-web-batch-text' --data-binary @- \
+  "$batch_url")
+if [[ "$code" != "400" ]]; then
+  echo "Expected 400 for a batch with a non-ASCII header, got $code"
+  exit 1
+fi
+
+# The server must still be up.
+code=$(batch 1 'x-good: cafe' | curl -s -o /dev/null -w '%{http_code}' \
+  -H 'Content-Type: application/grpc-web-batch-text' --data-binary @- \
+  "$batch_url")
+if [[ "$code" != "200" ]]; then
+  echo "Expected 200 for a batch of 1 call, got $code"
+  exit 1
+fi
+
+echo "Gateway tests successful!"